@@ -1,8 +1,28 @@
 find_program(GLSLC glslc)
 
+set(EMBEDDED_SHADER_TEMPLATE ${CMAKE_CURRENT_LIST_DIR}/embedded_shader.cpp.in)
+
+# Compiles SHADER into TARGET: the SPIR-V words become a constexpr array registered under DESTINATION
+# (see src/util/shaders.h), and DESTINATION itself is written to shaders/<TARGET>/ for runtime overrides
 function(add_shader TARGET SHADER DESTINATION)
-    add_custom_command(TARGET ${TARGET} POST_BUILD
-        COMMAND ${GLSLC} -o ${CMAKE_CURRENT_BINARY_DIR}/${DESTINATION} ${CMAKE_CURRENT_SOURCE_DIR}/${SHADER}
+    set(OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/shaders/${TARGET})
+    set(SHADER_SPV ${OUTPUT_DIR}/${DESTINATION})
+    set(SHADER_WORDS ${OUTPUT_DIR}/${DESTINATION}.inc)
+    string(MAKE_C_IDENTIFIER ${DESTINATION} SHADER_ID)
+    set(SHADER_SOURCE ${OUTPUT_DIR}/${SHADER_ID}.cpp)
+    set(SHADER_NAME ${DESTINATION})
+    set(SHADERS_HEADER ${PROJECT_SOURCE_DIR}/src/util/shaders.h)
+
+    add_custom_command(
+        OUTPUT ${SHADER_SPV} ${SHADER_WORDS}
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTPUT_DIR}
+        COMMAND ${GLSLC} -o ${SHADER_SPV} ${CMAKE_CURRENT_SOURCE_DIR}/${SHADER}
+        COMMAND ${GLSLC} -mfmt=num -o ${SHADER_WORDS} ${CMAKE_CURRENT_SOURCE_DIR}/${SHADER}
+        DEPENDS ${CMAKE_CURRENT_SOURCE_DIR}/${SHADER}
         VERBATIM
     )
-endfunction()
\ No newline at end of file
+
+    configure_file(${EMBEDDED_SHADER_TEMPLATE} ${SHADER_SOURCE} @ONLY)
+    set_source_files_properties(${SHADER_SOURCE} PROPERTIES OBJECT_DEPENDS ${SHADER_WORDS})
+    target_sources(${TARGET} PRIVATE ${SHADER_SOURCE} ${SHADER_SPV})
+endfunction()
@@ -0,0 +1,106 @@
+#include "BenchOptions.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+const char* nextValue(const int argc, const char* const* argv, int& i)
+{
+    if (i + 1 >= argc)
+    {
+        throw std::invalid_argument(std::string("missing value for option: ") + argv[i]);
+    }
+
+    return argv[++i];
+}
+
+// "1024,4096" -> { 1024, 4096 }
+template <class T>
+std::vector<T> parseList(const char* value)
+{
+    std::vector<T> ret;
+
+    std::istringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        ret.push_back(static_cast<T>(std::stoull(item)));
+    }
+
+    if (ret.empty())
+    {
+        throw std::invalid_argument(std::string("empty list: ") + value);
+    }
+
+    return ret;
+}
+
+}
+
+BenchOptions parseBenchOptions(const int argc, const char* const* argv)
+{
+    BenchOptions ret;
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--format"))
+        {
+            ret.format = nextValue(argc, argv, i);
+            if (ret.format != "json" and ret.format != "csv")
+            {
+                throw std::invalid_argument("unknown format: " + ret.format);
+            }
+        }
+        else if (!strcmp(argv[i], "--output"))
+        {
+            ret.outputPath = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--filter"))
+        {
+            ret.filter = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--device"))
+        {
+            ret.device = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--sizes"))
+        {
+            ret.sizes = parseList<size_t>(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--threads"))
+        {
+            ret.threads = parseList<unsigned>(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--min-time"))
+        {
+            ret.minSeconds = std::stod(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--min-iterations"))
+        {
+            ret.minIterations = std::stoull(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--cpu-only"))
+        {
+            ret.cpuOnly = true;
+        }
+        else
+        {
+            throw std::invalid_argument(std::string("unknown option: ") + argv[i]);
+        }
+    }
+
+    // hardware_concurrency() may report 0, and 1 twice on single core machines
+    for (auto& threads : ret.threads)
+    {
+        threads = std::max(1u, threads);
+    }
+    std::sort(ret.threads.begin(), ret.threads.end());
+    ret.threads.erase(std::unique(ret.threads.begin(), ret.threads.end()), ret.threads.end());
+
+    return ret;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BenchOptions
+{
+    // "json" or "csv"
+    std::string format = "json";
+
+    // Results go to stdout when empty, progress always goes to stderr
+    std::string outputPath;
+
+    // Only benchmarks whose name contains this run, e.g. "force" or "upload"
+    std::string filter;
+
+    // Selects the first physical device whose name contains this, e.g. "llvmpipe"
+    std::string device;
+
+    // Particle counts the force kernels run at
+    std::vector<size_t> sizes = { 1024, 4096, 16384 };
+
+    // Thread counts the force kernels run with
+    std::vector<unsigned> threads = { 1, std::thread::hardware_concurrency() };
+
+    // Each case repeats until it ran this long and at least minIterations times
+    double minSeconds = 0.25;
+
+    size_t minIterations = 5;
+
+    // Skips everything that needs a Vulkan device
+    bool cpuOnly = false;
+};
+
+BenchOptions parseBenchOptions(const int argc, const char* const* argv);
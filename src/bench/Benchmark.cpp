@@ -0,0 +1,112 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+
+// Names and params are plain identifiers, only quotes and backslashes need escaping
+std::string quote(const std::string& value)
+{
+    std::string ret = "\"";
+    for (auto c : value)
+    {
+        if (c == '"' or c == '\\')
+        {
+            ret += '\\';
+        }
+        ret += c;
+    }
+    return ret + '"';
+}
+
+void writeObject(std::ostream& os, const BenchmarkParams& params)
+{
+    os << "{ ";
+    for (auto i = 0u; i < params.size(); ++i)
+    {
+        os << (i ? ", " : "") << quote(params[i].first) << ": " << quote(params[i].second);
+    }
+    os << " }";
+}
+
+}
+
+Benchmark::Benchmark(const double minSeconds, const size_t minIterations, const std::string& filter)
+    : m_minSeconds(minSeconds), m_minIterations(std::max<size_t>(1, minIterations)), m_filter(filter)
+{
+}
+
+bool Benchmark::isEnabled(const std::string& name) const
+{
+    return name.find(m_filter) != std::string::npos;
+}
+
+const std::vector<BenchmarkResult>& Benchmark::results() const
+{
+    return m_results;
+}
+
+void Benchmark::writeCsv(std::ostream& os) const
+{
+    os << "benchmark,params,iterations,min_ns,median_ns,mean_ns,rate,rate_unit\n";
+    for (const auto& result : m_results)
+    {
+        os << result.name << ',';
+        for (auto i = 0u; i < result.params.size(); ++i)
+        {
+            os << (i ? ";" : "") << result.params[i].first << '=' << result.params[i].second;
+        }
+        os  << ',' << result.iterations << ',' << result.minNs << ',' << result.medianNs << ',' << result.meanNs
+            << ',' << result.rate << ',' << result.rateUnit << '\n';
+    }
+}
+
+void Benchmark::writeJson(std::ostream& os, const BenchmarkParams& context) const
+{
+    os << "{\n  \"context\": ";
+    writeObject(os, context);
+    os << ",\n  \"results\": [\n";
+    for (auto i = 0u; i < m_results.size(); ++i)
+    {
+        const auto& result = m_results[i];
+
+        os << "    { \"benchmark\": " << quote(result.name) << ", \"params\": ";
+        writeObject(os, result.params);
+        os  << ", \"iterations\": " << result.iterations
+            << ", \"min_ns\": " << result.minNs
+            << ", \"median_ns\": " << result.medianNs
+            << ", \"mean_ns\": " << result.meanNs
+            << ", \"rate\": " << result.rate
+            << ", \"rate_unit\": " << quote(result.rateUnit) << " }"
+            << (i + 1 < m_results.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+}
+
+void Benchmark::record(const std::string& name, const BenchmarkParams& params, const double work, const char* rateUnit, std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+
+    BenchmarkResult result;
+    result.name = name;
+    result.params = params;
+    result.iterations = samples.size();
+    result.minNs = samples.front();
+    result.medianNs = samples[samples.size() / 2];
+    result.meanNs = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    result.rate = result.medianNs > 0.0 ? work / (result.medianNs * 1e-9) : 0.0;
+    result.rateUnit = rateUnit;
+
+    // progress for whoever watches the CI log, the results themselves may be going to stdout
+    std::cerr << name;
+    for (const auto& param : params)
+    {
+        std::cerr << ' ' << param.first << '=' << param.second;
+    }
+    std::cerr << ": " << result.medianNs * 1e-3 << "us median, " << result.rate << ' ' << rateUnit << '\n';
+
+    m_results.push_back(std::move(result));
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Name / value pairs telling cases of one benchmark apart, e.g. { "kernel", "avx2" }, { "n", "4096" }
+using BenchmarkParams = std::vector<std::pair<std::string, std::string>>;
+
+struct BenchmarkResult
+{
+    std::string     name;
+    BenchmarkParams params;
+    size_t          iterations;
+    double          minNs;
+    double          medianNs;
+    double          meanNs;
+    double          rate;       // work per second at the median
+    std::string     rateUnit;
+};
+
+// Repeats each case until it ran for a minimum time and iteration count, after one untimed warm-up iteration.
+// The median is what to track between commits, min and mean only hint at how noisy the machine was
+class Benchmark
+{
+public:
+    Benchmark(const double minSeconds, const size_t minIterations, const std::string& filter);
+
+    bool isEnabled(const std::string& name) const;
+
+    // One call of `iteration` processes `work` units, reported as `rateUnit` per second
+    template <class Func>
+    void run(const std::string& name, const BenchmarkParams& params, const double work, const char* rateUnit, const Func& iteration)
+    {
+        if (!isEnabled(name))
+        {
+            return;
+        }
+
+        iteration();
+
+        std::vector<double> samples;
+        const auto start = std::chrono::steady_clock::now();
+        auto elapsed = 0.0;
+        while (samples.size() < m_minIterations or elapsed < m_minSeconds)
+        {
+            const auto begin = std::chrono::steady_clock::now();
+            iteration();
+            const auto end = std::chrono::steady_clock::now();
+
+            samples.push_back(std::chrono::duration<double, std::nano>(end - begin).count());
+            elapsed = std::chrono::duration<double>(end - start).count();
+        }
+
+        record(name, params, work, rateUnit, std::move(samples));
+    }
+
+    const std::vector<BenchmarkResult>& results() const;
+
+    // Header line then one row per case, params joined as key=value;key=value
+    void writeCsv(std::ostream& os) const;
+
+    // { "context": { ... }, "results": [ ... ] }, `context` describes the machine, e.g. the device name
+    void writeJson(std::ostream& os, const BenchmarkParams& context) const;
+
+private:
+    void record(const std::string& name, const BenchmarkParams& params, const double work, const char* rateUnit, std::vector<double> samples);
+
+    std::vector<BenchmarkResult>    m_results;
+    double                          m_minSeconds;
+    size_t                          m_minIterations;
+    std::string                     m_filter;
+};
@@ -0,0 +1,391 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "../config.h"
+#include "../nbody/nbody.h"
+#include "../util/util.h"
+#include "Benchmark.h"
+#include "BenchOptions.h"
+
+namespace
+{
+
+constexpr vk::DeviceSize KiB = 1024;
+constexpr vk::DeviceSize MiB = 1024 * KiB;
+
+// Descriptor sets allocated, written and reset per descriptor_alloc iteration
+constexpr uint32_t DESCRIPTOR_SETS = 256;
+
+// Particles of the vertex buffers the recorded draws bind, the count does not change what is recorded
+constexpr size_t RECORD_PARTICLES = 1024;
+
+// The bench records with the default frames in flight, the offscreen target gets one image more like the app's does
+constexpr uint32_t HEADLESS_IMAGE_COUNT = config::FRAMES_IN_FLIGHT + 1;
+
+void benchForces(Benchmark& bench, const BenchOptions& options)
+{
+	for (auto count : options.sizes)
+	{
+		auto particles = uniformSphere(count, config::SEED);
+		Accelerations accelerations;
+		accelerations.resize(count);
+
+		for (auto kernel : { Kernel::Scalar, Kernel::SSE, Kernel::AVX2, Kernel::AVX512 })
+		{
+			if (!isSupported(kernel))
+			{
+				continue;
+			}
+
+			auto accelerate = forceKernel(kernel);
+			for (auto threads : options.threads)
+			{
+				bench.run(
+					"force", { { "kernel", toString(kernel) }, { "n", std::to_string(count) }, { "threads", std::to_string(threads) } },
+					static_cast<double>(count) * count, "interactions/s",
+					[&]() {
+						parallelFor(count, threads, [&](const size_t begin, const size_t end) {
+							accelerate(particles, config::SOFTENING, begin, end, accelerations);
+						});
+					}
+				);
+			}
+		}
+	}
+}
+
+// Instance, device and queues the Vulkan benchmarks share, no window and no validation layers so nothing but the driver is timed
+struct BenchDevice
+{
+	explicit BenchDevice(const std::string& name)
+	{
+		vk::ApplicationInfo appInfo("nbody_bench", VK_MAKE_VERSION(1, 0, 0), "No Engine", VK_MAKE_VERSION(1, 0, 0), VK_API_VERSION_1_0);
+		instance = vk::createInstanceUnique(vk::InstanceCreateInfo(vk::InstanceCreateFlags(), &appInfo));
+
+		for (const auto& device : instance->enumeratePhysicalDevices())
+		{
+			if (isDeviceSuitable(device, config::HEADLESS_DEVICE_EXTENSIONS) and std::string(device.getProperties().deviceName).find(name) != std::string::npos)
+			{
+				physicalDevice = device;
+				break;
+			}
+		}
+
+		if (!physicalDevice)
+		{
+			throw std::runtime_error("no suitable Vulkan device" + (name.empty() ? std::string() : " matching " + name));
+		}
+
+		QueueFamilyIndices indices(physicalDevice);
+		graphicsFamily = indices.graphics();
+		transferFamily = indices.transfer();
+
+		float queuePriority = 1.0f;
+		std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
+		for (auto family : std::set<uint32_t>{ indices.graphics(), indices.compute(), indices.transfer() })
+		{
+			queueCreateInfos.emplace_back(vk::DeviceQueueCreateFlags(), family, 1, &queuePriority);
+		}
+
+		vk::PhysicalDeviceFeatures deviceFeatures;
+		const auto features = physicalDevice.getFeatures();
+		deviceFeatures.pipelineStatisticsQuery = features.pipelineStatisticsQuery;
+		deviceFeatures.inheritedQueries = features.inheritedQueries;
+
+		vk::DeviceCreateInfo createInfo(
+			vk::DeviceCreateFlags(),
+			queueCreateInfos.size(), queueCreateInfos.data(),
+			0, nullptr,
+			config::HEADLESS_DEVICE_EXTENSIONS.size(), config::HEADLESS_DEVICE_EXTENSIONS.data(),
+			&deviceFeatures
+		);
+		device = physicalDevice.createDeviceUnique(createInfo);
+	}
+
+	~BenchDevice()
+	{
+		device->waitIdle();
+	}
+
+	BenchmarkParams context() const
+	{
+		auto properties = physicalDevice.getProperties();
+
+		return {
+			{ "device", properties.deviceName },
+			{ "vendor_id", std::to_string(properties.vendorID) },
+			{ "driver_version", std::to_string(properties.driverVersion) },
+			{ "api_version", std::to_string(VK_VERSION_MAJOR(properties.apiVersion)) + '.' + std::to_string(VK_VERSION_MINOR(properties.apiVersion)) + '.' + std::to_string(VK_VERSION_PATCH(properties.apiVersion)) },
+		};
+	}
+
+	// Concurrent sharing between graphics and transfer when those differ
+	std::vector<uint32_t> uploadFamilies() const
+	{
+		return graphicsFamily == transferFamily ? std::vector<uint32_t>() : std::vector<uint32_t>{ graphicsFamily, transferFamily };
+	}
+
+// Order of fields is important for destructors
+	vk::UniqueInstance 	instance;
+	vk::PhysicalDevice 	physicalDevice;
+	vk::UniqueDevice 	device;
+	uint32_t 			graphicsFamily = 0;
+	uint32_t 			transferFamily = 0;
+};
+
+void benchBuffers(Benchmark& bench, const BenchDevice& ctx)
+{
+	const std::pair<const char*, vk::MemoryPropertyFlags> memories[] = {
+		{ "device_local", vk::MemoryPropertyFlagBits::eDeviceLocal },
+		{ "host_visible", vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent },
+	};
+	const auto usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst;
+
+	for (const auto& memory : memories)
+	{
+		// MemoryAllocator gives empty blocks back to the driver, keeping one buffer alive measures
+		// the sub-allocation path buffers normally take instead of a vkAllocateMemory per iteration
+		BoundedBuffer anchor(ctx.physicalDevice, *ctx.device, 4 * KiB, usage, memory.second);
+
+		for (auto size : { 4 * KiB, 256 * KiB, 4 * MiB })
+		{
+			bench.run(
+				"buffer_create", { { "memory", memory.first }, { "bytes", std::to_string(size) } },
+				1.0, "buffers/s",
+				[&]() {
+					BoundedBuffer buffer(ctx.physicalDevice, *ctx.device, size, usage, memory.second);
+				}
+			);
+		}
+	}
+}
+
+void benchUploads(Benchmark& bench, const BenchDevice& ctx)
+{
+	UploadManager uploads(ctx.physicalDevice, *ctx.device, ctx.transferFamily, config::STAGING_SIZE);
+
+	// the largest size does not fit the staging ring and is streamed through it in pieces
+	for (auto size : { 64 * KiB, 1 * MiB, config::STAGING_SIZE / 2, 4 * config::STAGING_SIZE })
+	{
+		BoundedBuffer dest(
+			ctx.physicalDevice, *ctx.device, size,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eDeviceLocal, ctx.uploadFamilies()
+		);
+		std::vector<char> data(size, 1);
+
+		bench.run(
+			"upload", { { "bytes", std::to_string(size) } },
+			static_cast<double>(size), "bytes/s",
+			[&]() {
+				uploads.upload(dest.buffer(), 0, data.data(), size);
+				uploads.wait(uploads.flush());
+			}
+		);
+	}
+}
+
+void benchDescriptors(Benchmark& bench, const BenchDevice& ctx)
+{
+	// the layout of Compute's particle sets, three storage buffers
+	const vk::DescriptorSetLayoutBinding bindings[] = {
+		{ 0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute },
+		{ 1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute },
+		{ 2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute },
+	};
+	auto layout = ctx.device->createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo(vk::DescriptorSetLayoutCreateFlags(), 3, bindings));
+
+	vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, 3 * DESCRIPTOR_SETS);
+	auto pool = ctx.device->createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo(vk::DescriptorPoolCreateFlags(), DESCRIPTOR_SETS, 1, &poolSize));
+
+	BoundedBuffer buffer(ctx.physicalDevice, *ctx.device, 96 * KiB, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	const vk::DescriptorBufferInfo bufferInfos[] = {
+		{ buffer.buffer(), 0, 32 * KiB },
+		{ buffer.buffer(), 32 * KiB, 32 * KiB },
+		{ buffer.buffer(), 64 * KiB, 32 * KiB },
+	};
+
+	std::vector<vk::DescriptorSetLayout> layouts(DESCRIPTOR_SETS, *layout);
+	std::vector<vk::WriteDescriptorSet> writes;
+	writes.reserve(3 * DESCRIPTOR_SETS);
+
+	bench.run(
+		"descriptor_alloc", { { "sets", std::to_string(DESCRIPTOR_SETS) } },
+		DESCRIPTOR_SETS, "sets/s",
+		[&]() {
+			auto sets = ctx.device->allocateDescriptorSets(vk::DescriptorSetAllocateInfo(*pool, layouts.size(), layouts.data()));
+
+			writes.clear();
+			for (const auto& set : sets)
+			{
+				writes.emplace_back(set, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfos[0]);
+				writes.emplace_back(set, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfos[1]);
+				writes.emplace_back(set, 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfos[2]);
+			}
+			ctx.device->updateDescriptorSets(writes, {});
+
+			ctx.device->resetDescriptorPool(*pool);
+		}
+	);
+}
+
+void benchRecording(Benchmark& bench, const BenchOptions& options, const BenchDevice& ctx)
+{
+	auto particles = uniformSphere(RECORD_PARTICLES, config::SEED);
+
+	PipelineCache pipelineCache(ctx.physicalDevice, *ctx.device, config::PIPELINE_CACHE_DIRECTORY);
+	Offscreen target(
+		*ctx.device, ctx.physicalDevice, ctx.graphicsFamily,
+		vk::Extent2D(config::WIDTH, config::HEIGHT), config::HEADLESS_FORMAT, HEADLESS_IMAGE_COUNT
+	);
+	HostParticles source(ctx.physicalDevice, *ctx.device, particles, config::FRAMES_IN_FLIGHT);
+
+	// What a frame records before its submit, cull pass and one draw per recording thread, nothing is submitted
+	for (auto threads : options.threads)
+	{
+		Graphics graphics(*ctx.device, target, ctx.graphicsFamily, ctx.physicalDevice, source, pipelineCache, ParticleStyle::Billboards, true, threads);
+		uint32_t frame = 0;
+
+		bench.run(
+			"record", { { "threads", std::to_string(threads) } },
+			1.0, "frames/s",
+			[&]() {
+				graphics.record(frame % target.imageCount(), frame % config::FRAMES_IN_FLIGHT, 0);
+				++frame;
+			}
+		);
+	}
+}
+
+// Whole headless frames, acquire to fence, so particle styles and culling are compared on the same N
+void benchDraws(Benchmark& bench, const BenchOptions& options, const BenchDevice& ctx)
+{
+	if (!bench.isEnabled("draw"))
+	{
+		return;
+	}
+
+	PipelineCache pipelineCache(ctx.physicalDevice, *ctx.device, config::PIPELINE_CACHE_DIRECTORY);
+	Offscreen target(
+		*ctx.device, ctx.physicalDevice, ctx.graphicsFamily,
+		vk::Extent2D(config::WIDTH, config::HEIGHT), config::HEADLESS_FORMAT, HEADLESS_IMAGE_COUNT
+	);
+
+	auto acquired = ctx.device->createSemaphoreUnique(vk::SemaphoreCreateInfo());
+	auto rendered = ctx.device->createSemaphoreUnique(vk::SemaphoreCreateInfo());
+	auto fence = ctx.device->createFenceUnique(vk::FenceCreateInfo());
+
+	for (auto count : options.sizes)
+	{
+		auto particles = uniformSphere(count, config::SEED);
+		HostParticles source(ctx.physicalDevice, *ctx.device, particles, 1);
+		source.upload(0);
+
+		for (auto style : { ParticleStyle::Points, ParticleStyle::Billboards })
+		{
+			for (auto cull : { false, true })
+			{
+				Graphics graphics(*ctx.device, target, ctx.graphicsFamily, ctx.physicalDevice, source, pipelineCache, style, cull);
+
+				bench.run(
+					"draw", { { "style", toString(style) }, { "cull", cull ? "on" : "off" }, { "n", std::to_string(count) } },
+					static_cast<double>(count), "particles/s",
+					[&]() {
+						uint32_t imageIndex;
+						target.acquireNextImage(*acquired, imageIndex);
+						graphics.render(*acquired, *rendered, *fence, imageIndex, 0, 0);
+						target.present(*rendered, imageIndex);
+
+						ctx.device->waitForFences({ *fence }, VK_TRUE, std::numeric_limits<uint64_t>::max());
+						ctx.device->resetFences({ *fence });
+					}
+				);
+
+				target.await();
+			}
+		}
+	}
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	try
+	{
+		options = parseBenchOptions(argc, argv);
+	}
+	catch (const std::exception &err)
+	{
+		std::cerr << err.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// the util classes log to std::cout, keep stdout for the results alone
+	std::ostream results(std::cout.rdbuf());
+	std::cout.rdbuf(std::cerr.rdbuf());
+
+	Benchmark bench(options.minSeconds, options.minIterations, options.filter);
+	BenchmarkParams context = {
+		{ "best_kernel", toString(bestKernel()) },
+		{ "hardware_threads", std::to_string(std::thread::hardware_concurrency()) },
+	};
+
+	try
+	{
+		benchForces(bench, options);
+
+		if (!options.cpuOnly)
+		{
+			BenchDevice device(options.device);
+			auto deviceContext = device.context();
+			context.insert(context.end(), deviceContext.begin(), deviceContext.end());
+
+			benchBuffers(bench, device);
+			benchUploads(bench, device);
+			benchDescriptors(bench, device);
+			benchRecording(bench, options, device);
+			benchDraws(bench, options, device);
+		}
+	}
+	catch (const std::exception &err)
+	{
+		std::cerr << err.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream file;
+	if (!options.outputPath.empty())
+	{
+		file.open(options.outputPath);
+		if (!file)
+		{
+			std::cerr << "could not open " << options.outputPath << std::endl;
+			return EXIT_FAILURE;
+		}
+		results.rdbuf(file.rdbuf());
+	}
+
+	if (options.format == "csv")
+	{
+		bench.writeCsv(results);
+	}
+	else
+	{
+		bench.writeJson(results, context);
+	}
+	results.flush();
+
+	return EXIT_SUCCESS;
+}
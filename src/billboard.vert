@@ -0,0 +1,38 @@
+#version 450
+
+// FrameConstants, one slice of the ring per frame in flight
+layout (binding = 0) uniform Frame
+{
+    mat4 transform;
+    vec4 camera;
+    float time;
+    float dt;
+    uint particleCount;
+    float rewind;
+    vec2 billboardScale;
+} uFrame;
+
+// Per instance, one particle each
+layout (location = 0) in vec4 iPosition;
+layout (location = 1) in vec3 iVelocity;
+
+layout (location = 0) out vec3 oFragColor;
+layout (location = 1) out vec2 oCorner;
+
+const vec3 SLOW_COLOR = vec3(0.3, 0.5, 1.0);
+const vec3 FAST_COLOR = vec3(1.0, 0.6, 0.2);
+
+// Quad corners, the index buffer turns them into two triangles
+const vec2 CORNERS[4] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main()
+{
+    const vec2 corner = CORNERS[gl_VertexIndex];
+
+    // Offset in clip space before the perspective divide, so the quad always faces the camera and shrinks with distance
+    gl_Position = uFrame.transform * vec4(iPosition.xyz + iVelocity * uFrame.rewind, 1.0);
+    gl_Position.xy += corner * uFrame.billboardScale;
+
+    oFragColor = mix(SLOW_COLOR, FAST_COLOR, clamp(length(iVelocity), 0.0, 1.0));
+    oCorner = corner;
+}
@@ -11,7 +11,76 @@ namespace config
 constexpr uint32_t WIDTH = 640;
 constexpr uint32_t HEIGHT = 480;
 constexpr const char* NAME = "triangle";
-constexpr unsigned int MAX_FRAMES_IN_FLIGHT = 2;
+
+// Frames the CPU records ahead of the GPU, --frames-in-flight picks up to MAX_FRAMES_IN_FLIGHT
+constexpr unsigned int FRAMES_IN_FLIGHT = 2;
+constexpr unsigned int MAX_FRAMES_IN_FLIGHT = 4;
+
+// Least time FramePacer spins ahead of a frame deadline instead of sleeping, more once sleeps overshoot further
+constexpr uint32_t PACING_SPIN_MICROSECONDS = 500;
+
+constexpr size_t PARTICLE_COUNT = 8192;
+constexpr uint32_t SEED = 42;
+constexpr float SOFTENING = 0.05f;
+constexpr float TIME_STEP = 0.002f;
+
+// Simulation steps per second of frame time, each one TIME_STEP of simulated time, and how many one frame may catch up on
+constexpr double STEP_RATE = 60.0;
+constexpr uint32_t MAX_SUBSTEPS = 4;
+constexpr float THETA = 0.5f;
+
+// World space radius of a billboard, the particle set starts out as a unit ball
+constexpr float PARTICLE_SIZE = 0.01f;
+
+// Trajectory recording - a frame every TRAJECTORY_EVERY steps with positions quantized to TRAJECTORY_BITS per coordinate,
+// a fresh quantization box at least every TRAJECTORY_KEYFRAME_INTERVAL frames, and at most TRAJECTORY_QUEUE_DEPTH frames waiting to be encoded
+constexpr uint64_t TRAJECTORY_EVERY = 10;
+constexpr uint32_t TRAJECTORY_BITS = 16;
+constexpr uint32_t TRAJECTORY_KEYFRAME_INTERVAL = 32;
+constexpr uint32_t TRAJECTORY_QUEUE_DEPTH = 4;
+
+// Playback - recorded frames decoded ahead of the playhead on top of the ones the frames in flight copy from,
+// and the share of the recording the arrow keys seek by
+constexpr uint32_t PLAYBACK_PREFETCH_FRAMES = 3;
+constexpr double PLAYBACK_SEEK_FRACTION = 0.05;
+
+// Particle buffers the GPU engine cycles through, step N + 1 is computed while step N is drawn
+constexpr uint32_t PARTICLE_BUFFERS = 2;
+
+// Threads recording a frame's secondary command buffers, the draw is split into as many particle chunks
+constexpr uint32_t RECORD_THREADS = 2;
+
+// Timestamp pairs kept per queue, enough to outlive the frames in flight and the steps queued behind them
+constexpr uint32_t TIMER_RING = MAX_FRAMES_IN_FLIGHT + PARTICLE_BUFFERS + 2;
+
+// Samples GpuProfiler keeps per scope for its min / avg / p99
+constexpr size_t PROFILER_WINDOW = 256;
+
+// Compute shader specialization until Autotuner has measured the device - workgroup size and the positions nbody.comp stages in shared memory per pass
+constexpr uint32_t COMPUTE_WORKGROUP_SIZE = 256;
+constexpr uint32_t COMPUTE_TILE_SIZE = 256;
+
+// Tuned specialization per device and driver, kept next to the pipeline caches
+constexpr const char* AUTOTUNE_FILE = "compute-tuning.txt";
+
+// Particles Autotuner times on at most. Every dispatch is O(N^2), and once the device is saturated the ranking of
+// workgroup and tile sizes no longer depends on N
+constexpr uint32_t AUTOTUNE_PARTICLES = 65536;
+
+// vk::DeviceMemory block size MemoryAllocator sub-allocates from, capped at an eighth of the heap
+constexpr vk::DeviceSize MEMORY_BLOCK_SIZE = 64 * 1024 * 1024;
+
+// Staging ring of UploadManager, bigger uploads are streamed through it in pieces
+constexpr vk::DeviceSize STAGING_SIZE = 16 * 1024 * 1024;
+
+// Where pipeline-cache-<vendor>-<device>.bin files are kept between runs
+constexpr const char* PIPELINE_CACHE_DIRECTORY = ".";
+
+// Shaders are compiled in, a directory in this environment variable overrides them with its .spv files
+constexpr const char* SHADER_DIRECTORY_VARIABLE = "NBODY_SHADER_DIR";
+
+constexpr uint64_t HEADLESS_FRAMES = 1000;
+constexpr vk::Format HEADLESS_FORMAT = vk::Format::eR8G8B8A8Unorm;
 
 const std::vector<const char *> VALIDATION_LAYERS =
 {
@@ -23,4 +92,6 @@ const std::vector<const char *> DEVICE_EXTENSIONS =
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+const std::vector<const char *> HEADLESS_DEVICE_EXTENSIONS = {};
+
 }
\ No newline at end of file
@@ -1,11 +1,16 @@
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <csignal>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <optional>
 #include <set>
 #include <stdexcept>
@@ -20,6 +25,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "config.h"
+#include "nbody/nbody.h"
 #include "util/util.h"
 
 class VkError : public std::runtime_error
@@ -73,44 +79,78 @@ private:
 	const char *m_extensionName;
 };
 
-const std::array<Vertex, 4> g_vertecies
-{
-    Vertex{ {-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-	Vertex{ { 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-    Vertex{ { 0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}},
-    Vertex{ {-0.5f,  0.5f}, {1.0f, 1.0f, 1.0f}}
-};
-
-const std::array<uint16_t, 6> g_indices
-{
-	0, 1, 2, 2, 3, 0
-};
+// Set from the SIGUSR1 handler, the main loop dumps the frame stats when it sees it
+std::atomic<bool> g_dumpStats(false);
 
 class HelloTriangleApp
 {
 public:
+	HelloTriangleApp(const Options& options)
+		: m_deletions(options.framesInFlight), m_pacer(options.fps), m_clock(timeSource(options), 1.0 / options.stepRate, options.maxSubsteps), m_options(options)
+	{
+	}
+
 	void run()
 	{
-		initWindow();
+		if (m_options.autotune)
+		{
+			initDevice();
+			computeTuning(m_options.particles);
+			return;
+		}
+
+		if (!m_options.headless)
+		{
+			initWindow();
+		}
+		createEngine();
 		initVulkan();
+		createTrajectory();
 		mainLoop();
 	}
 
 	~HelloTriangleApp()
 	{
-		m_device->waitIdle();
+		if (m_device)
+		{
+			m_device->waitIdle();
+		}
 
-		glfwDestroyWindow(m_window);
-		glfwTerminate();
+		if (!m_options.headless)
+		{
+			glfwDestroyWindow(m_window);
+			glfwTerminate();
+		}
 	}
 
 private:
+	static std::unique_ptr<TimeSource> timeSource(const Options& options)
+	{
+		if (options.virtualFps > 0.0)
+		{
+			return std::make_unique<VirtualTimeSource>(1.0 / options.virtualFps);
+		}
+
+		return std::make_unique<SteadyTimeSource>();
+	}
+
 	static void glfwFramebufferResize(GLFWwindow* window, int w, int h)
 	{
 		auto app = reinterpret_cast<HelloTriangleApp*>(glfwGetWindowUserPointer(window));
 		app->m_windowSizeChanged = true;
 	}
 
+	static void glfwKey(GLFWwindow* window, int key, int scancode, int action, int mods)
+	{
+		onKeyPress(window, key, scancode, action, mods);
+
+		auto app = reinterpret_cast<HelloTriangleApp*>(glfwGetWindowUserPointer(window));
+		if (app->isPlayback() and action == GLFW_PRESS)
+		{
+			app->controlPlayback(key);
+		}
+	}
+
 	void initWindow()
 	{
 		glfwInit();
@@ -120,10 +160,139 @@ private:
 
 		m_window = glfwCreateWindow(config::WIDTH, config::HEIGHT, config::NAME, nullptr, nullptr);
 		glfwSetWindowUserPointer(m_window, this);
-		glfwSetKeyCallback(m_window, &onKeyPress);
+		glfwSetKeyCallback(m_window, &glfwKey);
 		glfwSetFramebufferSizeCallback(m_window, &glfwFramebufferResize);
 	}
 
+	bool isGpuEngine() const
+	{
+		return m_options.engine == "gpu";
+	}
+
+	bool isPlayback() const
+	{
+		return !m_options.playbackPath.empty();
+	}
+
+	// Space pauses, left and right seek, up and down double and halve the speed, R reverses, Home starts over
+	void controlPlayback(const int key)
+	{
+		// the speed to resume with while paused
+		auto& speed = m_pausedSpeed != 0.0 ? m_pausedSpeed : m_playbackSpeed;
+		const auto seekBy = config::PLAYBACK_SEEK_FRACTION * (m_playback.endTime() - m_playback.startTime());
+
+		switch (key)
+		{
+		case GLFW_KEY_SPACE:
+			std::swap(m_playbackSpeed, m_pausedSpeed);
+			break;
+		case GLFW_KEY_LEFT:
+			m_playback.seek(m_playback.time() - seekBy);
+			break;
+		case GLFW_KEY_RIGHT:
+			m_playback.seek(m_playback.time() + seekBy);
+			break;
+		case GLFW_KEY_UP:
+			speed *= 2.0;
+			break;
+		case GLFW_KEY_DOWN:
+			speed *= 0.5;
+			break;
+		case GLFW_KEY_R:
+			speed = -speed;
+			break;
+		case GLFW_KEY_HOME:
+			m_playback.seek(speed < 0.0 ? m_playback.endTime() : m_playback.startTime());
+			break;
+		default:
+			return;
+		}
+
+		m_playback.setSpeed(m_playbackSpeed);
+		std::cout << "Playback: t = " << m_playback.time() << ", speed " << m_playbackSpeed << '\n';
+	}
+
+	void restoreCheckpoint()
+	{
+		m_restored = MappedCheckpoint(m_options.restorePath);
+
+		const auto info = m_restored.info();
+		m_firstStep = info.step;
+		m_firstTime = info.time;
+
+		std::cout << "Restored " << m_restored.size() << " particles at step " << info.step << " (t = " << info.time << ") from " << m_options.restorePath;
+		if (!info.engine.empty())
+		{
+			std::cout << ", saved by the " << info.engine << " engine";
+		}
+		std::cout << '\n';
+
+		if (info.dt != config::TIME_STEP or info.softening != config::SOFTENING)
+		{
+			std::cout << "Warning: checkpoint was integrated with dt " << info.dt << " and softening " << info.softening << ", continuing with " << config::TIME_STEP << " and " << config::SOFTENING << '\n';
+		}
+	}
+
+	void createEngine()
+	{
+		// drawn straight from the recording, see createParticleSource
+		if (isPlayback())
+		{
+			return;
+		}
+
+		if (!m_options.restorePath.empty())
+		{
+			restoreCheckpoint();
+		}
+
+		if (!m_options.checkpointPath.empty())
+		{
+			m_checkpoints = std::make_unique<CheckpointWriter>();
+			m_nextCheckpoint = m_options.checkpointEvery;
+		}
+
+		const auto distribution = parseDistribution(m_options.initial.c_str());
+
+		if (isGpuEngine())
+		{
+			// stepped on the device, see createParticleSource. A restored checkpoint stays mapped until it is uploaded,
+			// generated initial conditions never touch the host
+			if (m_restored)
+			{
+				std::cout << "GPU engine: " << m_restored.size() << " particles\n";
+			}
+			else
+			{
+				std::cout << "GPU engine: " << m_options.particles << " particles, " << toString(distribution) << " generated on the device\n";
+			}
+			return;
+		}
+
+		auto particles = m_restored ? m_restored.particles() : generateParticles(distribution, m_options.particles, m_options.seed, m_options.threads);
+		m_restored = MappedCheckpoint();
+		const auto count = particles.size();
+
+		if (m_options.engine == "barnes-hut")
+		{
+			m_engine = std::make_unique<BarnesHutEngine>(std::move(particles), config::SOFTENING, m_options.theta, m_options.threads);
+
+			std::cout << "Barnes-Hut engine: " << count << " particles, theta " << m_options.theta << ", " << m_options.threads << " threads\n";
+		}
+		else if (m_options.engine == "direct")
+		{
+			auto kernel = m_options.kernel.empty() ? bestKernel() : parseKernel(m_options.kernel.c_str());
+
+			m_engine = std::make_unique<DirectEngine>(std::move(particles), config::SOFTENING, kernel, m_options.threads);
+
+			std::cout << "Direct engine: " << count << " particles, " << toString(kernel) << " kernel, " << m_options.threads << " threads\n";
+		}
+		else
+		{
+			throw std::invalid_argument("unknown engine: " + m_options.engine);
+		}
+	}
+
 	void createInstance()
 	{
 		vk::ApplicationInfo appInfo(
@@ -134,7 +303,7 @@ private:
 			VK_API_VERSION_1_0
 		);
 
-		auto exts = getRequiredExtensions();
+		auto exts = m_options.headless ? getHeadlessExtensions() : getRequiredExtensions();
 		vk::InstanceCreateInfo instInfo(
 			vk::InstanceCreateFlags(),
 			&appInfo,
@@ -221,7 +390,10 @@ private:
 
 		for (const auto &device : devices)
 		{
-			if (isDeviceSuitable(device, m_renderSurface.get(), config::DEVICE_EXTENSIONS))
+			auto isSuitable = m_options.headless 
+				? isDeviceSuitable(device, deviceExtensions()) 
+				: isDeviceSuitable(device, m_renderSurface.get(), deviceExtensions());
+			if (isSuitable)
 			{
 				m_physicalDevice = device;
 				return;
@@ -231,51 +403,77 @@ private:
 		throw std::runtime_error("failed to find a suitable GPU!");
 	}
 
+	const std::vector<const char *>& deviceExtensions() const
+	{
+		return m_options.headless ? config::HEADLESS_DEVICE_EXTENSIONS : config::DEVICE_EXTENSIONS;
+	}
+
+	QueueFamilyIndices queueFamilies() const
+	{
+		return m_options.headless ? QueueFamilyIndices(m_physicalDevice) : QueueFamilyIndices(m_physicalDevice, *m_renderSurface);
+	}
+
 	void createLogicalDevice()
 	{
-		auto indices = QueueFamilyIndices(m_physicalDevice, *m_renderSurface);
+		auto indices = queueFamilies();
 
 		std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
 
-		std::set<uint32_t> uniqueQueueFamilies = {indices.graphics(), indices.present()};
-		float queuePriority = 1.0f;
+		std::set<uint32_t> uniqueQueueFamilies = {indices.graphics(), indices.present(), indices.compute(), indices.transfer()};
+		const float queuePriorities[] = { 1.0f, 1.0f };
 		vk::DeviceQueueCreateInfo queueCreateInfo(
 			vk::DeviceQueueCreateFlags(),
 			0, 
-			1, &queuePriority
+			1, queuePriorities
 		);
 		for (const auto &family : uniqueQueueFamilies)
 		{
+			// the compute queue is the second one of the family when it shares it with graphics
 			queueCreateInfo.queueFamilyIndex = family;
+			queueCreateInfo.queueCount = family == indices.compute() ? indices.computeQueue() + 1 : 1;
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
 		vk::PhysicalDeviceFeatures deviceFeatures;
+		// GpuProfiler adds pipeline statistics when available, Graphics needs them to stay active across its secondaries
+		const auto features = m_physicalDevice.getFeatures();
+		deviceFeatures.pipelineStatisticsQuery = features.pipelineStatisticsQuery;
+		deviceFeatures.inheritedQueries = features.inheritedQueries;
 
 		vk::DeviceCreateInfo createInfo(
 			vk::DeviceCreateFlags(),
 			queueCreateInfos.size(), queueCreateInfos.data(),
 			config::VALIDATION_LAYERS.size(), config::VALIDATION_LAYERS.data(),
-			config::DEVICE_EXTENSIONS.size(), config::DEVICE_EXTENSIONS.data(),
+			deviceExtensions().size(), deviceExtensions().data(),
 			&deviceFeatures
 		);
 		m_device = m_physicalDevice.createDeviceUnique(createInfo);
-
-		m_computeQueue = m_device->getQueue(indices.compute(), 0);
 	}
 
-	void createPresent()
+	void createPresent(const vk::SwapchainKHR& oldSwapchain = vk::SwapchainKHR())
 	{
-		m_present = Present(*m_device, m_physicalDevice, *m_renderSurface, m_window);
+		if (m_options.headless)
+		{
+			m_present = std::make_unique<Offscreen>(
+				*m_device, m_physicalDevice, queueFamilies().graphics(),
+				vk::Extent2D(config::WIDTH, config::HEIGHT), config::HEADLESS_FORMAT, m_options.framesInFlight + 1
+			);
+		}
+		else
+		{
+			m_present = std::make_unique<Present>(*m_device, m_physicalDevice, *m_renderSurface, m_window, parsePresentMode(m_options.presentMode), oldSwapchain);
+		}
 	}
 
 	void createSyncObjects()
 	{
-		auto count = config::MAX_FRAMES_IN_FLIGHT;
+		auto count = m_options.framesInFlight;
 
 		m_imageAvailable.resize(count);
 		m_renderCompleted.resize(count);
 		m_inFlightImages.resize(count);
+		m_inputTimes.resize(count);
+		m_isLatencyPending.assign(count, false);
 
 		auto semaphoreInfo = vk::SemaphoreCreateInfo();
 		vk::FenceCreateInfo fenceInfo(vk::FenceCreateFlags(vk::FenceCreateFlagBits::eSignaled));
@@ -297,19 +495,280 @@ private:
 			glfwWaitEvents();
 		}
 
-		m_device->waitIdle();
+		// No waitIdle - frames in flight finish on the retired swapchain, which the new one takes over from.
+		// It and everything built on it go once those frames' fences have been waited on
+		std::shared_ptr<RenderTarget> retired = std::move(m_present);
+		createPresent(static_cast<const Present&>(*retired).swapchain());
+		m_deletions.retire([retired]() mutable { retired.reset(); });
 
-		createPresent();
-		m_graphics.update(m_present);
+		m_graphics.update(*m_present, m_deletions);
+	}
+
+	void createUploads()
+	{
+		m_uploads = UploadManager(m_physicalDevice, *m_device, queueFamilies().transfer(), config::STAGING_SIZE);
+	}
+
+	// Saved for this device and driver, measured on the spot the first time or when asked to, for `count` simulated particles
+	ComputeTuning computeTuning(const size_t count) const
+	{
+		const auto indices = queueFamilies();
+		Autotuner tuner(m_physicalDevice, *m_device, indices.compute(), indices.computeQueue(), m_pipelineCache);
+
+		if (!m_options.autotune)
+		{
+			if (auto saved = tuner.load())
+			{
+				std::cout << "Compute kernels: " << saved->toString() << '\n';
+				return *saved;
+			}
+		}
+
+		return tuner.tune(static_cast<uint32_t>(count));
+	}
+
+	void createParticleSource()
+	{
+		auto indices = queueFamilies();
+
+		if (isPlayback())
+		{
+			m_playback = Playback(
+				m_physicalDevice, *m_device, m_options.playbackPath,
+				m_options.framesInFlight, m_options.framesInFlight + config::PLAYBACK_PREFETCH_FRAMES,
+				m_options.stepRate * config::TIME_STEP, m_options.threads
+			);
+			m_playbackSpeed = m_options.playbackSpeed;
+			m_playback.setSpeed(m_playbackSpeed);
+			m_playback.seekStep(m_options.playbackFrom);
+
+			std::cout << "Playback: " << m_playback.count() << " particles, " << m_playback.frameCount() << " recorded frames from t = "
+				<< m_playback.startTime() << " to " << m_playback.endTime() << " in " << m_options.playbackPath << '\n';
+		}
+		else if (isGpuEngine())
+		{
+			if (m_restored)
+			{
+				m_compute = Compute(
+					*m_device, m_physicalDevice, indices.compute(), indices.computeQueue(), indices.graphics(), 
+					m_restored.columns(), config::SOFTENING, config::TIME_STEP, config::PARTICLE_BUFFERS, m_uploads, m_pipelineCache,
+					computeTuning(m_restored.columns().count)
+				);
+
+				// the staging ring holds its own copy of whatever did not reach the GPU yet
+				m_restored = MappedCheckpoint();
+			}
+			else
+			{
+				m_compute = Compute(
+					*m_device, m_physicalDevice, indices.compute(), indices.computeQueue(), indices.graphics(), 
+					parseDistribution(m_options.initial.c_str()), m_options.particles, m_options.seed,
+					config::SOFTENING, config::TIME_STEP, config::PARTICLE_BUFFERS, m_pipelineCache,
+					computeTuning(m_options.particles)
+				);
+			}
+
+			if (indices.isComputeQueueShared())
+			{
+				std::cout << "Compute and graphics share the device's only queue, steps and draws run one after the other\n";
+			}
+			m_overlap.setSharedQueue(indices.isComputeQueueShared());
+
+			// the first frame draws step 0, every frame then overlaps its draw with the next step
+			m_compute.step();
+			++m_simulatedSteps;
+		}
+		else
+		{
+			// uploaded to after the frame fence, one buffer per frame in flight
+			m_hostParticles = HostParticles(m_physicalDevice, *m_device, m_engine->particles(), m_options.framesInFlight);
+		}
+	}
+
+	void createTrajectory()
+	{
+		if (m_options.trajectoryPath.empty())
+		{
+			return;
+		}
+
+		// the GPU engine's masses are only on the device, they never change
+		if (!m_engine)
+		{
+			m_compute.download(m_readbackFrame);
+		}
+		const auto columns = m_engine ? m_engine->particles().columns() : m_readbackFrame.columns();
+
+		TrajectorySettings settings;
+		settings.bits = m_options.trajectoryBits;
+		settings.keyframeInterval = config::TRAJECTORY_KEYFRAME_INTERVAL;
+		settings.stepsPerFrame = static_cast<uint32_t>(m_options.trajectoryEvery);
+		settings.dt = config::TIME_STEP;
+		settings.queueDepth = config::TRAJECTORY_QUEUE_DEPTH;
+		settings.threads = m_options.threads;
+
+		m_trajectory = std::make_unique<TrajectoryWriter>(m_options.trajectoryPath, std::vector<float>(columns.mass, columns.mass + columns.count), settings);
+	}
+
+	// The frame is dropped rather than waited for when the encoder is behind. CPU engines only, the GPU engine's frames
+	// come in through requestReadback()
+	void recordTrajectory()
+	{
+		m_trajectory->push(m_firstStep + m_simulatedSteps, simulatedTime(m_simulatedSteps), m_engine->particles());
+	}
+
+	// Whether the GPU step about to be submitted copies its state out for the trajectory or a checkpoint, in its own submission.
+	// A frame the writer has no slot for or a checkpoint while the last one is still being written is not even read back
+	void requestReadback()
+	{
+		Readback readback = { m_compute.steps(), m_simulatedSteps, false, false };
+
+		if (m_trajectory and m_simulatedSteps >= m_nextTrajectoryFrame)
+		{
+			const auto pending = std::count_if(m_readbacks.begin(), m_readbacks.end(), [](const Readback& r) { return r.isTrajectory; });
+			if (m_trajectory->freeSlots() > static_cast<size_t>(pending))
+			{
+				readback.isTrajectory = true;
+			}
+			else
+			{
+				m_trajectory->drop();
+			}
+			m_nextTrajectoryFrame = (m_simulatedSteps / m_options.trajectoryEvery + 1) * m_options.trajectoryEvery;
+		}
+
+		if (m_checkpoints and m_options.checkpointEvery and m_simulatedSteps >= m_nextCheckpoint)
+		{
+			const auto isPending = std::any_of(m_readbacks.begin(), m_readbacks.end(), [](const Readback& r) { return r.isCheckpoint; });
+			if (isPending or m_checkpoints->isBusy())
+			{
+				std::cout << "Checkpoint at step " << m_firstStep + m_simulatedSteps << " skipped, still writing the previous one\n";
+			}
+			else
+			{
+				readback.isCheckpoint = true;
+			}
+			m_nextCheckpoint = (m_simulatedSteps / m_options.checkpointEvery + 1) * m_options.checkpointEvery;
+		}
+
+		if (!readback.isTrajectory and !readback.isCheckpoint)
+		{
+			return;
+		}
+
+		// steps bufferCount() or more earlier used the same readback buffer, long done by now
+		while (!m_readbacks.empty() and readback.step - m_readbacks.front().step >= m_compute.bufferCount())
+		{
+			takeReadback();
+		}
+
+		m_compute.requestReadback();
+		m_readbacks.push_back(readback);
+	}
+
+	// Hands the oldest readback to the writers, waiting for it if it did not land yet
+	void takeReadback()
+	{
+		const auto readback = m_readbacks.front();
+		m_readbacks.pop_front();
+
+		m_compute.takeReadback(readback.step, m_readbackFrame);
+
+		if (readback.isTrajectory)
+		{
+			m_trajectory->push(m_firstStep + readback.simulatedSteps, simulatedTime(readback.simulatedSteps), m_readbackFrame);
+		}
+		if (readback.isCheckpoint)
+		{
+			m_checkpoints->save(m_options.checkpointPath, m_readbackFrame, checkpointInfo(readback.simulatedSteps));
+		}
+	}
+
+	// Readbacks that landed since the last look, in order
+	void collectReadbacks()
+	{
+		while (!m_readbacks.empty() and m_compute.isReadbackDone(m_readbacks.front().step))
+		{
+			takeReadback();
+		}
+	}
+
+	double simulatedTime(const uint64_t simulatedSteps) const
+	{
+		return m_firstTime + simulatedSteps * static_cast<double>(config::TIME_STEP);
+	}
+
+	CheckpointInfo checkpointInfo(const uint64_t simulatedSteps) const
+	{
+		CheckpointInfo ret;
+		ret.step = m_firstStep + simulatedSteps;
+		ret.time = simulatedTime(simulatedSteps);
+		ret.dt = config::TIME_STEP;
+		ret.softening = config::SOFTENING;
+		ret.theta = m_options.theta;
+		ret.engine = m_options.engine;
+		return ret;
+	}
+
+	// CPU engines only copy their columns. The GPU engine's periodic checkpoints come in through requestReadback(),
+	// its final one waits for the queue and reads the state back here.
+	// Skipped when the previous checkpoint is still being written, unless `isFinal`
+	void saveCheckpoint(const bool isFinal)
+	{
+		if (isFinal)
+		{
+			m_checkpoints->wait();
+		}
+		else if (m_checkpoints->isBusy())
+		{
+			std::cout << "Checkpoint at step " << m_firstStep + m_simulatedSteps << " skipped, still writing the previous one\n";
+			return;
+		}
+
+		if (m_engine)
+		{
+			m_checkpoints->save(m_options.checkpointPath, m_engine->particles(), checkpointInfo(m_simulatedSteps));
+		}
+		else
+		{
+			// download() goes through a readback buffer a pending readback may still hold
+			while (!m_readbacks.empty())
+			{
+				takeReadback();
+			}
+			m_compute.download(m_readbackFrame);
+			m_checkpoints->save(m_options.checkpointPath, m_readbackFrame, checkpointInfo(m_simulatedSteps));
+		}
+
+		if (isFinal)
+		{
+			m_checkpoints->wait();
+			std::cout << "Checkpoint at step " << m_firstStep + m_simulatedSteps << " written to " << m_options.checkpointPath << '\n';
+		}
+	}
+
+	const ParticleSource& particleSource() const
+	{
+		if (isPlayback())
+		{
+			return m_playback;
+		}
+
+		if (isGpuEngine())
+		{
+			return m_compute;
+		}
+
+		return m_hostParticles;
 	}
 
 	void createGraphics()
 	{
-		auto indices = QueueFamilyIndices(m_physicalDevice, *m_renderSurface);
-		m_graphics = Graphics(*m_device, m_present, indices.graphics(), m_physicalDevice);
+		auto indices = queueFamilies();
+		m_graphics = Graphics(*m_device, *m_present, indices.graphics(), m_physicalDevice, particleSource(), m_pipelineCache, parseParticleStyle(m_options.style), m_options.cull, m_options.recordThreads, m_options.framesInFlight);
 	}
 
-	void initVulkan()
+	void initDevice()
 	{
 		// basic vulkan library initialization
 		createInstance();
@@ -317,20 +776,46 @@ private:
 		setupDebugMessenger();
 		
 		// vulkan device interface initialization
-		createRenderSurface();
+		if (!m_options.headless)
+		{
+			createRenderSurface();
+		}
 		pickPhysicalDevice();
 		createLogicalDevice();
+		m_pipelineCache = PipelineCache(m_physicalDevice, *m_device, config::PIPELINE_CACHE_DIRECTORY);
+	}
+
+	void initVulkan()
+	{
+		initDevice();
 
 		// queues and operations
 		createPresent();
+		reportPacing();
+		createUploads();
+		createParticleSource();
 		createGraphics();
 		createSyncObjects();
 	}
 
+	void reportPacing() const
+	{
+		std::cout << "Pacing: " << m_options.framesInFlight << " frames in flight";
+		if (!m_options.headless)
+		{
+			std::cout << ", " << toString(static_cast<const Present&>(*m_present).presentMode()) << " present mode";
+		}
+		if (m_pacer.isEnabled())
+		{
+			std::cout << ", capped at " << m_options.fps << " fps";
+		}
+		std::cout << '\n';
+	}
+
 	uint32_t acquireNextImage(const vk::Semaphore& wait)
 	{
 		uint32_t imageIndex;
-		auto status = m_present.acquireNextImage(wait, imageIndex);
+		auto status = m_present->acquireNextImage(wait, imageIndex);
 		if (status == vk::Result::eErrorOutOfDateKHR)
 		{
 			recreatePresent();
@@ -348,13 +833,66 @@ private:
 	void drawFrame(const vk::Semaphore& wait, const vk::Semaphore& signal, const vk::Fence& hostNotify)
 	{
 		m_device->waitForFences(1, &hostNotify, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		stampCompletions();
 		m_device->resetFences(1, &hostNotify);
+		m_deletions.collect(m_frameCount);
+		m_frameStats.lap(FrameStats::Fence);
+
+		// as many fixed steps as the clock says, the frame then draws between the last two states
+		const auto steps = m_clock.advance();
+		m_simulatedSteps += steps;
+		if (m_engine)
+		{
+			for (auto i = 0u; i < steps; ++i)
+			{
+				if (i + 1 == steps)
+				{
+					m_hostParticles.snapshot();
+				}
+				m_engine->step(config::TIME_STEP);
+			}
+		}
+		m_frameStats.lap(FrameStats::Simulate);
 
 		auto imageIndex = acquireNextImage(wait);
+		m_frameStats.lap(FrameStats::Acquire);
 		
-		m_graphics.render(wait, signal, hostNotify, imageIndex);
+		if (isGpuEngine())
+		{
+			// draw N reads the buffer step N wrote, step N + 1 goes into the next buffer meanwhile
+			// and step N + PARTICLE_BUFFERS waits for draw N before overwriting it
+			auto draw = m_graphics.renders();
+			measureOverlap(draw);
+
+			const vk::Semaphore waits[] = { wait, m_compute.simulated(draw) };
+			const vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexInput };
+			const vk::Semaphore signals[] = { signal, m_compute.drawn(draw) };
+
+			// the snapshot drawn now was decided a frame ago, it interpolates by the clock as it was then
+			m_graphics.setTime(m_clock.frameTime(), -(1.0f - m_stepAlpha) * config::TIME_STEP);
+			m_graphics.render(waits, waitStages, signals, hostNotify, imageIndex, m_currentFrame, m_compute.slot(draw));
+			requestReadback();
+			m_compute.step(steps);
+			m_stepAlpha = m_clock.alpha();
+		}
+		else if (isPlayback())
+		{
+			// acquire() copies the recorded frame in ahead of the draw when this frame's buffer does not hold it yet
+			m_playback.update(m_currentFrame, m_clock.frameTime());
+			m_graphics.setTime(m_clock.frameTime(), m_playback.rewind());
+			m_graphics.render(wait, signal, hostNotify, imageIndex, m_currentFrame, m_currentFrame);
+		}
+		else
+		{
+			m_hostParticles.upload(m_currentFrame, m_clock.alpha());
+			m_graphics.setTime(m_clock.frameTime(), 0.0f);
+			m_graphics.render(wait, signal, hostNotify, imageIndex, m_currentFrame, m_currentFrame);
+		}
+		m_inputTimes[m_currentFrame] = m_lastInput;
+		m_isLatencyPending[m_currentFrame] = true;
+		m_frameStats.lap(FrameStats::Render);
 		
-		auto status = m_present.present(signal, imageIndex);
+		auto status = m_present->present(signal, imageIndex);
 		
 		if (status == vk::Result::eErrorOutOfDateKHR or status == vk::Result::eSuboptimalKHR)
 		{
@@ -364,24 +902,164 @@ private:
 		{
 			vk::throwResultException(status, "could not present queue!");
 		}
+		m_frameStats.lap(FrameStats::Present);
+	}
+
+	void measureOverlap(const uint64_t draw)
+	{
+		// the frame fence only covers draw N - frames in flight, one frame earlier the step
+		// that ran alongside it has been waited on by the graphics queue as well
+		if (draw <= m_options.framesInFlight)
+		{
+			return;
+		}
+
+		auto measured = draw - m_options.framesInFlight - 1;
+		double computeBegin, computeEnd, graphicsBegin, graphicsEnd;
+		if (m_graphics.timer().read(measured, graphicsBegin, graphicsEnd) and m_compute.timer().read(measured + 1, computeBegin, computeEnd))
+		{
+			m_overlap.add(computeBegin, computeEnd, graphicsBegin, graphicsEnd);
+		}
+	}
+
+	// Frames whose fence signaled since the last look, the completion is only as precise as how often this runs -
+	// at every fence wait and after every present
+	void stampCompletions()
+	{
+		const auto now = std::chrono::steady_clock::now();
+
+		for (auto slot = 0u; slot < m_inFlightImages.size(); ++slot)
+		{
+			if (m_isLatencyPending[slot] and m_device->getFenceStatus(*m_inFlightImages[slot]) == vk::Result::eSuccess)
+			{
+				m_frameStats.latency(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_inputTimes[slot]).count());
+				m_isLatencyPending[slot] = false;
+			}
+		}
 	}
 
 	void drawFrame()
 	{
+		m_frameStats.start();
+		m_pacer.wait();
+		m_frameStats.lap(FrameStats::Pace);
 		drawFrame(*m_imageAvailable[m_currentFrame], *m_renderCompleted[m_currentFrame], *m_inFlightImages[m_currentFrame]);
-		m_currentFrame = (m_currentFrame + 1) % config::MAX_FRAMES_IN_FLIGHT;
+		stampCompletions();
+		m_currentFrame = (m_currentFrame + 1) % m_options.framesInFlight;
+		++m_frameCount;
+		m_frameStats.finish();
+	}
+
+	bool shouldClose(const uint64_t frames) const
+	{
+		if (m_options.frames and frames >= m_options.frames)
+		{
+			return true;
+		}
+
+		return !m_options.headless and glfwWindowShouldClose(m_window);
+	}
+
+	void dumpFrameStats() const
+	{
+		if (!m_options.statsPath.empty())
+		{
+			m_frameStats.write(m_options.statsPath);
+		}
 	}
 
 	void mainLoop()
 	{
-		while (!glfwWindowShouldClose(m_window))
+		if (!m_options.tracePath.empty())
+		{
+			m_frameStats.openTrace(m_options.tracePath);
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		uint64_t frames = 0;
+		m_lastInput = start;
+
+		while (!shouldClose(frames))
 		{
 			drawFrame();
-			glfwPollEvents();
+			++frames;
+
+			if (isGpuEngine())
+			{
+				collectReadbacks();
+			}
+			else if (m_engine)
+			{
+				if (m_options.checkpointEvery and m_simulatedSteps >= m_nextCheckpoint)
+				{
+					saveCheckpoint(false);
+					m_nextCheckpoint = (m_simulatedSteps / m_options.checkpointEvery + 1) * m_options.checkpointEvery;
+				}
+
+				if (m_trajectory and m_simulatedSteps >= m_nextTrajectoryFrame)
+				{
+					recordTrajectory();
+					m_nextTrajectoryFrame = (m_simulatedSteps / m_options.trajectoryEvery + 1) * m_options.trajectoryEvery;
+				}
+			}
+
+			if (g_dumpStats.exchange(false))
+			{
+				dumpFrameStats();
+			}
+
+			if (!m_options.headless)
+			{
+				glfwPollEvents();
+			}
+			m_lastInput = std::chrono::steady_clock::now();
 		}
 
+		m_compute.await();
 		m_graphics.await();
-		m_present.await();
+		m_present->await();
+
+		while (!m_readbacks.empty())
+		{
+			takeReadback();
+		}
+
+		if (m_checkpoints)
+		{
+			saveCheckpoint(true);
+		}
+
+		if (m_trajectory)
+		{
+			m_trajectory->close();
+			std::cout << "Trajectory: " << m_trajectory->frames() << " frames, " << m_trajectory->droppedFrames() << " dropped, "
+				<< m_trajectory->bytesWritten() / (1024.0 * 1024.0) << " MiB written to " << m_options.trajectoryPath << '\n';
+		}
+
+		auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Rendered " << frames << " frames in " << seconds << "s (" << frames / seconds << " fps)\n";
+		if (isPlayback())
+		{
+			std::cout << "Played back to step " << m_playback.step() << ", " << m_playback.stalls() << " frames showed an older recorded frame than wanted\n";
+		}
+		else
+		{
+			std::cout << "Simulated " << m_clock.steps() << " steps of " << m_clock.step() * 1000.0 << "ms, " << m_clock.droppedSteps() << " dropped\n";
+		}
+
+		if (m_engine)
+		{
+			m_engine->report(std::cout);
+		}
+		else if (isGpuEngine())
+		{
+			m_overlap.report(std::cout);
+			m_compute.profiler().report(std::cout);
+		}
+		m_graphics.profiler().report(std::cout);
+		m_frameStats.report(std::cout);
+		dumpFrameStats();
+		MemoryAllocator::get(m_physicalDevice, *m_device).report(std::cout);
 	}
 
 // Order of fields is important for destructors
@@ -391,26 +1069,78 @@ private:
 		vk::DebugUtilsMessengerEXT, 
 		vk::DispatchLoaderDynamic> 	m_debugMessenger;
 	vk::UniqueDevice 				m_device;
+	PipelineCache					m_pipelineCache;
 	
-	Present m_present;
-	Graphics m_graphics;
+	// A GPU step that copies its state out, and what for
+	struct Readback
+	{
+		uint64_t	step;				// Compute's
+		uint64_t	simulatedSteps;		// integrations up to and including it
+		bool		isTrajectory;
+		bool		isCheckpoint;
+	};
+
+	std::unique_ptr<Engine>			m_engine;
+	MappedCheckpoint				m_restored;			// --restore, unmapped once the engine or the GPU has the state
+	std::unique_ptr<CheckpointWriter>	m_checkpoints;	// --checkpoint
+	uint64_t						m_firstStep = 0;	// step and time of the restored checkpoint
+	double							m_firstTime = 0.0;
+	uint64_t						m_simulatedSteps = 0;
+	uint64_t						m_nextCheckpoint = 0;
+	std::unique_ptr<TrajectoryWriter>	m_trajectory;	// --trajectory
+	Particles						m_readbackFrame;	// GPU state read back for either of them
+	std::deque<Readback>			m_readbacks;		// in step order, at most one per frame buffer
+	uint64_t						m_nextTrajectoryFrame = 0;
+	std::unique_ptr<RenderTarget> 	m_present;
+	UploadManager					m_uploads;
+	HostParticles					m_hostParticles;
+	Compute							m_compute;
+	Playback						m_playback;			// --playback
+	double							m_playbackSpeed = 0.0;
+	double							m_pausedSpeed = 0.0;	// speed to resume with, 0 when not paused
+	Graphics 						m_graphics;
+	DeletionQueue					m_deletions;	// may hold Graphics' framebuffers and old swapchains
 
     std::vector<vk::UniqueSemaphore> 	m_imageAvailable;
     std::vector<vk::UniqueFence> 		m_inFlightImages;
     std::vector<vk::UniqueSemaphore>	m_renderCompleted;
+	std::vector<std::chrono::steady_clock::time_point>	m_inputTimes;		// per frame in flight, the input poll it was recorded after
+	std::vector<bool>					m_isLatencyPending;	// submitted, completion not seen yet
 	
-	vk::Queue					m_computeQueue;
-	int 						m_currentFrame;
+	int 						m_currentFrame = 0;
+	uint64_t					m_frameCount = 0;
+	FrameStats					m_frameStats;
+	QueueOverlap				m_overlap;
+	FramePacer					m_pacer;
+	SimulationClock				m_clock;
+	float						m_stepAlpha = 0.0f;		// clock's alpha when the GPU step being drawn next was submitted
+	std::chrono::steady_clock::time_point	m_lastInput;
 	vk::DispatchLoaderDynamic 	m_dispatchDynamic;
 	vk::PhysicalDevice 			m_physicalDevice;
-	GLFWwindow*					m_window;
-	bool						m_windowSizeChanged;
+	GLFWwindow*					m_window = nullptr;
+	bool						m_windowSizeChanged = false;
+	const Options				m_options;
 
 };
 
-int main()
+int main(int argc, char** argv)
 {
-	auto app = HelloTriangleApp();
+	Options options;
+	try
+	{
+		options = parseOptions(argc, argv);
+	}
+	catch (const std::exception &err)
+	{
+		std::cerr << err.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+#ifdef SIGUSR1
+	std::signal(SIGUSR1, [](int) { g_dumpStats = true; });
+#endif
+
+	auto app = HelloTriangleApp(options);
 
 	try
 	{
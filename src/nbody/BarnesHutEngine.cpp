@@ -0,0 +1,69 @@
+#include "BarnesHutEngine.h"
+
+#include <chrono>
+#include <utility>
+
+#include "parallel.h"
+
+BarnesHutEngine::BarnesHutEngine(Particles particles, const float softening, const float theta, const unsigned threads)
+    :   m_particles(std::move(particles)), m_softening(softening), m_theta(theta), m_threads(threads), 
+        m_buildSeconds(0.0), m_traverseSeconds(0.0), m_evaluations(0)
+{
+    m_accelerations.resize(m_particles.size());
+    accelerate();
+}
+
+void BarnesHutEngine::step(const float dt)
+{
+    kick(m_particles, m_accelerations, 0.5f * dt);
+    drift(m_particles, dt);
+    accelerate();
+    kick(m_particles, m_accelerations, 0.5f * dt);
+}
+
+const Particles& BarnesHutEngine::particles() const
+{
+    return m_particles;
+}
+
+void BarnesHutEngine::report(std::ostream& os) const
+{
+    if (!m_evaluations)
+    {
+        return;
+    }
+
+    os  << "Barnes-Hut (theta " << m_theta << ", " << m_particles.size() << " particles, " << m_tree.size() << " nodes): "
+        << "tree build " << 1000.0 * m_buildSeconds / m_evaluations << "ms, "
+        << "traversal " << 1000.0 * m_traverseSeconds / m_evaluations << "ms per step over " << m_evaluations << " steps\n";
+}
+
+const Accelerations& BarnesHutEngine::accelerations() const
+{
+    return m_accelerations;
+}
+
+const Octree& BarnesHutEngine::tree() const
+{
+    return m_tree;
+}
+
+void BarnesHutEngine::accelerate()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    m_tree.build(m_particles);
+
+    auto built = std::chrono::steady_clock::now();
+
+    parallelFor(m_particles.size(), m_threads, [this](const size_t begin, const size_t end)
+    {
+        m_tree.accelerate(m_theta, m_softening, begin, end, m_accelerations);
+    });
+
+    auto traversed = std::chrono::steady_clock::now();
+
+    m_buildSeconds += std::chrono::duration<double>(built - start).count();
+    m_traverseSeconds += std::chrono::duration<double>(traversed - built).count();
+    ++m_evaluations;
+}
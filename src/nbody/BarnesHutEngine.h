@@ -0,0 +1,41 @@
+#pragma once
+
+#include <ostream>
+#include <thread>
+
+#include "Engine.h"
+#include "Octree.h"
+#include "Particles.h"
+
+// O(N log N) CPU solver - rebuilds an octree every step and walks it in parallel, cells seen under an angle below theta are treated as point masses
+class BarnesHutEngine : public Engine
+{
+public:
+    BarnesHutEngine(
+        Particles particles, const float softening, const float theta, 
+        const unsigned threads = std::thread::hardware_concurrency()
+    );
+
+    void step(const float dt) override;
+
+    const Particles& particles() const override;
+
+    void report(std::ostream& os) const override;
+
+    const Accelerations& accelerations() const;
+
+    const Octree& tree() const;
+
+private:
+    void accelerate();
+
+    Particles       m_particles;
+    Accelerations   m_accelerations;
+    Octree          m_tree;
+    float           m_softening;
+    float           m_theta;
+    unsigned        m_threads;
+    double          m_buildSeconds;
+    double          m_traverseSeconds;
+    uint64_t        m_evaluations;
+};
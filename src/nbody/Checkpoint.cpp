@@ -0,0 +1,352 @@
+#include "Checkpoint.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+constexpr char MAGIC[8] = { 'N', 'B', 'O', 'D', 'Y', 'C', 'K', 'P' };
+
+uint64_t alignUp(const uint64_t offset)
+{
+    return (offset + CHECKPOINT_ALIGNMENT - 1) / CHECKPOINT_ALIGNMENT * CHECKPOINT_ALIGNMENT;
+}
+
+CheckpointHeader makeHeader(const size_t count, const CheckpointInfo& info)
+{
+    CheckpointHeader ret;
+    std::memset(&ret, 0, sizeof(ret));
+    std::memcpy(ret.magic, MAGIC, sizeof(MAGIC));
+    ret.version = CHECKPOINT_VERSION;
+    ret.headerSize = sizeof(CheckpointHeader);
+    ret.count = count;
+    ret.step = info.step;
+    ret.time = info.time;
+    ret.dt = info.dt;
+    ret.softening = info.softening;
+    ret.theta = info.theta;
+    ret.alignment = CHECKPOINT_ALIGNMENT;
+    std::memcpy(ret.engine, info.engine.data(), std::min(info.engine.size(), sizeof(ret.engine)));
+
+    auto offset = alignUp(sizeof(CheckpointHeader));
+    for (auto& columnOffset : ret.columnOffsets)
+    {
+        columnOffset = offset;
+        offset = alignUp(offset + count * sizeof(float));
+    }
+
+    return ret;
+}
+
+void columnPointers(const ParticleColumns& particles, const float* (&out)[CHECKPOINT_COLUMNS])
+{
+    out[0] = particles.x;
+    out[1] = particles.y;
+    out[2] = particles.z;
+    out[3] = particles.vx;
+    out[4] = particles.vy;
+    out[5] = particles.vz;
+    out[6] = particles.mass;
+}
+
+}
+
+void writeCheckpoint(const std::string& path, const ParticleColumns& particles, const CheckpointInfo& info)
+{
+    const auto header = makeHeader(particles.count, info);
+    const float* columns[CHECKPOINT_COLUMNS];
+    columnPointers(particles, columns);
+
+    const auto temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            throw std::runtime_error("could not open checkpoint for writing: " + temporary);
+        }
+
+        // one write per column, the stream passes anything this big straight to the OS
+        const std::vector<char> padding(CHECKPOINT_ALIGNMENT, 0);
+        uint64_t offset = 0;
+        const auto pad = [&](const uint64_t to) {
+            file.write(padding.data(), to - offset);
+            offset = to;
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        offset = sizeof(header);
+
+        for (auto c = 0u; c < CHECKPOINT_COLUMNS; ++c)
+        {
+            pad(header.columnOffsets[c]);
+            file.write(reinterpret_cast<const char*>(columns[c]), particles.count * sizeof(float));
+            offset += particles.count * sizeof(float);
+        }
+        pad(alignUp(offset));
+
+        if (!file.flush())
+        {
+            throw std::runtime_error("could not write checkpoint: " + temporary);
+        }
+    }
+
+    if (std::rename(temporary.c_str(), path.c_str()))
+    {
+        throw std::runtime_error("could not move checkpoint into place: " + path);
+    }
+}
+
+bool isCheckpointFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+
+    return file.read(magic, sizeof(magic)) and !std::memcmp(magic, MAGIC, sizeof(MAGIC));
+}
+
+CheckpointWriter::CheckpointWriter()
+    : m_isPending(false), m_isStopping(false)
+{
+    m_thread = std::thread([this]() { work(); });
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+bool CheckpointWriter::save(const std::string& path, const Particles& particles, const CheckpointInfo& info)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_isPending)
+    {
+        return false;
+    }
+
+    // the writer only touches these while m_isPending is set. Copy assignment keeps the columns' storage
+    // from the last save, so all the simulation waits for is one memcpy per column
+    m_particles = particles;
+    m_info = info;
+    m_path = path;
+    m_isPending = true;
+    lock.unlock();
+
+    m_wake.notify_one();
+    return true;
+}
+
+void CheckpointWriter::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return !m_isPending; });
+
+    if (m_error)
+    {
+        auto error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+bool CheckpointWriter::isBusy() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_isPending;
+}
+
+void CheckpointWriter::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        // a pending checkpoint is still written when stopping
+        m_wake.wait(lock, [this]() { return m_isStopping or m_isPending; });
+        if (!m_isPending)
+        {
+            return;
+        }
+
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            writeCheckpoint(m_path, m_particles.columns(), m_info);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        m_error = error;
+        m_isPending = false;
+        m_done.notify_all();
+    }
+}
+
+MappedCheckpoint::MappedCheckpoint(const std::string& path)
+    : m_data(nullptr), m_size(0)
+{
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("could not open checkpoint: " + path);
+    }
+
+    struct stat status;
+    if (::fstat(fd, &status) or static_cast<size_t>(status.st_size) < sizeof(CheckpointHeader))
+    {
+        ::close(fd);
+        throw std::runtime_error("not a checkpoint: " + path);
+    }
+
+    auto data = ::mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        throw std::runtime_error("could not map checkpoint: " + path);
+    }
+
+    // read front to back by the upload, let the kernel read ahead aggressively
+    ::madvise(data, status.st_size, MADV_SEQUENTIAL);
+
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = status.st_size;
+
+    const auto& h = header();
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)))
+    {
+        release();
+        throw std::runtime_error("not a checkpoint: " + path);
+    }
+
+    if (h.version != CHECKPOINT_VERSION or h.headerSize != sizeof(CheckpointHeader))
+    {
+        const auto version = h.version;
+        release();
+        throw std::runtime_error("checkpoint version " + std::to_string(version) + " is not supported, expected " + std::to_string(CHECKPOINT_VERSION) + ": " + path);
+    }
+
+    for (const auto offset : h.columnOffsets)
+    {
+        if (offset % sizeof(float) or offset > m_size or h.count > (m_size - offset) / sizeof(float))
+        {
+            release();
+            throw std::runtime_error("truncated checkpoint: " + path);
+        }
+    }
+}
+
+MappedCheckpoint::MappedCheckpoint()
+    : m_data(nullptr), m_size(0)
+{
+
+}
+
+MappedCheckpoint::MappedCheckpoint(MappedCheckpoint&& other)
+{
+    m_data = other.m_data;
+    m_size = other.m_size;
+
+    other.reset();
+}
+
+MappedCheckpoint::~MappedCheckpoint()
+{
+    release();
+    reset();
+}
+
+MappedCheckpoint& MappedCheckpoint::operator=(MappedCheckpoint&& other)
+{
+    release();
+
+    m_data = other.m_data;
+    m_size = other.m_size;
+
+    other.reset();
+
+    return *this;
+}
+
+MappedCheckpoint::operator bool() const
+{
+    return m_data != nullptr;
+}
+
+size_t MappedCheckpoint::size() const
+{
+    return header().count;
+}
+
+CheckpointInfo MappedCheckpoint::info() const
+{
+    const auto& h = header();
+
+    CheckpointInfo ret;
+    ret.step = h.step;
+    ret.time = h.time;
+    ret.dt = h.dt;
+    ret.softening = h.softening;
+    ret.theta = h.theta;
+    ret.engine.assign(h.engine, strnlen(h.engine, sizeof(h.engine)));
+    return ret;
+}
+
+ParticleColumns MappedCheckpoint::columns() const
+{
+    return { column(0), column(1), column(2), column(3), column(4), column(5), column(6), size() };
+}
+
+Particles MappedCheckpoint::particles() const
+{
+    const auto count = size();
+
+    Particles ret;
+    ret.x.assign(column(0), column(0) + count);
+    ret.y.assign(column(1), column(1) + count);
+    ret.z.assign(column(2), column(2) + count);
+    ret.vx.assign(column(3), column(3) + count);
+    ret.vy.assign(column(4), column(4) + count);
+    ret.vz.assign(column(5), column(5) + count);
+    ret.mass.assign(column(6), column(6) + count);
+    return ret;
+}
+
+void MappedCheckpoint::reset()
+{
+    m_data = nullptr;
+    m_size = 0;
+}
+
+void MappedCheckpoint::release()
+{
+    if (m_data) ::munmap(const_cast<uint8_t*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+}
+
+const CheckpointHeader& MappedCheckpoint::header() const
+{
+    return *reinterpret_cast<const CheckpointHeader*>(m_data);
+}
+
+const float* MappedCheckpoint::column(const size_t index) const
+{
+    return reinterpret_cast<const float*>(m_data + header().columnOffsets[index]);
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Particles.h"
+
+constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+// Columns start on page boundaries, so a mapped checkpoint hands out page aligned pointers
+constexpr uint64_t CHECKPOINT_ALIGNMENT = 4096;
+
+// x, y, z, vx, vy, vz, mass - the order of Particles and ParticleColumns
+constexpr size_t CHECKPOINT_COLUMNS = 7;
+
+// Where the state came from and how it was integrated
+struct CheckpointInfo
+{
+    uint64_t    step = 0;
+    double      time = 0.0;
+    float       dt = 0.0f;
+    float       softening = 0.0f;
+    float       theta = 0.0f;
+    std::string engine;
+};
+
+// First bytes of a checkpoint file, little endian, followed by the columns at columnOffsets
+struct CheckpointHeader
+{
+    char        magic[8];                           // "NBODYCKP"
+    uint32_t    version;
+    uint32_t    headerSize;                         // sizeof(CheckpointHeader) as written
+    uint64_t    count;
+    uint64_t    step;
+    double      time;
+    float       dt;
+    float       softening;
+    float       theta;
+    uint32_t    alignment;
+    uint64_t    columnOffsets[CHECKPOINT_COLUMNS];  // from the start of the file
+    char        engine[16];                         // zero padded, not necessarily terminated
+};
+static_assert(sizeof(CheckpointHeader) == 128, "checkpoint header layout changed, bump CHECKPOINT_VERSION");
+
+// Writes `particles` to `path` through a temporary file renamed into place, so a crash never leaves a torn checkpoint
+void writeCheckpoint(const std::string& path, const ParticleColumns& particles, const CheckpointInfo& info);
+
+// Whether `path` starts like a checkpoint, of any version
+bool isCheckpointFile(const std::string& path);
+
+// Saves checkpoints on a thread of its own. save() copies the columns and returns, the simulation carries on while they are written.
+// Holds one checkpoint at a time - a save while the previous one is still being written is refused rather than queued
+class CheckpointWriter
+{
+public:
+    CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter& other) = delete;
+
+    // Finishes the checkpoint being written
+    ~CheckpointWriter();
+
+    CheckpointWriter& operator=(const CheckpointWriter& other) = delete;
+
+    // false when the writer is still busy with the previous checkpoint, nothing is copied then
+    bool save(const std::string& path, const Particles& particles, const CheckpointInfo& info);
+
+    // Blocks until the checkpoint being written is on disk, rethrows what went wrong writing it
+    void wait();
+
+    bool isBusy() const;
+
+private:
+    void work();
+
+    std::thread                     m_thread;
+    mutable std::mutex              m_mutex;
+    std::condition_variable         m_wake;
+    std::condition_variable         m_done;
+    Particles                       m_particles;
+    CheckpointInfo                  m_info;
+    std::string                     m_path;
+    std::exception_ptr              m_error;
+    bool                            m_isPending;
+    bool                            m_isStopping;
+};
+
+// A checkpoint file mapped read only. The columns point straight into the mapping - nothing is parsed
+// or copied until a consumer reads them, so the pages stream in from disk as they are uploaded
+class MappedCheckpoint
+{
+public:
+    // Throws std::runtime_error when the file is missing, truncated or written by another version
+    explicit MappedCheckpoint(const std::string& path);
+
+    MappedCheckpoint();
+
+    MappedCheckpoint(const MappedCheckpoint& other) = delete;
+
+    MappedCheckpoint(MappedCheckpoint&& other);
+
+    ~MappedCheckpoint();
+
+    MappedCheckpoint& operator=(const MappedCheckpoint& other) = delete;
+
+    MappedCheckpoint& operator=(MappedCheckpoint&& other);
+
+    explicit operator bool() const;
+
+    size_t size() const;
+
+    CheckpointInfo info() const;
+
+    // Valid as long as the mapping is
+    ParticleColumns columns() const;
+
+    // Owning copy for the CPU engines, one bulk copy per column
+    Particles particles() const;
+
+    void reset();
+
+    void release();
+
+private:
+    const CheckpointHeader& header() const;
+
+    const float* column(const size_t index) const;
+
+    const uint8_t*  m_data;
+    size_t          m_size;
+};
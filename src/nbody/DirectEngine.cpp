@@ -0,0 +1,68 @@
+#include "DirectEngine.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "parallel.h"
+
+DirectEngine::DirectEngine(Particles particles, const float softening, const Kernel kernel, const unsigned threads)
+    :   m_particles(std::move(particles)), m_softening(softening), m_kernel(kernel), m_forceKernel(forceKernel(kernel)), m_threads(threads),
+        m_forceSeconds(0.0), m_evaluations(0)
+{
+    if (!isSupported(kernel))
+    {
+        throw std::runtime_error(std::string("force kernel not supported on this machine: ") + toString(kernel));
+    }
+
+    m_accelerations.resize(m_particles.size());
+    accelerate();
+}
+
+void DirectEngine::step(const float dt)
+{
+    kick(m_particles, m_accelerations, 0.5f * dt);
+    drift(m_particles, dt);
+    accelerate();
+    kick(m_particles, m_accelerations, 0.5f * dt);
+}
+
+const Particles& DirectEngine::particles() const
+{
+    return m_particles;
+}
+
+void DirectEngine::report(std::ostream& os) const
+{
+    if (!m_evaluations)
+    {
+        return;
+    }
+
+    os  << "Direct (" << toString(m_kernel) << ", " << m_particles.size() << " particles): "
+        << "force " << 1000.0 * m_forceSeconds / m_evaluations << "ms per step over " << m_evaluations << " steps\n";
+}
+
+const Accelerations& DirectEngine::accelerations() const
+{
+    return m_accelerations;
+}
+
+Kernel DirectEngine::kernel() const
+{
+    return m_kernel;
+}
+
+void DirectEngine::accelerate()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    parallelFor(m_particles.size(), m_threads, [this](const size_t begin, const size_t end)
+    {
+        m_forceKernel(m_particles, m_softening, begin, end, m_accelerations);
+    });
+
+    m_forceSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ++m_evaluations;
+}
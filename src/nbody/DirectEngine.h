@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <thread>
+
+#include "Engine.h"
+#include "gravity.h"
+#include "Particles.h"
+
+// All pairs O(N^2) CPU solver with a leapfrog integrator, the correctness reference for every other engine
+class DirectEngine : public Engine
+{
+public:
+    DirectEngine(
+        Particles particles, const float softening, 
+        const Kernel kernel = bestKernel(), 
+        const unsigned threads = std::thread::hardware_concurrency()
+    );
+
+    void step(const float dt) override;
+
+    const Particles& particles() const override;
+
+    void report(std::ostream& os) const override;
+
+    const Accelerations& accelerations() const;
+
+    Kernel kernel() const;
+
+private:
+    void accelerate();
+
+    Particles       m_particles;
+    Accelerations   m_accelerations;
+    float           m_softening;
+    Kernel          m_kernel;
+    ForceKernel     m_forceKernel;
+    unsigned        m_threads;
+    double          m_forceSeconds;
+    uint64_t        m_evaluations;
+};
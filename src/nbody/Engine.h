@@ -0,0 +1,21 @@
+#pragma once
+
+#include <ostream>
+
+#include "Particles.h"
+
+// Source of particle state advanced in discrete steps
+class Engine
+{
+public:
+    virtual ~Engine() = default;
+
+    virtual void step(const float dt) = 0;
+
+    virtual const Particles& particles() const = 0;
+
+    // Timing summary of the steps taken so far
+    virtual void report(std::ostream&) const
+    {
+    }
+};
@@ -0,0 +1,237 @@
+#include "Octree.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+constexpr uint32_t MORTON_BITS = 21;
+constexpr uint32_t MAX_LEVEL = MORTON_BITS;
+constexpr uint32_t TRAVERSAL_STACK = 8 * MAX_LEVEL + 1;
+
+// Spreads the low 21 bits of v so there are two zero bits between each of them
+uint64_t spreadBits(uint64_t v)
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffff;
+    v = (v | v << 16) & 0x1f0000ff0000ff;
+    v = (v | v << 8) & 0x100f00f00f00f00f;
+    v = (v | v << 4) & 0x10c30c30c30c30c3;
+    v = (v | v << 2) & 0x1249249249249249;
+    return v;
+}
+
+uint64_t mortonCode(const float x, const float y, const float z, const float minX, const float minY, const float minZ, const float scale)
+{
+    constexpr float maxCell = static_cast<float>((1u << MORTON_BITS) - 1);
+
+    auto cx = static_cast<uint64_t>(std::min(maxCell, std::max(0.0f, (x - minX) * scale)));
+    auto cy = static_cast<uint64_t>(std::min(maxCell, std::max(0.0f, (y - minY) * scale)));
+    auto cz = static_cast<uint64_t>(std::min(maxCell, std::max(0.0f, (z - minZ) * scale)));
+
+    return spreadBits(cx) << 2 | spreadBits(cy) << 1 | spreadBits(cz);
+}
+
+}
+
+Octree::Octree(const uint32_t leafSize)
+    : m_leafSize(leafSize), m_rootSize(0.0f)
+{
+}
+
+void Octree::build(const Particles& particles)
+{
+    const auto count = particles.size();
+
+    m_nodes.clear();
+    if (!count)
+    {
+        return;
+    }
+
+    auto minX = *std::min_element(particles.x.begin(), particles.x.end());
+    auto minY = *std::min_element(particles.y.begin(), particles.y.end());
+    auto minZ = *std::min_element(particles.z.begin(), particles.z.end());
+    auto maxX = *std::max_element(particles.x.begin(), particles.x.end());
+    auto maxY = *std::max_element(particles.y.begin(), particles.y.end());
+    auto maxZ = *std::max_element(particles.z.begin(), particles.z.end());
+
+    m_rootSize = std::max({maxX - minX, maxY - minY, maxZ - minZ, 1e-6f});
+    const auto scale = (1u << MORTON_BITS) / m_rootSize;
+
+    m_keys.resize(count);
+    for (auto i = 0u; i < count; ++i)
+    {
+        m_keys[i] = { mortonCode(particles.x[i], particles.y[i], particles.z[i], minX, minY, minZ, scale), i };
+    }
+    std::sort(m_keys.begin(), m_keys.end());
+
+    m_codes.resize(count);
+    m_order.resize(count);
+    m_x.resize(count);
+    m_y.resize(count);
+    m_z.resize(count);
+    m_mass.resize(count);
+    for (auto i = 0u; i < count; ++i)
+    {
+        m_codes[i] = m_keys[i].first;
+        m_order[i] = m_keys[i].second;
+
+        auto p = m_order[i];
+        m_x[i] = particles.x[p];
+        m_y[i] = particles.y[p];
+        m_z[i] = particles.z[p];
+        m_mass[i] = particles.mass[p];
+    }
+
+    m_nodes.push_back(Node());
+    buildNode(0, 0, static_cast<uint32_t>(count), 0);
+}
+
+void Octree::buildNode(const uint32_t index, const uint32_t begin, const uint32_t end, const uint32_t level)
+{
+    Node node = {};
+    node.size = m_rootSize / static_cast<float>(1u << level);
+    node.begin = begin;
+    node.end = end;
+
+    if (end - begin <= m_leafSize or level == MAX_LEVEL)
+    {
+        for (auto i = begin; i < end; ++i)
+        {
+            node.x += m_x[i] * m_mass[i];
+            node.y += m_y[i] * m_mass[i];
+            node.z += m_z[i] * m_mass[i];
+            node.mass += m_mass[i];
+        }
+    }
+    else
+    {
+        // Particles are sorted by code, so each octant is a contiguous run keyed by the 3 bits of this level
+        const auto shift = 3 * (MAX_LEVEL - 1 - level);
+        uint32_t bounds[9];
+        bounds[0] = begin;
+        for (auto octant = 0u; octant < 8; ++octant)
+        {
+            bounds[octant + 1] = static_cast<uint32_t>(std::partition_point(
+                m_codes.begin() + bounds[octant], m_codes.begin() + end,
+                [shift, octant](const uint64_t code) { return ((code >> shift) & 7) <= octant; }
+            ) - m_codes.begin());
+        }
+
+        node.firstChild = static_cast<uint32_t>(m_nodes.size());
+        for (auto octant = 0u; octant < 8; ++octant)
+        {
+            if (bounds[octant + 1] > bounds[octant])
+            {
+                ++node.childCount;
+            }
+        }
+        m_nodes.resize(m_nodes.size() + node.childCount);
+
+        auto child = node.firstChild;
+        for (auto octant = 0u; octant < 8; ++octant)
+        {
+            if (bounds[octant + 1] > bounds[octant])
+            {
+                buildNode(child, bounds[octant], bounds[octant + 1], level + 1);
+
+                const auto& built = m_nodes[child];
+                node.x += built.x * built.mass;
+                node.y += built.y * built.mass;
+                node.z += built.z * built.mass;
+                node.mass += built.mass;
+                ++child;
+            }
+        }
+    }
+
+    if (node.mass > 0.0f)
+    {
+        node.x /= node.mass;
+        node.y /= node.mass;
+        node.z /= node.mass;
+    }
+
+    m_nodes[index] = node;
+}
+
+void Octree::accelerate(const float theta, const float softening, const size_t begin, const size_t end, Accelerations& out) const
+{
+    const auto eps2 = softening * softening;
+    const auto theta2 = theta * theta;
+
+    uint32_t stack[TRAVERSAL_STACK];
+
+    for (auto i = begin; i < end; ++i)
+    {
+        const auto xi = m_x[i], yi = m_y[i], zi = m_z[i];
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+
+        auto top = 0u;
+        stack[top++] = 0;
+        while (top)
+        {
+            const auto& node = m_nodes[stack[--top]];
+
+            const auto dx = node.x - xi;
+            const auto dy = node.y - yi;
+            const auto dz = node.z - zi;
+            const auto d2 = dx * dx + dy * dy + dz * dz;
+
+            // Cells holding the particle itself are always opened so it never pulls on its own center of mass
+            const auto isOpened = (node.begin <= i and i < node.end) or node.size * node.size >= theta2 * d2;
+
+            if (!isOpened)
+            {
+                const auto invR = 1.0f / std::sqrt(d2 + eps2);
+                const auto s = node.mass * invR * invR * invR;
+
+                ax += dx * s;
+                ay += dy * s;
+                az += dz * s;
+            }
+            else if (node.childCount)
+            {
+                for (auto c = 0u; c < node.childCount; ++c)
+                {
+                    stack[top++] = node.firstChild + c;
+                }
+            }
+            else
+            {
+                // Opened leaf, sum its particles directly
+                for (auto j = node.begin; j < node.end; ++j)
+                {
+                    const auto px = m_x[j] - xi;
+                    const auto py = m_y[j] - yi;
+                    const auto pz = m_z[j] - zi;
+
+                    const auto r2 = px * px + py * py + pz * pz + eps2;
+                    const auto invR = 1.0f / std::sqrt(r2);
+                    const auto s = m_mass[j] * invR * invR * invR;
+
+                    ax += px * s;
+                    ay += py * s;
+                    az += pz * s;
+                }
+            }
+        }
+
+        const auto p = m_order[i];
+        out.x[p] = ax;
+        out.y[p] = ay;
+        out.z[p] = az;
+    }
+}
+
+size_t Octree::size() const
+{
+    return m_nodes.size();
+}
+
+const std::vector<Octree::Node>& Octree::nodes() const
+{
+    return m_nodes;
+}
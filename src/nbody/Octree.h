@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Particles.h"
+
+// Barnes-Hut octree over a Morton ordered copy of the particles, stored as one flat node array.
+// Children of a node are contiguous, leaves own a contiguous range of the sorted particles
+class Octree
+{
+public:
+    struct Node
+    {
+        float       x, y, z;        // center of mass
+        float       mass;
+        float       size;           // cell edge length
+        uint32_t    firstChild;
+        uint32_t    childCount;     // 0 for leaves
+        uint32_t    begin, end;     // sorted particle range
+    };
+
+    explicit Octree(const uint32_t leafSize = 16);
+
+    void build(const Particles& particles);
+
+    // Accelerations of sorted particles [begin, end), written to their original indices in out
+    void accelerate(const float theta, const float softening, const size_t begin, const size_t end, Accelerations& out) const;
+
+    size_t size() const;
+
+    const std::vector<Node>& nodes() const;
+
+private:
+    void buildNode(const uint32_t index, const uint32_t begin, const uint32_t end, const uint32_t level);
+
+    uint32_t                m_leafSize;
+    std::vector<Node>       m_nodes;
+    std::vector<std::pair<uint64_t, uint32_t>> m_keys;
+    std::vector<uint64_t>   m_codes;
+    std::vector<uint32_t>   m_order;    // sorted position -> original particle index
+    std::vector<float>      m_x, m_y, m_z, m_mass;
+    float                   m_rootSize;
+};
@@ -0,0 +1,54 @@
+#include "Particles.h"
+
+size_t Particles::size() const
+{
+    return x.size();
+}
+
+void Particles::resize(const size_t count)
+{
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    vx.resize(count);
+    vy.resize(count);
+    vz.resize(count);
+    mass.resize(count);
+}
+
+ParticleColumns Particles::columns() const
+{
+    return { x.data(), y.data(), z.data(), vx.data(), vy.data(), vz.data(), mass.data(), size() };
+}
+
+size_t Accelerations::size() const
+{
+    return x.size();
+}
+
+void Accelerations::resize(const size_t count)
+{
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+}
+
+void kick(Particles& particles, const Accelerations& accelerations, const float dt)
+{
+    for (auto i = 0u; i < particles.size(); ++i)
+    {
+        particles.vx[i] += accelerations.x[i] * dt;
+        particles.vy[i] += accelerations.y[i] * dt;
+        particles.vz[i] += accelerations.z[i] * dt;
+    }
+}
+
+void drift(Particles& particles, const float dt)
+{
+    for (auto i = 0u; i < particles.size(); ++i)
+    {
+        particles.x[i] += particles.vx[i] * dt;
+        particles.y[i] += particles.vy[i] * dt;
+        particles.z[i] += particles.vz[i] * dt;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Read only view of structure of arrays state wherever it lives, e.g. a Particles or a mapped checkpoint
+struct ParticleColumns
+{
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* vx;
+    const float* vy;
+    const float* vz;
+    const float* mass;
+    size_t count;
+};
+
+// Structure of arrays particle state, every column holds one value per particle
+struct Particles
+{
+    std::vector<float> x, y, z;
+    std::vector<float> vx, vy, vz;
+    std::vector<float> mass;
+
+    size_t size() const;
+
+    void resize(const size_t count);
+
+    ParticleColumns columns() const;
+};
+
+struct Accelerations
+{
+    std::vector<float> x, y, z;
+
+    size_t size() const;
+
+    void resize(const size_t count);
+};
+
+// Leapfrog halves - v += a * dt
+void kick(Particles& particles, const Accelerations& accelerations, const float dt);
+
+// x += v * dt
+void drift(Particles& particles, const float dt);
@@ -0,0 +1,689 @@
+#include "Trajectory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "parallel.h"
+
+namespace
+{
+
+constexpr char MAGIC[8] = { 'N', 'B', 'O', 'D', 'Y', 'T', 'R', 'J' };
+constexpr char FRAME_MAGIC[4] = { 'F', 'R', 'M', 'E' };
+constexpr char INDEX_MAGIC[8] = { 'N', 'B', 'O', 'D', 'Y', 'I', 'D', 'X' };
+
+// Last bytes of a closed trajectory, the index sits right before it
+struct TrajectoryTrailer
+{
+    uint64_t    indexOffset;
+    uint64_t    frameCount;
+    char        magic[8];
+};
+
+size_t chunkCount(const size_t count)
+{
+    return (count + TRAJECTORY_CHUNK - 1) / TRAJECTORY_CHUNK;
+}
+
+uint32_t maxQuantized(const uint32_t bits)
+{
+    return static_cast<uint32_t>((uint64_t(1) << bits) - 1);
+}
+
+uint32_t quantize(const float value, const float min, const float scale, const uint32_t max)
+{
+    const auto scaled = (value - min) * scale + 0.5f;
+
+    // NaNs land on the box corner rather than in undefined behaviour
+    if (!(scaled > 0.0f))
+    {
+        return 0;
+    }
+
+    return std::min(max, static_cast<uint32_t>(std::min(scaled, 4294967040.0f)));
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// false when the varint runs past `end` or over 64 bits
+bool getVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value)
+{
+    value = 0;
+    for (auto shift = 0u; shift < 64 and in != end; shift += 7)
+    {
+        const auto byte = *in++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Small deltas of either sign become small unsigned numbers, and so short varints
+uint64_t zigzag(const int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(const uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+template <class T>
+void append(std::vector<uint8_t>& out, const T& value)
+{
+    const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& path, const std::vector<float>& masses, const TrajectorySettings& settings)
+    : m_settings(settings), m_sinceKeyframe(0), m_count(masses.size()), m_dropped(0), m_bytes(0),
+      m_isClosing(false), m_isEncoderDone(false), m_isClosed(false)
+{
+    if (settings.bits < 1 or settings.bits > 24)
+    {
+        throw std::invalid_argument("trajectory precision must be between 1 and 24 bits");
+    }
+
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+    {
+        throw std::runtime_error("could not open trajectory for writing: " + path);
+    }
+
+    TrajectoryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = TRAJECTORY_VERSION;
+    header.headerSize = sizeof(TrajectoryHeader);
+    header.count = m_count;
+    header.bits = settings.bits;
+    header.keyframeInterval = settings.keyframeInterval;
+    header.stepsPerFrame = settings.stepsPerFrame;
+    header.dt = settings.dt;
+    header.chunkSize = TRAJECTORY_CHUNK;
+
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_file.write(reinterpret_cast<const char*>(masses.data()), masses.size() * sizeof(float));
+    m_bytes = sizeof(header) + masses.size() * sizeof(float);
+
+    m_slots.resize(std::max(1u, settings.queueDepth));
+    for (auto i = m_slots.size(); i > 0; --i)
+    {
+        m_free.push_back(i - 1);
+    }
+
+    m_encoder = std::thread([this]() { encode(); });
+    m_writer = std::thread([this]() { write(); });
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+    }
+}
+
+bool TrajectoryWriter::push(const uint64_t step, const double time, const Particles& particles)
+{
+    size_t slot;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_free.empty() or m_isClosing or m_error)
+        {
+            ++m_dropped;
+            return false;
+        }
+        slot = m_free.back();
+        m_free.pop_back();
+    }
+
+    // the slot belongs to this thread until it is queued, same sized columns keep their storage
+    auto& frame = m_slots[slot];
+    frame.step = step;
+    frame.time = time;
+    frame.x = particles.x;
+    frame.y = particles.y;
+    frame.z = particles.z;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pushed.push_back(slot);
+    }
+    m_framePushed.notify_one();
+
+    return true;
+}
+
+size_t TrajectoryWriter::freeSlots() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_isClosing or m_error ? 0 : m_free.size();
+}
+
+void TrajectoryWriter::drop()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_dropped;
+}
+
+void TrajectoryWriter::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_isClosed)
+        {
+            return;
+        }
+        m_isClosing = true;
+        m_isClosed = true;
+    }
+    m_framePushed.notify_one();
+
+    m_encoder.join();
+    m_writer.join();
+
+    if (!m_error)
+    {
+        TrajectoryTrailer trailer;
+        trailer.indexOffset = m_bytes;
+        trailer.frameCount = m_index.size();
+        std::memcpy(trailer.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+
+        m_file.write(reinterpret_cast<const char*>(m_index.data()), m_index.size() * sizeof(TrajectoryFrame));
+        m_file.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+        m_file.close();
+        m_bytes += m_index.size() * sizeof(TrajectoryFrame) + sizeof(trailer);
+
+        if (!m_file)
+        {
+            m_error = std::make_exception_ptr(std::runtime_error("could not write trajectory index"));
+        }
+    }
+
+    if (m_error)
+    {
+        std::rethrow_exception(m_error);
+    }
+}
+
+uint64_t TrajectoryWriter::frames() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index.size();
+}
+
+uint64_t TrajectoryWriter::droppedFrames() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+uint64_t TrajectoryWriter::bytesWritten() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+void TrajectoryWriter::encode()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_framePushed.wait(lock, [this]() { return m_isClosing or !m_pushed.empty(); });
+        if (m_pushed.empty())
+        {
+            break;
+        }
+
+        const auto slot = m_pushed.front();
+        m_pushed.pop_front();
+        const auto isFailed = static_cast<bool>(m_error);
+        lock.unlock();
+
+        EncodedFrame encoded;
+        if (!isFailed)
+        {
+            try
+            {
+                encoded = encodeFrame(m_slots[slot]);
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+            }
+        }
+
+        lock.lock();
+        m_free.push_back(slot);
+
+        // waits for the writer rather than dropping encoded work, push() is where frames get dropped once the slots run out
+        m_frameWritten.wait(lock, [this]() { return m_encoded.size() < m_slots.size() or m_error; });
+        if (!m_error)
+        {
+            m_encoded.push_back(std::move(encoded));
+            m_frameEncoded.notify_one();
+        }
+    }
+
+    m_isEncoderDone = true;
+    m_frameEncoded.notify_one();
+}
+
+void TrajectoryWriter::write()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_frameEncoded.wait(lock, [this]() { return m_isEncoderDone or !m_encoded.empty(); });
+        if (m_encoded.empty())
+        {
+            return;
+        }
+
+        auto frame = std::move(m_encoded.front());
+        m_encoded.pop_front();
+        frame.entry.offset = m_bytes;
+        lock.unlock();
+        m_frameWritten.notify_one();
+
+        m_file.write(reinterpret_cast<const char*>(frame.record.data()), frame.record.size());
+        if (!m_file)
+        {
+            fail(std::make_exception_ptr(std::runtime_error("could not write trajectory frame")));
+        }
+
+        lock.lock();
+        if (!m_error)
+        {
+            m_index.push_back(frame.entry);
+            m_bytes += frame.record.size();
+        }
+    }
+}
+
+TrajectoryWriter::EncodedFrame TrajectoryWriter::encodeFrame(const RawFrame& frame)
+{
+    const float* axes[] = { frame.x.data(), frame.y.data(), frame.z.data() };
+    const auto chunks = chunkCount(m_count);
+    const auto levels = maxQuantized(m_settings.bits);
+
+    // bounding box, one partial box per chunk
+    std::vector<float> chunkMin(3 * chunks, std::numeric_limits<float>::max());
+    std::vector<float> chunkMax(3 * chunks, std::numeric_limits<float>::lowest());
+    parallelFor(chunks, m_settings.threads, [&](const size_t begin, const size_t end) {
+        for (auto c = begin; c < end; ++c)
+        {
+            const auto last = std::min(m_count, (c + 1) * TRAJECTORY_CHUNK);
+            for (auto a = 0u; a < 3; ++a)
+            {
+                for (auto i = c * TRAJECTORY_CHUNK; i < last; ++i)
+                {
+                    chunkMin[3 * c + a] = std::min(chunkMin[3 * c + a], axes[a][i]);
+                    chunkMax[3 * c + a] = std::max(chunkMax[3 * c + a], axes[a][i]);
+                }
+            }
+        }
+    });
+
+    float lower[3], upper[3];
+    for (auto a = 0u; a < 3; ++a)
+    {
+        lower[a] = std::numeric_limits<float>::max();
+        upper[a] = std::numeric_limits<float>::lowest();
+        for (auto c = 0u; c < chunks; ++c)
+        {
+            lower[a] = std::min(lower[a], chunkMin[3 * c + a]);
+            upper[a] = std::max(upper[a], chunkMax[3 * c + a]);
+        }
+    }
+
+    auto isKeyframe = m_previous.empty() or m_sinceKeyframe + 1 >= m_settings.keyframeInterval;
+    for (auto a = 0u; a < 3 and !isKeyframe; ++a)
+    {
+        isKeyframe = lower[a] < m_boxMin[a] or upper[a] > m_boxMax[a];
+    }
+
+    if (isKeyframe)
+    {
+        for (auto a = 0u; a < 3; ++a)
+        {
+            const auto margin = TRAJECTORY_BOX_MARGIN * std::max(upper[a] - lower[a], 1e-6f);
+            m_boxMin[a] = m_count ? lower[a] - margin : 0.0f;
+            m_boxMax[a] = m_count ? upper[a] + margin : 1.0f;
+        }
+        m_previous.assign(3 * m_count, 0);
+        m_sinceKeyframe = 0;
+    }
+    else
+    {
+        ++m_sinceKeyframe;
+    }
+
+    float scale[3];
+    for (auto a = 0u; a < 3; ++a)
+    {
+        scale[a] = levels / (m_boxMax[a] - m_boxMin[a]);
+    }
+
+    // chunks code independently, so they spread over threads here and in TrajectoryReader alike
+    std::vector<std::vector<uint8_t>> payloads(chunks);
+    parallelFor(chunks, m_settings.threads, [&](const size_t begin, const size_t end) {
+        for (auto c = begin; c < end; ++c)
+        {
+            const auto first = c * TRAJECTORY_CHUNK;
+            const auto last = std::min(m_count, first + TRAJECTORY_CHUNK);
+
+            auto& out = payloads[c];
+            out.reserve(3 * (last - first) * 2);
+
+            for (auto a = 0u; a < 3; ++a)
+            {
+                auto* previous = m_previous.data() + a * m_count;
+                for (auto i = first; i < last; ++i)
+                {
+                    const auto q = quantize(axes[a][i], m_boxMin[a], scale[a], levels);
+                    putVarint(out, zigzag(static_cast<int64_t>(q) - previous[i]));
+                    previous[i] = q;
+                }
+            }
+        }
+    });
+
+    TrajectoryFrameHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, FRAME_MAGIC, sizeof(FRAME_MAGIC));
+    header.isKeyframe = isKeyframe;
+    header.step = frame.step;
+    header.time = frame.time;
+    std::copy(m_boxMin, m_boxMin + 3, header.boxMin);
+    std::copy(m_boxMax, m_boxMax + 3, header.boxMax);
+    header.payloadSize = chunks * sizeof(uint64_t);
+    for (const auto& payload : payloads)
+    {
+        header.payloadSize += payload.size();
+    }
+
+    EncodedFrame ret;
+    ret.entry.offset = 0;
+    ret.entry.step = frame.step;
+    ret.entry.time = frame.time;
+    ret.entry.isKeyframe = isKeyframe;
+    ret.entry.padding = 0;
+
+    ret.record.reserve(sizeof(header) + header.payloadSize);
+    append(ret.record, header);
+    for (const auto& payload : payloads)
+    {
+        append(ret.record, static_cast<uint64_t>(payload.size()));
+    }
+    for (const auto& payload : payloads)
+    {
+        ret.record.insert(ret.record.end(), payload.begin(), payload.end());
+    }
+
+    return ret;
+}
+
+void TrajectoryWriter::fail(std::exception_ptr error)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error) m_error = error;
+    }
+    m_frameWritten.notify_all();
+}
+
+TrajectoryReader::TrajectoryReader(const std::string& path)
+    : m_file(path, std::ios::binary)
+{
+    if (!m_file)
+    {
+        throw std::runtime_error("could not open trajectory: " + path);
+    }
+
+    if (!m_file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header)) or std::memcmp(m_header.magic, MAGIC, sizeof(MAGIC)))
+    {
+        throw std::runtime_error("not a trajectory: " + path);
+    }
+
+    if (m_header.version != TRAJECTORY_VERSION or m_header.headerSize != sizeof(TrajectoryHeader) or m_header.chunkSize != TRAJECTORY_CHUNK)
+    {
+        throw std::runtime_error("trajectory version " + std::to_string(m_header.version) + " is not supported, expected " + std::to_string(TRAJECTORY_VERSION) + ": " + path);
+    }
+
+    m_masses.resize(m_header.count);
+    if (!m_file.read(reinterpret_cast<char*>(m_masses.data()), m_masses.size() * sizeof(float)))
+    {
+        throw std::runtime_error("truncated trajectory: " + path);
+    }
+    const uint64_t firstFrame = m_file.tellg();
+
+    m_file.seekg(0, std::ios::end);
+    const uint64_t size = m_file.tellg();
+
+    TrajectoryTrailer trailer;
+    auto hasIndex = false;
+    if (size >= firstFrame + sizeof(trailer))
+    {
+        m_file.seekg(size - sizeof(trailer));
+        hasIndex = m_file.read(reinterpret_cast<char*>(&trailer), sizeof(trailer))
+            and !std::memcmp(trailer.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC))
+            and trailer.indexOffset + trailer.frameCount * sizeof(TrajectoryFrame) + sizeof(trailer) == size;
+    }
+
+    if (hasIndex)
+    {
+        m_index.resize(trailer.frameCount);
+        m_file.seekg(trailer.indexOffset);
+        m_file.read(reinterpret_cast<char*>(m_index.data()), m_index.size() * sizeof(TrajectoryFrame));
+    }
+    else
+    {
+        // never closed, e.g. the run was killed - every complete frame record is still good
+        m_file.clear();
+        auto offset = firstFrame;
+        TrajectoryFrameHeader header;
+        while (offset + sizeof(header) <= size)
+        {
+            m_file.seekg(offset);
+            if (!m_file.read(reinterpret_cast<char*>(&header), sizeof(header)) or std::memcmp(header.magic, FRAME_MAGIC, sizeof(FRAME_MAGIC)))
+            {
+                break;
+            }
+
+            if (offset + sizeof(header) + header.payloadSize > size)
+            {
+                break;
+            }
+
+            m_index.push_back({ offset, header.step, header.time, header.isKeyframe, 0 });
+            offset += sizeof(header) + header.payloadSize;
+        }
+    }
+
+    if (!m_file)
+    {
+        throw std::runtime_error("truncated trajectory: " + path);
+    }
+
+    m_decoded = m_index.size();
+}
+
+size_t TrajectoryReader::count() const
+{
+    return m_header.count;
+}
+
+size_t TrajectoryReader::frameCount() const
+{
+    return m_index.size();
+}
+
+const TrajectoryFrame& TrajectoryReader::frame(const size_t index) const
+{
+    return m_index[index];
+}
+
+const TrajectoryHeader& TrajectoryReader::header() const
+{
+    return m_header;
+}
+
+const std::vector<float>& TrajectoryReader::masses() const
+{
+    return m_masses;
+}
+
+size_t TrajectoryReader::find(const uint64_t step) const
+{
+    auto it = std::upper_bound(m_index.begin(), m_index.end(), step, [](const uint64_t s, const TrajectoryFrame& frame) {
+        return s < frame.step;
+    });
+
+    return it == m_index.begin() ? 0 : static_cast<size_t>(it - m_index.begin()) - 1;
+}
+
+void TrajectoryReader::read(const size_t index, float* x, float* y, float* z, const unsigned threads)
+{
+    if (index >= m_index.size())
+    {
+        throw std::out_of_range("trajectory frame " + std::to_string(index) + " of " + std::to_string(m_index.size()));
+    }
+
+    if (m_decoded != index)
+    {
+        // from the keyframe at or before `index`, or on from the frame decoded last when that lies in between
+        auto start = index;
+        while (start > 0 and !m_index[start].isKeyframe)
+        {
+            --start;
+        }
+        if (m_decoded < index and m_decoded >= start)
+        {
+            start = m_decoded + 1;
+        }
+
+        for (auto i = start; i <= index; ++i)
+        {
+            decode(i, threads);
+        }
+    }
+
+    const auto count = m_header.count;
+    const auto levels = maxQuantized(m_header.bits);
+    float* axes[] = { x, y, z };
+    for (auto a = 0u; a < 3; ++a)
+    {
+        const auto min = m_frameHeader.boxMin[a];
+        const auto step = (m_frameHeader.boxMax[a] - min) / levels;
+        const auto* quantized = m_quantized.data() + a * count;
+        auto* out = axes[a];
+
+        parallelFor(count, threads, [&](const size_t begin, const size_t end) {
+            for (auto i = begin; i < end; ++i)
+            {
+                out[i] = min + quantized[i] * step;
+            }
+        });
+    }
+}
+
+void TrajectoryReader::decode(const size_t index, const unsigned threads)
+{
+    const auto& entry = m_index[index];
+
+    m_file.seekg(entry.offset);
+    m_file.read(reinterpret_cast<char*>(&m_frameHeader), sizeof(m_frameHeader));
+    m_record.resize(m_frameHeader.payloadSize);
+    m_file.read(reinterpret_cast<char*>(m_record.data()), m_record.size());
+    if (!m_file)
+    {
+        m_file.clear();
+        m_decoded = m_index.size();
+        throw std::runtime_error("truncated trajectory frame " + std::to_string(index));
+    }
+
+    const auto count = m_header.count;
+    if (m_frameHeader.isKeyframe)
+    {
+        m_quantized.assign(3 * count, 0);
+    }
+    else if (m_quantized.size() != 3 * count)
+    {
+        m_decoded = m_index.size();
+        throw std::runtime_error("trajectory frame " + std::to_string(index) + " has no keyframe before it");
+    }
+
+    const auto chunks = chunkCount(count);
+    const auto* sizes = reinterpret_cast<const uint64_t*>(m_record.data());
+    std::vector<const uint8_t*> starts(chunks + 1);
+    starts[0] = m_record.data() + chunks * sizeof(uint64_t);
+    for (auto c = 0u; c < chunks; ++c)
+    {
+        starts[c + 1] = starts[c] + sizes[c];
+    }
+    if (starts[chunks] != m_record.data() + m_record.size())
+    {
+        m_decoded = m_index.size();
+        throw std::runtime_error("corrupt trajectory frame " + std::to_string(index));
+    }
+
+    // marked undecoded while m_quantized is half way between two frames
+    m_decoded = m_index.size();
+
+    // parallelFor threads must not throw, a bad chunk is reported once they are joined
+    std::atomic<bool> isCorrupt(false);
+    parallelFor(chunks, threads, [&](const size_t begin, const size_t end) {
+        for (auto c = begin; c < end; ++c)
+        {
+            const auto first = c * TRAJECTORY_CHUNK;
+            const auto last = std::min<size_t>(count, first + TRAJECTORY_CHUNK);
+            const auto* in = starts[c];
+
+            for (auto a = 0u; a < 3; ++a)
+            {
+                auto* quantized = m_quantized.data() + a * count;
+                for (auto i = first; i < last; ++i)
+                {
+                    uint64_t delta;
+                    if (!getVarint(in, starts[c + 1], delta))
+                    {
+                        isCorrupt = true;
+                        return;
+                    }
+                    quantized[i] = static_cast<uint32_t>(quantized[i] + unzigzag(delta));
+                }
+            }
+        }
+    });
+
+    if (isCorrupt)
+    {
+        throw std::runtime_error("corrupt trajectory frame " + std::to_string(index));
+    }
+
+    m_decoded = index;
+}
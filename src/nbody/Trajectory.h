@@ -0,0 +1,194 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Particles.h"
+
+constexpr uint32_t TRAJECTORY_VERSION = 1;
+
+// Particles per independently coded chunk, the unit frames are encoded and decoded in parallel by
+constexpr size_t TRAJECTORY_CHUNK = 64 * 1024;
+
+// A keyframe's quantization box is the frame's bounding box grown by this much of its extent on every side,
+// so the delta frames after it still fit
+constexpr float TRAJECTORY_BOX_MARGIN = 0.25f;
+
+struct TrajectorySettings
+{
+    uint32_t    bits = 16;                  // per coordinate, 1 to 24
+    uint32_t    keyframeInterval = 32;      // frames, a new box is also started as soon as a particle leaves the current one
+    uint32_t    stepsPerFrame = 1;
+    float       dt = 0.0f;
+    uint32_t    queueDepth = 4;             // frames waiting to be encoded before push() drops them
+    unsigned    threads = 1;                // encoding threads per frame
+};
+
+// Start of a trajectory file, little endian. The masses follow as `count` floats, then the frame records
+struct TrajectoryHeader
+{
+    char        magic[8];                   // "NBODYTRJ"
+    uint32_t    version;
+    uint32_t    headerSize;
+    uint64_t    count;
+    uint32_t    bits;
+    uint32_t    keyframeInterval;
+    uint32_t    stepsPerFrame;
+    float       dt;
+    uint64_t    chunkSize;                  // TRAJECTORY_CHUNK as written
+};
+static_assert(sizeof(TrajectoryHeader) == 48, "trajectory header layout changed, bump TRAJECTORY_VERSION");
+
+// Precedes every frame's chunk sizes and payload. Positions are quantized to `bits` inside [boxMin, boxMax] and stored
+// as zigzag varint deltas against the previous frame, or against 0 in a keyframe. Each chunk holds its x's, then y's, then z's
+struct TrajectoryFrameHeader
+{
+    char        magic[4];                   // "FRME"
+    uint32_t    isKeyframe;
+    uint64_t    step;
+    double      time;
+    float       boxMin[3];
+    float       boxMax[3];
+    uint64_t    payloadSize;                // chunk size table included
+};
+static_assert(sizeof(TrajectoryFrameHeader) == 56, "trajectory frame layout changed, bump TRAJECTORY_VERSION");
+
+// One frame of a trajectory as listed in its index
+struct TrajectoryFrame
+{
+    uint64_t    offset;                     // of the frame header from the start of the file
+    uint64_t    step;
+    double      time;
+    uint32_t    isKeyframe;
+    uint32_t    padding;
+};
+static_assert(sizeof(TrajectoryFrame) == 32, "trajectory index layout changed, bump TRAJECTORY_VERSION");
+
+// Records positions every few steps without ever holding up the simulation. push() copies the positions into one of
+// `queueDepth` free slots and returns - or drops the frame when the encoder is that far behind. An encoder thread quantizes
+// and delta codes the frames in order, a writer thread puts them on disk, and close() appends the frame index
+class TrajectoryWriter
+{
+public:
+    TrajectoryWriter(const std::string& path, const std::vector<float>& masses, const TrajectorySettings& settings);
+
+    TrajectoryWriter(const TrajectoryWriter& other) = delete;
+
+    // Closes the file if that did not happen yet, errors are lost then
+    ~TrajectoryWriter();
+
+    TrajectoryWriter& operator=(const TrajectoryWriter& other) = delete;
+
+    // false when the frame was dropped because every slot is still waiting to be encoded
+    bool push(const uint64_t step, const double time, const Particles& particles);
+
+    // Slots push() can fill right now, only it takes them. Lets a caller skip reading back a frame that would be dropped
+    size_t freeSlots() const;
+
+    // Counts a frame the caller dropped itself as freeSlots() had no room for it
+    void drop();
+
+    // Writes what was pushed so far and the index, then stops the threads. Rethrows what went wrong encoding or writing
+    void close();
+
+    uint64_t frames() const;
+
+    uint64_t droppedFrames() const;
+
+    uint64_t bytesWritten() const;
+
+private:
+    struct RawFrame
+    {
+        uint64_t            step = 0;
+        double              time = 0.0;
+        std::vector<float>  x, y, z;
+    };
+
+    struct EncodedFrame
+    {
+        TrajectoryFrame         entry;
+        std::vector<uint8_t>    record;     // header, chunk sizes and payload
+    };
+
+    void encode();
+
+    void write();
+
+    // Starts a new box when the frame does not fit the current one or the keyframe interval is up
+    EncodedFrame encodeFrame(const RawFrame& frame);
+
+    void fail(std::exception_ptr error);
+
+    TrajectorySettings          m_settings;
+    std::ofstream               m_file;
+    std::vector<RawFrame>       m_slots;
+    std::vector<size_t>         m_free;         // slot indices
+    std::deque<size_t>          m_pushed;       // slot indices in push order
+    std::deque<EncodedFrame>    m_encoded;
+    std::vector<TrajectoryFrame> m_index;
+    std::vector<uint32_t>       m_previous;     // quantized positions of the last encoded frame, x then y then z
+    float                       m_boxMin[3];
+    float                       m_boxMax[3];
+    uint32_t                    m_sinceKeyframe;
+    size_t                      m_count;
+    uint64_t                    m_dropped;
+    uint64_t                    m_bytes;
+    std::exception_ptr          m_error;
+    bool                        m_isClosing;
+    bool                        m_isEncoderDone;
+    bool                        m_isClosed;
+    mutable std::mutex          m_mutex;
+    std::condition_variable     m_framePushed;
+    std::condition_variable     m_frameEncoded;
+    std::condition_variable     m_frameWritten;    // room in m_encoded again
+    std::thread                 m_encoder;
+    std::thread                 m_writer;
+};
+
+// Random access into a trajectory file. The index is read from the end of the file, or rebuilt by walking the frame
+// records when the writer never got to close it. Reads continue from the last decoded frame when they can,
+// anything else decodes forward from the keyframe at or before the requested frame
+class TrajectoryReader
+{
+public:
+    // Throws std::runtime_error when the file is missing or not a trajectory of this version
+    explicit TrajectoryReader(const std::string& path);
+
+    size_t count() const;
+
+    size_t frameCount() const;
+
+    const TrajectoryFrame& frame(const size_t index) const;
+
+    const TrajectoryHeader& header() const;
+
+    const std::vector<float>& masses() const;
+
+    // Index of the last frame at or before `step`, 0 when the trajectory starts later
+    size_t find(const uint64_t step) const;
+
+    // Positions of frame `index` into count() floats each, chunks decoded on up to `threads` threads
+    void read(const size_t index, float* x, float* y, float* z, const unsigned threads = 1);
+
+private:
+    // Applies frame `index` on top of m_quantized, which has to hold the frame before it unless it is a keyframe
+    void decode(const size_t index, const unsigned threads);
+
+    std::ifstream               m_file;
+    TrajectoryHeader            m_header;
+    std::vector<float>          m_masses;
+    std::vector<TrajectoryFrame> m_index;
+    std::vector<uint32_t>       m_quantized;    // of m_decoded, x then y then z
+    std::vector<uint8_t>        m_record;
+    TrajectoryFrameHeader       m_frameHeader;
+    size_t                      m_decoded;      // frame in m_quantized, frameCount() for none
+};
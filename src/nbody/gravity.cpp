@@ -0,0 +1,125 @@
+#include "gravity.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+bool cpuSupports(const Kernel kernel)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    switch (kernel)
+    {
+        case Kernel::Scalar:
+            return true;
+        case Kernel::SSE:
+            return __builtin_cpu_supports("sse");
+        case Kernel::AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case Kernel::AVX512:
+            return __builtin_cpu_supports("avx512f");
+    }
+    return false;
+#else
+    return kernel == Kernel::Scalar;
+#endif
+}
+
+}
+
+void accelerateScalar(const Particles& particles, const float softening, const size_t begin, const size_t end, Accelerations& out)
+{
+    const auto count = particles.size();
+    const auto eps2 = softening * softening;
+
+    for (auto i = begin; i < end; ++i)
+    {
+        const auto xi = particles.x[i], yi = particles.y[i], zi = particles.z[i];
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+
+        for (auto j = 0u; j < count; ++j)
+        {
+            const auto dx = particles.x[j] - xi;
+            const auto dy = particles.y[j] - yi;
+            const auto dz = particles.z[j] - zi;
+
+            const auto r2 = dx * dx + dy * dy + dz * dz + eps2;
+            const auto invR = 1.0f / std::sqrt(r2);
+            const auto s = particles.mass[j] * invR * invR * invR;
+
+            ax += dx * s;
+            ay += dy * s;
+            az += dz * s;
+        }
+
+        out.x[i] = ax;
+        out.y[i] = ay;
+        out.z[i] = az;
+    }
+}
+
+const char* toString(const Kernel kernel)
+{
+    switch (kernel)
+    {
+        case Kernel::Scalar:
+            return "scalar";
+        case Kernel::SSE:
+            return "sse";
+        case Kernel::AVX2:
+            return "avx2";
+        case Kernel::AVX512:
+            return "avx512";
+    }
+    return "unknown";
+}
+
+Kernel parseKernel(const char* name)
+{
+    for (auto kernel : {Kernel::Scalar, Kernel::SSE, Kernel::AVX2, Kernel::AVX512})
+    {
+        if (!strcmp(name, toString(kernel)))
+        {
+            return kernel;
+        }
+    }
+
+    throw std::invalid_argument(std::string("unknown force kernel: ") + name);
+}
+
+bool isSupported(const Kernel kernel)
+{
+    return forceKernel(kernel) != nullptr and cpuSupports(kernel);
+}
+
+Kernel bestKernel()
+{
+    for (auto kernel : {Kernel::AVX512, Kernel::AVX2, Kernel::SSE})
+    {
+        if (isSupported(kernel))
+        {
+            return kernel;
+        }
+    }
+
+    return Kernel::Scalar;
+}
+
+ForceKernel forceKernel(const Kernel kernel)
+{
+    switch (kernel)
+    {
+        case Kernel::Scalar:
+            return &accelerateScalar;
+        case Kernel::SSE:
+            return sseKernel();
+        case Kernel::AVX2:
+            return avx2Kernel();
+        case Kernel::AVX512:
+            return avx512Kernel();
+    }
+    return nullptr;
+}
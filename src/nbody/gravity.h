@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Particles.h"
+
+// All pairs gravity in N-body units (G = 1) with Plummer softening
+
+enum class Kernel
+{
+    Scalar,
+    SSE,
+    AVX2,
+    AVX512
+};
+
+// Writes the accelerations of particles [begin, end) caused by every particle
+using ForceKernel = void (*)(
+    const Particles& particles, const float softening, 
+    const size_t begin, const size_t end, 
+    Accelerations& out
+);
+
+void accelerateScalar(const Particles& particles, const float softening, const size_t begin, const size_t end, Accelerations& out);
+
+// Each of these returns nullptr when the compiler could not target the instruction set
+ForceKernel sseKernel();
+
+ForceKernel avx2Kernel();
+
+ForceKernel avx512Kernel();
+
+const char* toString(const Kernel kernel);
+
+Kernel parseKernel(const char* name);
+
+// Compiled in and supported by the running CPU
+bool isSupported(const Kernel kernel);
+
+// Widest supported kernel
+Kernel bestKernel();
+
+ForceKernel forceKernel(const Kernel kernel);
@@ -0,0 +1,65 @@
+#include "gravity.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+namespace
+{
+
+void accelerateAVX2(const Particles& particles, const float softening, const size_t begin, const size_t end, Accelerations& out)
+{
+    const auto count = particles.size();
+    const auto eps2 = _mm256_set1_ps(softening * softening);
+    const auto half = _mm256_set1_ps(0.5f);
+    const auto threeHalves = _mm256_set1_ps(1.5f);
+
+    auto i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        const auto xi = _mm256_loadu_ps(&particles.x[i]);
+        const auto yi = _mm256_loadu_ps(&particles.y[i]);
+        const auto zi = _mm256_loadu_ps(&particles.z[i]);
+        auto ax = _mm256_setzero_ps(), ay = _mm256_setzero_ps(), az = _mm256_setzero_ps();
+
+        for (auto j = 0u; j < count; ++j)
+        {
+            const auto dx = _mm256_sub_ps(_mm256_broadcast_ss(&particles.x[j]), xi);
+            const auto dy = _mm256_sub_ps(_mm256_broadcast_ss(&particles.y[j]), yi);
+            const auto dz = _mm256_sub_ps(_mm256_broadcast_ss(&particles.z[j]), zi);
+
+            const auto r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_fmadd_ps(dz, dz, eps2)));
+
+            // rsqrt estimate refined by one Newton-Raphson step
+            auto invR = _mm256_rsqrt_ps(r2);
+            invR = _mm256_mul_ps(invR, _mm256_fnmadd_ps(_mm256_mul_ps(half, r2), _mm256_mul_ps(invR, invR), threeHalves));
+
+            const auto s = _mm256_mul_ps(_mm256_broadcast_ss(&particles.mass[j]), _mm256_mul_ps(invR, _mm256_mul_ps(invR, invR)));
+
+            ax = _mm256_fmadd_ps(dx, s, ax);
+            ay = _mm256_fmadd_ps(dy, s, ay);
+            az = _mm256_fmadd_ps(dz, s, az);
+        }
+
+        _mm256_storeu_ps(&out.x[i], ax);
+        _mm256_storeu_ps(&out.y[i], ay);
+        _mm256_storeu_ps(&out.z[i], az);
+    }
+
+    accelerateScalar(particles, softening, i, end, out);
+}
+
+}
+
+ForceKernel avx2Kernel()
+{
+    return &accelerateAVX2;
+}
+
+#else
+
+ForceKernel avx2Kernel()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#include "gravity.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+namespace
+{
+
+void accelerateAVX512(const Particles& particles, const float softening, const size_t begin, const size_t end, Accelerations& out)
+{
+    const auto count = particles.size();
+    const auto eps2 = _mm512_set1_ps(softening * softening);
+    const auto half = _mm512_set1_ps(0.5f);
+    const auto threeHalves = _mm512_set1_ps(1.5f);
+
+    auto i = begin;
+    for (; i + 16 <= end; i += 16)
+    {
+        const auto xi = _mm512_loadu_ps(&particles.x[i]);
+        const auto yi = _mm512_loadu_ps(&particles.y[i]);
+        const auto zi = _mm512_loadu_ps(&particles.z[i]);
+        auto ax = _mm512_setzero_ps(), ay = _mm512_setzero_ps(), az = _mm512_setzero_ps();
+
+        for (auto j = 0u; j < count; ++j)
+        {
+            const auto dx = _mm512_sub_ps(_mm512_set1_ps(particles.x[j]), xi);
+            const auto dy = _mm512_sub_ps(_mm512_set1_ps(particles.y[j]), yi);
+            const auto dz = _mm512_sub_ps(_mm512_set1_ps(particles.z[j]), zi);
+
+            const auto r2 = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_fmadd_ps(dz, dz, eps2)));
+
+            // rsqrt estimate refined by one Newton-Raphson step
+            auto invR = _mm512_rsqrt14_ps(r2);
+            invR = _mm512_mul_ps(invR, _mm512_fnmadd_ps(_mm512_mul_ps(half, r2), _mm512_mul_ps(invR, invR), threeHalves));
+
+            const auto s = _mm512_mul_ps(_mm512_set1_ps(particles.mass[j]), _mm512_mul_ps(invR, _mm512_mul_ps(invR, invR)));
+
+            ax = _mm512_fmadd_ps(dx, s, ax);
+            ay = _mm512_fmadd_ps(dy, s, ay);
+            az = _mm512_fmadd_ps(dz, s, az);
+        }
+
+        _mm512_storeu_ps(&out.x[i], ax);
+        _mm512_storeu_ps(&out.y[i], ay);
+        _mm512_storeu_ps(&out.z[i], az);
+    }
+
+    accelerateScalar(particles, softening, i, end, out);
+}
+
+}
+
+ForceKernel avx512Kernel()
+{
+    return &accelerateAVX512;
+}
+
+#else
+
+ForceKernel avx512Kernel()
+{
+    return nullptr;
+}
+
+#endif
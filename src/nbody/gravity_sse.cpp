@@ -0,0 +1,65 @@
+#include "gravity.h"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+
+namespace
+{
+
+void accelerateSSE(const Particles& particles, const float softening, const size_t begin, const size_t end, Accelerations& out)
+{
+    const auto count = particles.size();
+    const auto eps2 = _mm_set1_ps(softening * softening);
+    const auto half = _mm_set1_ps(0.5f);
+    const auto threeHalves = _mm_set1_ps(1.5f);
+
+    auto i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        const auto xi = _mm_loadu_ps(&particles.x[i]);
+        const auto yi = _mm_loadu_ps(&particles.y[i]);
+        const auto zi = _mm_loadu_ps(&particles.z[i]);
+        auto ax = _mm_setzero_ps(), ay = _mm_setzero_ps(), az = _mm_setzero_ps();
+
+        for (auto j = 0u; j < count; ++j)
+        {
+            const auto dx = _mm_sub_ps(_mm_set1_ps(particles.x[j]), xi);
+            const auto dy = _mm_sub_ps(_mm_set1_ps(particles.y[j]), yi);
+            const auto dz = _mm_sub_ps(_mm_set1_ps(particles.z[j]), zi);
+
+            const auto r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_add_ps(_mm_mul_ps(dz, dz), eps2));
+
+            // rsqrt estimate refined by one Newton-Raphson step
+            auto invR = _mm_rsqrt_ps(r2);
+            invR = _mm_mul_ps(invR, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, r2), _mm_mul_ps(invR, invR))));
+
+            const auto s = _mm_mul_ps(_mm_set1_ps(particles.mass[j]), _mm_mul_ps(invR, _mm_mul_ps(invR, invR)));
+
+            ax = _mm_add_ps(ax, _mm_mul_ps(dx, s));
+            ay = _mm_add_ps(ay, _mm_mul_ps(dy, s));
+            az = _mm_add_ps(az, _mm_mul_ps(dz, s));
+        }
+
+        _mm_storeu_ps(&out.x[i], ax);
+        _mm_storeu_ps(&out.y[i], ay);
+        _mm_storeu_ps(&out.z[i], az);
+    }
+
+    accelerateScalar(particles, softening, i, end, out);
+}
+
+}
+
+ForceKernel sseKernel()
+{
+    return &accelerateSSE;
+}
+
+#else
+
+ForceKernel sseKernel()
+{
+    return nullptr;
+}
+
+#endif
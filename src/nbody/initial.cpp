@@ -0,0 +1,294 @@
+#include "initial.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "parallel.h"
+
+namespace
+{
+
+constexpr uint32_t PHILOX_M0 = 0xD2511F53;
+constexpr uint32_t PHILOX_M1 = 0xCD9E8D57;
+constexpr uint32_t PHILOX_W0 = 0x9E3779B9;
+constexpr uint32_t PHILOX_W1 = 0xBB67AE85;
+
+constexpr float PI = 3.14159265f;
+
+// The stream of particle `index` - block b is Philox4x32-10 of the counter (index, b, 0, 0), four draws each
+class Random
+{
+public:
+    Random(const uint32_t index, const uint32_t seed)
+        : m_index(index), m_seed(seed), m_block(0), m_used(4)
+    {
+    }
+
+    // In (0, 1], 24 bits, so it is exact in a float and safe to take the log of
+    float uniform()
+    {
+        if (m_used == 4)
+        {
+            refill();
+        }
+
+        return static_cast<float>((m_words[m_used++] >> 8) + 1) * (1.0f / 16777216.0f);
+    }
+
+    // In (-1, 1]
+    float symmetric()
+    {
+        return 2.0f * uniform() - 1.0f;
+    }
+
+private:
+    void refill()
+    {
+        uint32_t counter[4] = { m_index, m_block++, 0, 0 };
+        uint32_t key[2] = { m_seed, 0 };
+
+        for (auto round = 0; round < 10; ++round)
+        {
+            if (round)
+            {
+                key[0] += PHILOX_W0;
+                key[1] += PHILOX_W1;
+            }
+
+            const auto product0 = static_cast<uint64_t>(PHILOX_M0) * counter[0];
+            const auto product1 = static_cast<uint64_t>(PHILOX_M1) * counter[2];
+
+            const uint32_t next[4] = {
+                static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                static_cast<uint32_t>(product1),
+                static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                static_cast<uint32_t>(product0)
+            };
+            std::memcpy(counter, next, sizeof(counter));
+        }
+
+        std::memcpy(m_words, counter, sizeof(m_words));
+        m_used = 0;
+    }
+
+    uint32_t m_index;
+    uint32_t m_seed;
+    uint32_t m_block;
+    uint32_t m_used;
+    uint32_t m_words[4];
+};
+
+struct Body
+{
+    float position[3];
+    float velocity[3];
+};
+
+// Uniformly on the unit sphere
+void direction(Random& random, float (&out)[3])
+{
+    const auto cosTheta = random.symmetric();
+    const auto sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    const auto phi = 2.0f * PI * random.uniform();
+
+    out[0] = sinTheta * std::cos(phi);
+    out[1] = sinTheta * std::sin(phi);
+    out[2] = cosTheta;
+}
+
+Body sphere(Random& random)
+{
+    float x = 0.0f, y = 0.0f, z = 0.0f, r2 = 0.0f;
+    for (auto attempt = 0u; attempt < INITIAL_ATTEMPTS; ++attempt)
+    {
+        x = random.symmetric();
+        y = random.symmetric();
+        z = random.symmetric();
+        r2 = x * x + y * y + z * z;
+        if (r2 <= 1.0f)
+        {
+            break;
+        }
+    }
+
+    // pulled onto the surface in the unlikely case no attempt landed inside
+    if (r2 > 1.0f)
+    {
+        const auto scale = 1.0f / std::sqrt(r2);
+        x *= scale;
+        y *= scale;
+        z *= scale;
+    }
+
+    return { { x, y, z }, { -SPHERE_OMEGA * y, SPHERE_OMEGA * x, 0.0f } };
+}
+
+// Aarseth, Henon & Wielen (1974) - radius from the cumulative mass, speed from the distribution function by rejection
+Body plummer(Random& random)
+{
+    const auto massFraction = PLUMMER_MASS_CUTOFF * random.uniform();
+    const auto r = 1.0f / std::sqrt(std::pow(massFraction, -2.0f / 3.0f) - 1.0f);
+
+    float q = 0.0f;
+    for (auto attempt = 0u; attempt < INITIAL_ATTEMPTS; ++attempt)
+    {
+        q = random.uniform();
+        const auto g = 0.1f * random.uniform();
+        if (g < q * q * std::pow(1.0f - q * q, 3.5f))
+        {
+            break;
+        }
+    }
+
+    // escape speed in units of G = M = a = 1, then scaled to a = PLUMMER_RADIUS
+    const auto speed = q * std::sqrt(2.0f) * std::pow(1.0f + r * r, -0.25f) / std::sqrt(PLUMMER_RADIUS);
+
+    float position[3], velocity[3];
+    direction(random, position);
+    direction(random, velocity);
+
+    return {
+        { PLUMMER_RADIUS * r * position[0], PLUMMER_RADIUS * r * position[1], PLUMMER_RADIUS * r * position[2] },
+        { speed * velocity[0], speed * velocity[1], speed * velocity[2] }
+    };
+}
+
+Body cube(Random& random)
+{
+    const auto x = random.symmetric();
+    const auto y = random.symmetric();
+    const auto z = random.symmetric();
+
+    return { { x, y, z }, { 0.0f, 0.0f, 0.0f } };
+}
+
+// Surface density falling off as exp(-R / DISK_SCALE_LENGTH) - the radius is the sum of two exponential draws, R exp(-R) being
+// the radial density. Circular orbits around the mass inside R as if it were a softened point mass
+Body disk(Random& random, const float mass)
+{
+    // drawn one at a time, the order of the draws is part of the stream
+    const auto u0 = random.uniform();
+    const auto R = -DISK_SCALE_LENGTH * std::log(u0 * random.uniform());
+    const auto phi = 2.0f * PI * random.uniform();
+    const auto z = DISK_THICKNESS * random.symmetric();
+
+    const auto enclosed = mass * (1.0f - (1.0f + R / DISK_SCALE_LENGTH) * std::exp(-R / DISK_SCALE_LENGTH));
+    const auto speed = std::sqrt(enclosed * R * R / std::pow(R * R + DISK_CORE * DISK_CORE, 1.5f));
+
+    const auto c = std::cos(phi);
+    const auto s = std::sin(phi);
+
+    return { { R * c, R * s, z }, { -speed * s, speed * c, 0.0f } };
+}
+
+// Even particles make up the first disk, odd ones the second
+Body collision(Random& random, const uint32_t index)
+{
+    auto body = disk(random, 0.5f);
+    const auto side = index & 1 ? 1.0f : -1.0f;
+
+    if (index & 1)
+    {
+        const auto c = std::cos(COLLISION_TILT);
+        const auto s = std::sin(COLLISION_TILT);
+        for (auto v : { body.position, body.velocity })
+        {
+            const auto y = v[1];
+            const auto z = v[2];
+            v[1] = c * y - s * z;
+            v[2] = s * y + c * z;
+        }
+    }
+
+    body.position[0] += 0.5f * side * COLLISION_SEPARATION;
+    body.position[1] += 0.5f * side * COLLISION_IMPACT;
+    body.velocity[0] -= side * COLLISION_SPEED;
+
+    return body;
+}
+
+Body generate(const Distribution distribution, const uint32_t index, const uint32_t seed)
+{
+    Random random(index, seed);
+
+    switch (distribution)
+    {
+        case Distribution::Sphere:
+            return sphere(random);
+        case Distribution::Plummer:
+            return plummer(random);
+        case Distribution::Cube:
+            return cube(random);
+        case Distribution::Disk:
+            return disk(random, 1.0f);
+        case Distribution::Collision:
+            return collision(random, index);
+    }
+    return sphere(random);
+}
+
+}
+
+const char* toString(const Distribution distribution)
+{
+    switch (distribution)
+    {
+        case Distribution::Sphere:
+            return "sphere";
+        case Distribution::Plummer:
+            return "plummer";
+        case Distribution::Cube:
+            return "cube";
+        case Distribution::Disk:
+            return "disk";
+        case Distribution::Collision:
+            return "collision";
+    }
+    return "unknown";
+}
+
+Distribution parseDistribution(const char* name)
+{
+    for (auto distribution : {Distribution::Sphere, Distribution::Plummer, Distribution::Cube, Distribution::Disk, Distribution::Collision})
+    {
+        if (!strcmp(name, toString(distribution)))
+        {
+            return distribution;
+        }
+    }
+
+    throw std::invalid_argument(std::string("unknown initial distribution: ") + name);
+}
+
+Particles generateParticles(const Distribution distribution, const size_t count, const uint32_t seed, const unsigned threads)
+{
+    Particles ret;
+    ret.resize(count);
+
+    const auto mass = 1.0f / count;
+
+    parallelFor(count, threads, [&](const size_t begin, const size_t end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            const auto body = generate(distribution, static_cast<uint32_t>(i), seed);
+
+            ret.x[i] = body.position[0];
+            ret.y[i] = body.position[1];
+            ret.z[i] = body.position[2];
+            ret.vx[i] = body.velocity[0];
+            ret.vy[i] = body.velocity[1];
+            ret.vz[i] = body.velocity[2];
+            ret.mass[i] = mass;
+        }
+    });
+
+    return ret;
+}
+
+Particles uniformSphere(const size_t count, const uint32_t seed)
+{
+    return generateParticles(Distribution::Sphere, count, seed);
+}
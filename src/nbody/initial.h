@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Particles.h"
+
+// Shapes of the generated initial conditions, all of unit total mass with G = 1 and every particle weighing 1 / count.
+// src/initial.comp generates them on the GPU, its constants and the order of these have to match
+enum class Distribution
+{
+    Sphere,         // uniform ball of unit radius, slowly rotating around z
+    Plummer,        // Plummer sphere in virial equilibrium
+    Cube,           // uniform cube of side 2 at rest, a cold collapse
+    Disk,           // rotating exponential disk in the xy plane
+    Collision       // two disks of half the mass each on a collision course
+};
+
+// Angular velocity of the uniform ball, close to rotational support at its edge
+constexpr float SPHERE_OMEGA = 0.5f;
+
+// Plummer scale radius, 3 pi / 16 puts the virial radius at 1. The outermost 0.1% of the mass is left out,
+// it would otherwise be spread out arbitrarily far
+constexpr float PLUMMER_RADIUS = 0.58904862f;
+constexpr float PLUMMER_MASS_CUTOFF = 0.999f;
+
+// Exponential disk - scale length, half thickness, and the core the rotation curve is softened by at the center
+constexpr float DISK_SCALE_LENGTH = 0.25f;
+constexpr float DISK_THICKNESS = 0.02f;
+constexpr float DISK_CORE = 0.05f;
+
+// The two disks start COLLISION_SEPARATION apart along x and COLLISION_IMPACT along y, each heading for the other at
+// COLLISION_SPEED. The second one is tilted by COLLISION_TILT radians around x
+constexpr float COLLISION_SEPARATION = 3.0f;
+constexpr float COLLISION_IMPACT = 0.5f;
+constexpr float COLLISION_SPEED = 0.3f;
+constexpr float COLLISION_TILT = 0.78539816f;
+
+// Draws a rejection sampler makes per particle before it settles for what it has
+constexpr uint32_t INITIAL_ATTEMPTS = 64;
+
+const char* toString(const Distribution distribution);
+
+Distribution parseDistribution(const char* name);
+
+// Particle i draws its random numbers from Philox4x32-10 keyed by the seed with i as the counter, so it does not depend on
+// any other particle - the set comes out bit for bit the same from the same seed however many threads generate it.
+// initial.comp draws the same random numbers, but the GPU's transcendentals round differently. The cube and the disks
+// come out the same within float precision. The sphere's and the Plummer sphere's rejection loops compare against rounded
+// values, so a GPU particle can accept a different attempt and end up somewhere else entirely - the same distribution,
+// not the same particles
+Particles generateParticles(const Distribution distribution, const size_t count, const uint32_t seed, const unsigned threads = 1);
+
+// Uniform ball of unit radius and unit total mass, slowly rotating around z
+Particles uniformSphere(const size_t count, const uint32_t seed);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "BarnesHutEngine.h"
+#include "Checkpoint.h"
+#include "DirectEngine.h"
+#include "Engine.h"
+#include "gravity.h"
+#include "initial.h"
+#include "Octree.h"
+#include "parallel.h"
+#include "Particles.h"
+#include "Trajectory.h"
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Splits [0, count) into one contiguous chunk per thread and runs func(begin, end) on each, the calling thread takes the last chunk
+template <class Func>
+void parallelFor(const size_t count, const unsigned threads, const Func& func)
+{
+    const auto workers = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(count)));
+    const auto chunk = (count + workers - 1) / workers;
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (auto t = 0u; t + 1 < workers; ++t)
+    {
+        pool.emplace_back(func, t * chunk, std::min(count, (t + 1) * chunk));
+    }
+
+    func(std::min(count, (workers - 1) * chunk), count);
+
+    for (auto& thread : pool)
+    {
+        thread.join();
+    }
+}
@@ -2,9 +2,17 @@
 #extension GL_ARB_separate_shader_objects : enable
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragCorner;     // [-1, 1] across a billboard, points only ever see the center
 layout(location = 0) out vec4 outColor;
 
 void main() 
 {
-    outColor = vec4(fragColor, 1.0);
+    // round billboards, dimmer towards the rim
+    const float r2 = dot(fragCorner, fragCorner);
+    if (r2 > 1.0)
+    {
+        discard;
+    }
+
+    outColor = vec4(fragColor * (1.0 - 0.5 * r2), 1.0);
 }
\ No newline at end of file
@@ -1,18 +1,30 @@
 #version 450
 
-layout (binding = 0) uniform MVPTransform
+// FrameConstants, one slice of the ring per frame in flight
+layout (binding = 0) uniform Frame
 {
     mat4 transform;
-} uMVP;
+    vec4 camera;
+    float time;
+    float dt;
+    uint particleCount;
+    float rewind;
+    vec2 billboardScale;
+} uFrame;
 
-layout (location = 0) in vec2 iPosition;
-layout (location = 1) in vec3 iColor;
+layout (location = 0) in vec4 iPosition;
+layout (location = 1) in vec3 iVelocity;
 
 layout (location = 0) out vec3 oFragColor;
+layout (location = 1) out vec2 oCorner;
+
+const vec3 SLOW_COLOR = vec3(0.3, 0.5, 1.0);
+const vec3 FAST_COLOR = vec3(1.0, 0.6, 0.2);
 
 void main()
 {
-    gl_Position = uMVP.transform * vec4(iPosition, 0.0, 1.0);
-    oFragColor = iColor;
-    gl_PointSize = 10;
-}
\ No newline at end of file
+    gl_Position = uFrame.transform * vec4(iPosition.xyz + iVelocity * uFrame.rewind, 1.0);
+    oFragColor = mix(SLOW_COLOR, FAST_COLOR, clamp(length(iVelocity), 0.0, 1.0));
+    oCorner = vec2(0.0);
+    gl_PointSize = 2;
+}
@@ -0,0 +1,286 @@
+#include "Autotuner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "BoundedBuffer.h"
+#include "shaders.h"
+#include "Vertex.h"
+
+namespace
+{
+
+constexpr uint32_t WORKGROUP_SIZES[] = { 64, 128, 256, 512, 1024 };
+constexpr uint32_t TILE_WORKGROUPS[] = { 1, 2, 4 };
+
+// Dispatches per timed submit, and timed submits per candidate after one warm-up - the fastest submit counts
+constexpr uint32_t DISPATCHES = 2;
+constexpr uint32_t SUBMITS = 3;
+
+// The Step push constant block of nbody.comp
+struct StepConstants
+{
+    uint32_t    count;
+    float       dt;
+    float       softening2;
+    uint32_t    snapshot;
+};
+
+std::string deviceKey(const vk::PhysicalDeviceProperties& properties)
+{
+    std::ostringstream key;
+    key << std::hex << std::setfill('0') 
+        << std::setw(4) << properties.vendorID << '-' 
+        << std::setw(4) << properties.deviceID << '-';
+    for (auto byte : properties.pipelineCacheUUID)
+    {
+        key << std::setw(2) << static_cast<unsigned>(byte);
+    }
+    key << '-' << std::dec << properties.driverVersion;
+
+    return key.str();
+}
+
+}
+
+Autotuner::Autotuner(
+    const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, const uint32_t computeFamilyIndex, const uint32_t computeQueueIndex,
+    const PipelineCache& pipelineCache, const std::string& directory)
+    : m_physicalDevice(physicalDevice), m_device(dev), m_pipelineCache(&pipelineCache), 
+      m_path(directory + '/' + config::AUTOTUNE_FILE), m_key(deviceKey(physicalDevice.getProperties())), m_computeFamily(computeFamilyIndex)
+{
+    m_queue = dev.getQueue(computeFamilyIndex, computeQueueIndex);
+}
+
+std::optional<ComputeTuning> Autotuner::load() const
+{
+    std::ifstream file(m_path);
+
+    std::string key;
+    ComputeTuning tuning;
+    while (file >> key >> tuning.workgroupSize >> tuning.tileSize)
+    {
+        if (key == m_key)
+        {
+            return tuning;
+        }
+    }
+
+    return std::nullopt;
+}
+
+ComputeTuning Autotuner::tune(const uint32_t simulatedCount) const
+{
+    const auto count = std::min(simulatedCount, config::AUTOTUNE_PARTICLES);
+    std::cout << "Autotuning compute kernels on " << count << " particles for " << simulatedCount << '\n';
+
+    // Only the cost of the interactions matters, zeroed particles have every one of them and keep dt = 0 steps stable
+    auto size = sizeof(Vertex) * count;
+    BoundedBuffer particles(
+        m_physicalDevice, m_device, 
+        size, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, 
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
+
+    // Where the force pass keeps its accelerations. Frames are never written without a snapshot, it stands in for one too
+    BoundedBuffer accelerations(
+        m_physicalDevice, m_device,
+        sizeof(float) * 4 * count, vk::BufferUsageFlagBits::eStorageBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
+
+    const vk::DescriptorSetLayoutBinding bindings[] = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute)
+    };
+    auto descriptorSetLayout = m_device.createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo(vk::DescriptorSetLayoutCreateFlags(), 3, bindings));
+
+    vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, 3);
+    auto descriptorPool = m_device.createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo(vk::DescriptorPoolCreateFlags(), 1, 1, &poolSize));
+    auto descriptorSet = m_device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(*descriptorPool, 1, &*descriptorSetLayout))[0];
+
+    vk::DescriptorBufferInfo particlesInfo(particles.buffer(), 0, VK_WHOLE_SIZE);
+    vk::DescriptorBufferInfo accelerationsInfo(accelerations.buffer(), 0, VK_WHOLE_SIZE);
+    m_device.updateDescriptorSets({
+        vk::WriteDescriptorSet(descriptorSet, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &particlesInfo),
+        vk::WriteDescriptorSet(descriptorSet, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &accelerationsInfo),
+        vk::WriteDescriptorSet(descriptorSet, 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &accelerationsInfo)
+    }, {});
+
+    vk::PushConstantRange pushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(StepConstants));
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo;
+    pipelineLayoutInfo.setSetLayoutCount(1);
+    pipelineLayoutInfo.setPSetLayouts(&*descriptorSetLayout);
+    pipelineLayoutInfo.setPushConstantRangeCount(1);
+    pipelineLayoutInfo.setPPushConstantRanges(&pushConstants);
+    auto pipelineLayout = m_device.createPipelineLayoutUnique(pipelineLayoutInfo);
+
+    auto commandPool = m_device.createCommandPoolUnique(vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eTransient, m_computeFamily));
+
+    {
+        auto clear = m_device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(*commandPool, vk::CommandBufferLevel::ePrimary, 1))[0];
+        clear.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        clear.fillBuffer(particles.buffer(), 0, VK_WHOLE_SIZE, 0);
+        clear.end();
+
+        m_queue.submit({ vk::SubmitInfo(0, nullptr, nullptr, 1, &clear) }, vk::Fence());
+        m_queue.waitIdle();
+        m_device.resetCommandPool(*commandPool, vk::CommandPoolResetFlags());
+    }
+
+    auto shader = loadShaderModule(m_device, "nbody.spv");
+
+    ComputeTuning best;
+    auto bestTime = std::numeric_limits<double>::max();
+    for (const auto& candidate : candidates())
+    {
+        auto milliseconds = measure(candidate, count, *shader, *pipelineLayout, descriptorSet, *commandPool);
+        std::cout << "  " << candidate.toString() << ": " << milliseconds << "ms\n";
+
+        if (milliseconds < bestTime)
+        {
+            best = candidate;
+            bestTime = milliseconds;
+        }
+    }
+
+    std::cout << "Tuned compute kernels: " << best.toString() << '\n';
+    save(best);
+
+    return best;
+}
+
+std::vector<ComputeTuning> Autotuner::candidates() const
+{
+    const auto limits = m_physicalDevice.getProperties().limits;
+    const auto maxTile = limits.maxComputeSharedMemorySize / (4 * sizeof(float));
+
+    std::vector<ComputeTuning> ret;
+    for (auto workgroupSize : WORKGROUP_SIZES)
+    {
+        if (workgroupSize > limits.maxComputeWorkGroupSize[0] or workgroupSize > limits.maxComputeWorkGroupInvocations)
+        {
+            continue;
+        }
+
+        for (auto workgroups : TILE_WORKGROUPS)
+        {
+            ComputeTuning tuning;
+            tuning.workgroupSize = workgroupSize;
+            tuning.tileSize = workgroupSize * workgroups;
+            if (tuning.tileSize <= maxTile)
+            {
+                ret.push_back(tuning);
+            }
+        }
+    }
+
+    return ret;
+}
+
+double Autotuner::measure(
+    const ComputeTuning& tuning, const uint32_t count, 
+    const vk::ShaderModule& shader, const vk::PipelineLayout& layout, const vk::DescriptorSet& descriptorSet, 
+    const vk::CommandPool& commandPool) const
+{
+    const auto specialization = tuning.specializationInfo();
+    vk::ComputePipelineCreateInfo pipelineInfo(
+        vk::PipelineCreateFlags(),
+        vk::PipelineShaderStageCreateInfo(
+            vk::PipelineShaderStageCreateFlags(), 
+            vk::ShaderStageFlagBits::eCompute, 
+            shader, 
+            "main",
+            &specialization
+        ),
+        layout
+    );
+    auto pipeline = m_pipelineCache->createComputePipeline(pipelineInfo, ("nbody force, " + tuning.toString()).c_str());
+
+    const StepConstants constants = { count, 0.0f, config::SOFTENING * config::SOFTENING, 0 };
+    const auto groups = (count + tuning.workgroupSize - 1) / tuning.workgroupSize;
+
+    // Each dispatch reads what the one before wrote, the same dependency real steps have
+    const vk::MemoryBarrier barrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    auto commandBuffer = m_device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(commandPool, vk::CommandBufferLevel::ePrimary, 1))[0];
+    commandBuffer.begin(vk::CommandBufferBeginInfo());
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, layout, 0, { descriptorSet }, {});
+        commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(StepConstants), &constants);
+        for (auto i = 0u; i < DISPATCHES; ++i)
+        {
+            commandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                vk::DependencyFlags(), { barrier }, {}, {}
+            );
+            commandBuffer.dispatch(groups, 1, 1);
+        }
+    commandBuffer.end();
+
+    auto fastest = std::numeric_limits<double>::max();
+    for (auto i = 0u; i <= SUBMITS; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        m_queue.submit({ vk::SubmitInfo(0, nullptr, nullptr, 1, &commandBuffer) }, vk::Fence());
+        m_queue.waitIdle();
+        auto milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // the first submit is a warm-up
+        if (i)
+        {
+            fastest = std::min(fastest, milliseconds / DISPATCHES);
+        }
+    }
+
+    m_device.resetCommandPool(commandPool, vk::CommandPoolResetFlags());
+    m_device.destroyPipeline(pipeline);
+
+    return fastest;
+}
+
+void Autotuner::save(const ComputeTuning& tuning) const
+{
+    // Entries of other devices stay
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(m_path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.compare(0, m_key.size() + 1, m_key + ' '))
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+    lines.push_back(m_key + ' ' + std::to_string(tuning.workgroupSize) + ' ' + std::to_string(tuning.tileSize));
+
+    auto temporary = m_path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        for (const auto& line : lines)
+        {
+            file << line << '\n';
+        }
+
+        if (!file)
+        {
+            throw std::runtime_error("could not write " + temporary);
+        }
+    }
+
+    if (std::rename(temporary.c_str(), m_path.c_str()))
+    {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("could not replace " + m_path);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "ComputeTuning.h"
+#include "PipelineCache.h"
+
+// Picks the ComputeTuning of nbody.comp by timing every variant that fits the device on the queue Compute runs on.
+// Winners are saved to one file, a line per device keyed by vendor, device, pipeline cache UUID and driver version,
+// so a driver update tunes again while other GPUs sharing the file keep theirs
+class Autotuner
+{
+public:
+    Autotuner(
+        const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, const uint32_t computeFamilyIndex, const uint32_t computeQueueIndex,
+        const PipelineCache& pipelineCache, const std::string& directory = config::PIPELINE_CACHE_DIRECTORY
+    );
+
+    // Saved tuning of this device and driver, if it has been tuned before
+    std::optional<ComputeTuning> load() const;
+
+    // Times every candidate for a simulation of `simulatedCount` particles, on at most config::AUTOTUNE_PARTICLES of them,
+    // and saves the fastest. Blocks the compute queue while it runs
+    ComputeTuning tune(const uint32_t simulatedCount) const;
+
+    // Workgroup sizes within the device limits, each with tiles of 1, 2 and 4 workgroups that fit shared memory
+    std::vector<ComputeTuning> candidates() const;
+
+private:
+    // Milliseconds per force dispatch on `count` particles
+    double measure(
+        const ComputeTuning& tuning, const uint32_t count, 
+        const vk::ShaderModule& shader, const vk::PipelineLayout& layout, const vk::DescriptorSet& descriptorSet, 
+        const vk::CommandPool& commandPool
+    ) const;
+
+    void save(const ComputeTuning& tuning) const;
+
+    vk::PhysicalDevice      m_physicalDevice;
+    vk::Device              m_device;
+    vk::Queue               m_queue;
+    const PipelineCache*    m_pipelineCache;
+    std::string             m_path;
+    std::string             m_key;
+    uint32_t                m_computeFamily;
+};
@@ -1,5 +1,7 @@
 #include "BoundedBuffer.h"
 
+#include <cstring>
+#include <set>
 #include <stdexcept>
 
 uint32_t findMemoryType(const vk::PhysicalDeviceMemoryProperties& properties, const uint32_t typeFilter, vk::MemoryPropertyFlags propertyFlags)
@@ -15,32 +17,30 @@ uint32_t findMemoryType(const vk::PhysicalDeviceMemoryProperties& properties, co
 	throw std::runtime_error("could not find compatible memory");
 }
 
-vk::UniqueDeviceMemory createMemory(
-        const vk::Device& dev,
-        const vk::MemoryRequirements& requirements,
-        const vk::PhysicalDeviceMemoryProperties& physicalProperties,
-        const vk::MemoryPropertyFlags& properties)
+vk::BufferCreateInfo bufferInfo(const vk::DeviceSize size, const vk::BufferUsageFlags& usage, const std::vector<uint32_t>& queueFamilies)
 {
-    return dev.allocateMemoryUnique(
-        vk::MemoryAllocateInfo(
-            requirements.size, 
-            findMemoryType(
-	    		physicalProperties,
-	    		requirements.memoryTypeBits, 
-	    		properties
-	    	)
-        )
-    );
+    vk::BufferCreateInfo info(vk::BufferCreateFlags(), size, usage);
+
+    if (std::set<uint32_t>(queueFamilies.begin(), queueFamilies.end()).size() > 1)
+    {
+        info.sharingMode = vk::SharingMode::eConcurrent;
+        info.queueFamilyIndexCount = queueFamilies.size();
+        info.pQueueFamilyIndices = queueFamilies.data();
+    }
+
+    return info;
 }
 
 BoundedBuffer::BoundedBuffer(
     const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, 
     const vk::DeviceSize size, const vk::BufferUsageFlags& usage, 
-    const vk::MemoryPropertyFlags& properties)
-    :   m_buffer(dev.createBufferUnique(vk::BufferCreateInfo(vk::BufferCreateFlags(), size, usage))),
-        m_memory(createMemory(dev, dev.getBufferMemoryRequirements(*m_buffer), physicalDevice.getMemoryProperties(), properties))
+    const vk::MemoryPropertyFlags& properties,
+    const std::vector<uint32_t>& queueFamilies)
+    :   m_buffer(dev.createBufferUnique(bufferInfo(size, usage, queueFamilies))),
+        m_allocator(&MemoryAllocator::get(physicalDevice, dev))
 {
-    dev.bindBufferMemory(*m_buffer, *m_memory, 0);
+    m_allocation = m_allocator->allocate(dev.getBufferMemoryRequirements(*m_buffer), properties, true);
+    dev.bindBufferMemory(*m_buffer, m_allocation.memory, m_allocation.offset);
 }
 
 BoundedBuffer::BoundedBuffer(
@@ -49,13 +49,39 @@ BoundedBuffer::BoundedBuffer(
     const vk::MemoryPropertyFlags& properties)
     :   BoundedBuffer(physicalDevice, dev, size, usage, properties)
 {
-    void* d_data = dev.mapMemory(*m_memory, 0, size);		
-	std::memcpy(d_data, data, static_cast<size_t>(size));
-	dev.unmapMemory(*m_memory);
+	std::memcpy(m_allocation.mapped, data, static_cast<size_t>(size));
 }
 
 BoundedBuffer::BoundedBuffer()
+    : m_allocator(nullptr)
+{
+}
+
+BoundedBuffer::BoundedBuffer(BoundedBuffer&& other)
 {
+    m_buffer = std::move(other.m_buffer);
+    m_allocation = other.m_allocation;
+    m_allocator = other.m_allocator;
+
+    other.reset();
+}
+
+BoundedBuffer::~BoundedBuffer()
+{
+    release();
+}
+
+BoundedBuffer& BoundedBuffer::operator=(BoundedBuffer&& other)
+{
+    release();
+
+    m_buffer = std::move(other.m_buffer);
+    m_allocation = other.m_allocation;
+    m_allocator = other.m_allocator;
+
+    other.reset();
+
+    return *this;
 }
 
 const vk::Buffer& BoundedBuffer::buffer() const
@@ -65,17 +91,35 @@ const vk::Buffer& BoundedBuffer::buffer() const
 
 const vk::DeviceMemory& BoundedBuffer::memory() const
 {
-    return *m_memory; 
+    return m_allocation.memory; 
+}
+
+vk::DeviceSize BoundedBuffer::offset() const
+{
+    return m_allocation.offset;
+}
+
+void* BoundedBuffer::data() const
+{
+    return m_allocation.mapped;
 }
 
 void BoundedBuffer::reset()
 {
     m_buffer.release();
-    m_memory.release();
+    m_allocation = MemoryAllocation();
+    m_allocator = nullptr;
 }
 
 void BoundedBuffer::release()
 {
+    // the buffer has to go before its memory range can be handed out again
     m_buffer.reset();
-    m_memory.reset();
+
+    if (m_allocator)
+    {
+        m_allocator->free(m_allocation);
+    }
+    m_allocation = MemoryAllocation();
+    m_allocator = nullptr;
 }
@@ -4,13 +4,20 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "MemoryAllocator.h"
+
+uint32_t findMemoryType(const vk::PhysicalDeviceMemoryProperties& properties, const uint32_t typeFilter, vk::MemoryPropertyFlags propertyFlags);
+
+// A buffer bound to a range of a MemoryAllocator block - memory() is shared, so always go through offset() or data()
 class BoundedBuffer
 {
 public:
+    // Buffers used from more than one queue family are created with concurrent sharing
     BoundedBuffer(
         const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, 
         const vk::DeviceSize size, const vk::BufferUsageFlags& usage, 
-        const vk::MemoryPropertyFlags& properties
+        const vk::MemoryPropertyFlags& properties,
+        const std::vector<uint32_t>& queueFamilies = {}
     );
 
     BoundedBuffer(
@@ -30,15 +37,33 @@ public:
 
     BoundedBuffer();
 
+    BoundedBuffer(const BoundedBuffer& other) = delete;
+
+    BoundedBuffer(BoundedBuffer&& other);
+
+    ~BoundedBuffer();
+
+    BoundedBuffer& operator=(const BoundedBuffer& other) = delete;
+
+    BoundedBuffer& operator=(BoundedBuffer&& other);
+
     const vk::Buffer& buffer() const;
 
     const vk::DeviceMemory& memory() const;
 
+    // Where the buffer starts in memory()
+    vk::DeviceSize offset() const;
+
+    // Persistently mapped contents, nullptr unless the memory is host visible.
+    // Only host coherent memory is requested anywhere, so writes need no flush
+    void* data() const;
+
     void reset();
 
     void release();
 
 private:
-    vk::UniqueBuffer m_buffer;
-    vk::UniqueDeviceMemory m_memory;
+    vk::UniqueBuffer    m_buffer;
+    MemoryAllocation    m_allocation;
+    MemoryAllocator*    m_allocator;
 };
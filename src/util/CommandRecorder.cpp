@@ -0,0 +1,276 @@
+#include "CommandRecorder.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+// Threads parked between frames, woken with a new generation to run `task` with their index
+struct CommandRecorder::Workers
+{
+    explicit Workers(const uint32_t count)
+    {
+        threads.reserve(count);
+        for (auto i = 0u; i < count; ++i)
+        {
+            threads.emplace_back([this, i]() { work(i); });
+        }
+    }
+
+    ~Workers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isStopping = true;
+        }
+        wake.notify_all();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Runs task(i) on every worker and task(threads.size()) on the calling thread, rethrows the first exception
+    void run(const std::function<void(const uint32_t)>& func)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &func;
+            running = threads.size();
+            error = nullptr;
+            ++generation;
+        }
+        wake.notify_all();
+
+        std::exception_ptr own;
+        try
+        {
+            func(threads.size());
+        }
+        catch (...)
+        {
+            own = std::current_exception();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return running == 0; });
+        task = nullptr;
+
+        if (own) std::rethrow_exception(own);
+        if (error) std::rethrow_exception(error);
+    }
+
+    void work(const uint32_t index)
+    {
+        uint64_t seen = 0;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            wake.wait(lock, [this, &seen]() { return isStopping or generation != seen; });
+            if (isStopping)
+            {
+                return;
+            }
+            seen = generation;
+
+            const auto* func = task;
+            lock.unlock();
+            try
+            {
+                (*func)(index);
+            }
+            catch (...)
+            {
+                lock.lock();
+                if (!error) error = std::current_exception();
+                lock.unlock();
+            }
+            lock.lock();
+
+            if (--running == 0)
+            {
+                done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread>                    threads;
+    std::mutex                                  mutex;
+    std::condition_variable                     wake;
+    std::condition_variable                     done;
+    const std::function<void(const uint32_t)>*  task = nullptr;
+    std::exception_ptr                          error;
+    uint64_t                                    generation = 0;
+    size_t                                      running = 0;
+    bool                                        isStopping = false;
+};
+
+CommandRecorder::CommandRecorder(const vk::Device& dev, const uint32_t queueFamilyIndex, const uint32_t frames, const uint32_t threads)
+    : m_threads(std::max(1u, threads)), m_device(dev)
+{
+    // Transient: everything is re-recorded every frame, and reset with the pool rather than one by one
+    const vk::CommandPoolCreateInfo poolInfo(vk::CommandPoolCreateFlagBits::eTransient, queueFamilyIndex);
+
+    for (auto frame = 0u; frame < frames; ++frame)
+    {
+        m_primaryPools.push_back(dev.createCommandPool(poolInfo));
+        m_primaries.push_back(dev.allocateCommandBuffers(vk::CommandBufferAllocateInfo(m_primaryPools.back(), vk::CommandBufferLevel::ePrimary, 1))[0]);
+
+        for (auto thread = 0u; thread < m_threads; ++thread)
+        {
+            m_pools.emplace_back();
+            m_pools.back().pool = dev.createCommandPool(poolInfo);
+        }
+    }
+
+    m_workers.reset(new Workers(m_threads - 1));
+}
+
+CommandRecorder::CommandRecorder()
+    : m_threads(0)
+{
+
+}
+
+CommandRecorder::CommandRecorder(CommandRecorder&& other)
+{
+    m_primaryPools = other.m_primaryPools;
+    m_primaries = other.m_primaries;
+    m_pools = other.m_pools;
+    m_workers = std::move(other.m_workers);
+    m_threads = other.m_threads;
+    m_device = other.m_device;
+
+    other.reset();
+}
+
+CommandRecorder::~CommandRecorder()
+{
+    release();
+    reset();
+}
+
+CommandRecorder& CommandRecorder::operator=(CommandRecorder&& other)
+{
+    release();
+
+    m_primaryPools = other.m_primaryPools;
+    m_primaries = other.m_primaries;
+    m_pools = other.m_pools;
+    m_workers = std::move(other.m_workers);
+    m_threads = other.m_threads;
+    m_device = other.m_device;
+
+    other.reset();
+
+    return *this;
+}
+
+uint32_t CommandRecorder::threadCount() const
+{
+    return m_threads;
+}
+
+vk::CommandBuffer CommandRecorder::beginFrame(const uint32_t frame)
+{
+    m_device.resetCommandPool(m_primaryPools[frame], vk::CommandPoolResetFlags());
+
+    for (auto thread = 0u; thread < m_threads; ++thread)
+    {
+        auto& pool = m_pools[frame * m_threads + thread];
+        m_device.resetCommandPool(pool.pool, vk::CommandPoolResetFlags());
+        pool.used = 0;
+    }
+
+    return m_primaries[frame];
+}
+
+std::vector<vk::CommandBuffer> CommandRecorder::record(const uint32_t frame, const std::vector<RecordJob>& jobs)
+{
+    std::vector<vk::CommandBuffer> ret(jobs.size());
+
+    // Contiguous chunks like parallelFor, thread t records into its own pool only
+    const auto chunk = (jobs.size() + m_threads - 1) / m_threads;
+    const std::function<void(const uint32_t)> recordChunk = [&](const uint32_t thread) {
+        auto& pool = m_pools[frame * m_threads + thread];
+
+        for (auto i = thread * chunk; i < std::min(jobs.size(), (thread + 1) * chunk); ++i)
+        {
+            const auto& job = jobs[i];
+            auto flags = vk::CommandBufferUsageFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+            if (job.inheritance.renderPass)
+            {
+                flags |= vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+            }
+
+            ret[i] = nextSecondary(pool);
+            ret[i].begin(vk::CommandBufferBeginInfo(flags, &job.inheritance));
+            job.record(ret[i]);
+            ret[i].end();
+        }
+    };
+
+    // Not worth waking anyone for a single chunk, it is chunk 0 whatever the thread count.
+    // Every pool of the frame is idle then, the calling thread may take the first one
+    if (chunk >= jobs.size())
+    {
+        recordChunk(0);
+    }
+    else
+    {
+        m_workers->run(recordChunk);
+    }
+
+    // A job left out would reach executeCommands as a null handle
+    if (std::find(ret.begin(), ret.end(), vk::CommandBuffer()) != ret.end())
+    {
+        throw std::logic_error("CommandRecorder: a job was not recorded");
+    }
+
+    return ret;
+}
+
+void CommandRecorder::reset()
+{
+    m_primaryPools.clear();
+    m_primaries.clear();
+    m_pools.clear();
+    m_workers.reset();
+    m_threads = 0;
+    m_device = vk::Device();
+}
+
+void CommandRecorder::release()
+{
+    // Workers only ever touch the pools inside record(), stop them first anyway
+    m_workers.reset();
+
+    for (const auto& pool : m_pools)
+    {
+        if (pool.pool) m_device.destroyCommandPool(pool.pool);
+    }
+    m_pools.clear();
+
+    for (const auto& pool : m_primaryPools)
+    {
+        if (pool) m_device.destroyCommandPool(pool);
+    }
+    m_primaryPools.clear();
+    m_primaries.clear();
+}
+
+vk::CommandBuffer CommandRecorder::nextSecondary(ThreadPool& pool)
+{
+    if (pool.used == pool.secondaries.size())
+    {
+        pool.secondaries.push_back(
+            m_device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(pool.pool, vk::CommandBufferLevel::eSecondary, 1))[0]
+        );
+    }
+
+    return pool.secondaries[pool.used++];
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+// One secondary command buffer to record, `record` runs on whichever recording thread picks it up
+struct RecordJob
+{
+    // renderPass / subpass / framebuffer the secondary runs in, no render pass for work recorded outside of one
+    vk::CommandBufferInheritanceInfo                inheritance;
+    std::function<void(const vk::CommandBuffer&)>   record;
+};
+
+// Records a frame's command buffers every frame instead of baking them up front.
+// Every recording thread owns a transient command pool per frame in flight, so recording needs no locks,
+// and a frame's pools are reset as a whole once its fence was waited on - the command buffers stay allocated and are reused.
+// The calling thread is one of the recording threads, the others are kept around between frames
+class CommandRecorder
+{
+public:
+    CommandRecorder(const vk::Device& dev, const uint32_t queueFamilyIndex, const uint32_t frames, const uint32_t threads);
+
+    CommandRecorder();
+
+    CommandRecorder(const CommandRecorder& other) = delete;
+
+    CommandRecorder(CommandRecorder&& other);
+
+    ~CommandRecorder();
+
+    CommandRecorder& operator=(const CommandRecorder& other) = delete;
+
+    CommandRecorder& operator=(CommandRecorder&& other);
+
+    uint32_t threadCount() const;
+
+    // Resets the pools of frame in flight `frame` and hands out its primary command buffer, not begun yet.
+    // Whatever was recorded for `frame` before must be done on the GPU
+    vk::CommandBuffer beginFrame(const uint32_t frame);
+
+    // Records one secondary per job from `frame`'s pools, spread over the recording threads.
+    // Returned in job order, ready for vkCmdExecuteCommands from the primary
+    std::vector<vk::CommandBuffer> record(const uint32_t frame, const std::vector<RecordJob>& jobs);
+
+    void reset();
+
+    void release();
+
+private:
+    struct Workers;
+
+    // A command pool and the secondaries allocated from it so far, `used` of them hold this frame's recording
+    struct ThreadPool
+    {
+        vk::CommandPool                 pool;
+        std::vector<vk::CommandBuffer>  secondaries;
+        uint32_t                        used = 0;
+    };
+
+    vk::CommandBuffer nextSecondary(ThreadPool& pool);
+
+    std::vector<vk::CommandPool>    m_primaryPools;     // per frame in flight
+    std::vector<vk::CommandBuffer>  m_primaries;
+    std::vector<ThreadPool>         m_pools;            // indexed frame * threads + thread
+    std::unique_ptr<Workers>        m_workers;          // threads - 1 of them, the calling thread records too
+    uint32_t                        m_threads;
+    vk::Device                      m_device;
+};
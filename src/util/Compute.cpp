@@ -0,0 +1,837 @@
+#include "Compute.h"
+
+#include <iterator>
+#include <limits>
+
+#include "general.h"
+#include "shaders.h"
+#include "Vertex.h"
+#include "../config.h"
+
+namespace
+{
+
+// Queue family ownership release / acquire half, a plain buffer barrier when both families are the same
+vk::BufferMemoryBarrier ownershipBarrier(
+    const vk::Buffer& buffer, 
+    const vk::AccessFlags& srcAccess, const vk::AccessFlags& dstAccess, 
+    const uint32_t srcFamily, const uint32_t dstFamily)
+{
+    auto isTransfer = srcFamily != dstFamily;
+
+    return vk::BufferMemoryBarrier(
+        srcAccess, dstAccess, 
+        isTransfer ? srcFamily : VK_QUEUE_FAMILY_IGNORED, 
+        isTransfer ? dstFamily : VK_QUEUE_FAMILY_IGNORED, 
+        buffer, 0, VK_WHOLE_SIZE
+    );
+}
+
+}
+
+Compute::Compute(
+    const vk::Device& dev,
+    const vk::PhysicalDevice& physicalDevice,
+    const uint32_t computeFamilyIndex,
+    const uint32_t computeQueueIndex,
+    const uint32_t graphicsFamilyIndex,
+    const ParticleColumns& initial,
+    const float softening,
+    const float dt,
+    const uint32_t bufferCount,
+    UploadManager& uploads,
+    const PipelineCache& pipelineCache,
+    const ComputeTuning& tuning)
+    : queue(dev.getQueue(computeFamilyIndex, computeQueueIndex)), m_tuning(tuning), m_computeFamily(computeFamilyIndex), m_graphicsFamily(graphicsFamilyIndex), m_steps(0), m_isReadbackRequested(false), m_physicalDevice(physicalDevice), m_device(dev)
+{
+    createState(initial.count, softening, dt);
+
+    // in the order interleave.comp expects them
+    const float* sources[] = { initial.x, initial.y, initial.z, initial.vx, initial.vy, initial.vz, initial.mass };
+    const auto columnSize = sizeof(float) * initial.count;
+
+    columns = BoundedBuffer(
+        physicalDevice, dev,
+        std::size(sources) * columnSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal,
+        { computeFamilyIndex, uploads.familyIndex() }
+    );
+
+    // The copies run on the transfer queue while the pipelines below are built, the interleave waits for them on the GPU.
+    // upload() reads the columns straight from wherever they live, for a mapped checkpoint that is the page cache
+    uploadedSemaphore = dev.createSemaphore(vk::SemaphoreCreateInfo());
+    vk::DeviceSize offset = 0;
+    for (const auto source : sources)
+    {
+        uploads.upload(columns.buffer(), offset, source, columnSize);
+        offset += columnSize;
+    }
+    uploads.flush(uploadedSemaphore);
+
+    createFrames(bufferCount, pipelineCache);
+    submitInterleave();
+}
+
+Compute::Compute(
+    const vk::Device& dev,
+    const vk::PhysicalDevice& physicalDevice,
+    const uint32_t computeFamilyIndex,
+    const uint32_t computeQueueIndex,
+    const uint32_t graphicsFamilyIndex,
+    const Distribution distribution,
+    const size_t count,
+    const uint32_t seed,
+    const float softening,
+    const float dt,
+    const uint32_t bufferCount,
+    const PipelineCache& pipelineCache,
+    const ComputeTuning& tuning)
+    : queue(dev.getQueue(computeFamilyIndex, computeQueueIndex)), m_tuning(tuning), m_computeFamily(computeFamilyIndex), m_graphicsFamily(graphicsFamilyIndex), m_steps(0), m_isReadbackRequested(false), m_physicalDevice(physicalDevice), m_device(dev)
+{
+    createState(count, softening, dt);
+    createFrames(bufferCount, pipelineCache);
+    submitGenerate(distribution, seed);
+}
+
+Compute::Compute()
+    : m_steps(0), m_isReadbackRequested(false)
+{
+
+}
+
+Compute::Compute(Compute&& other)
+{
+    commandPool = other.commandPool;
+    descriptorSetLayout = other.descriptorSetLayout;
+    descriptorPool = other.descriptorPool;
+    descriptorSets = other.descriptorSets;
+    pipelineLayout = other.pipelineLayout;
+    forcePipeline = other.forcePipeline;
+    driftPipeline = other.driftPipeline;
+    initialPipeline = other.initialPipeline;
+    initialDescriptorSet = other.initialDescriptorSet;
+    initialCommandBuffer = other.initialCommandBuffer;
+    firstCommandBuffers = other.firstCommandBuffers;
+    commandBuffers = other.commandBuffers;
+    firstSnapshotCommandBuffers = other.firstSnapshotCommandBuffers;
+    snapshotCommandBuffers = other.snapshotCommandBuffers;
+    integrateCommandBuffer = other.integrateCommandBuffer;
+    readbackCommandBuffers = other.readbackCommandBuffers;
+    simulatedSemaphores = other.simulatedSemaphores;
+    drawnSemaphores = other.drawnSemaphores;
+    uploadedSemaphore = other.uploadedSemaphore;
+    initialFence = other.initialFence;
+    readbackFences = other.readbackFences;
+    columns = std::move(other.columns);
+    particles = std::move(other.particles);
+    accelerations = std::move(other.accelerations);
+    frames = std::move(other.frames);
+    readbacks = std::move(other.readbacks);
+    timestamps = std::move(other.timestamps);
+    m_profiler = std::move(other.m_profiler);
+    queue = other.queue;
+    m_constants = other.m_constants;
+    m_tuning = other.m_tuning;
+    m_computeFamily = other.m_computeFamily;
+    m_graphicsFamily = other.m_graphicsFamily;
+    m_steps = other.m_steps;
+    m_isReadbackRequested = other.m_isReadbackRequested;
+    m_physicalDevice = other.m_physicalDevice;
+    m_device = other.m_device;
+
+    other.reset();
+}
+
+Compute::~Compute()
+{
+    release();
+    reset();
+}
+
+Compute& Compute::operator=(Compute&& other)
+{
+    release();
+
+    commandPool = other.commandPool;
+    descriptorSetLayout = other.descriptorSetLayout;
+    descriptorPool = other.descriptorPool;
+    descriptorSets = other.descriptorSets;
+    pipelineLayout = other.pipelineLayout;
+    forcePipeline = other.forcePipeline;
+    driftPipeline = other.driftPipeline;
+    initialPipeline = other.initialPipeline;
+    initialDescriptorSet = other.initialDescriptorSet;
+    initialCommandBuffer = other.initialCommandBuffer;
+    firstCommandBuffers = other.firstCommandBuffers;
+    commandBuffers = other.commandBuffers;
+    firstSnapshotCommandBuffers = other.firstSnapshotCommandBuffers;
+    snapshotCommandBuffers = other.snapshotCommandBuffers;
+    integrateCommandBuffer = other.integrateCommandBuffer;
+    readbackCommandBuffers = other.readbackCommandBuffers;
+    simulatedSemaphores = other.simulatedSemaphores;
+    drawnSemaphores = other.drawnSemaphores;
+    uploadedSemaphore = other.uploadedSemaphore;
+    initialFence = other.initialFence;
+    readbackFences = other.readbackFences;
+    columns = std::move(other.columns);
+    particles = std::move(other.particles);
+    accelerations = std::move(other.accelerations);
+    frames = std::move(other.frames);
+    readbacks = std::move(other.readbacks);
+    timestamps = std::move(other.timestamps);
+    m_profiler = std::move(other.m_profiler);
+    queue = other.queue;
+    m_constants = other.m_constants;
+    m_tuning = other.m_tuning;
+    m_computeFamily = other.m_computeFamily;
+    m_graphicsFamily = other.m_graphicsFamily;
+    m_steps = other.m_steps;
+    m_isReadbackRequested = other.m_isReadbackRequested;
+    m_physicalDevice = other.m_physicalDevice;
+    m_device = other.m_device;
+
+    other.reset();
+
+    return *this;
+}
+
+uint32_t Compute::count() const
+{
+    return m_constants.count;
+}
+
+uint32_t Compute::bufferCount() const
+{
+    return static_cast<uint32_t>(frames.size());
+}
+
+const vk::Buffer& Compute::buffer(const uint32_t index) const
+{
+    return frames[index].buffer();
+}
+
+void Compute::acquire(const vk::CommandBuffer& commandBuffer, const uint32_t index) const
+{
+    // Read by Graphics' cull pass when it culls, as vertex input otherwise
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexInput,
+        vk::DependencyFlags(), {}, 
+        { ownershipBarrier(frames[index].buffer(), vk::AccessFlags(), vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eVertexAttributeRead, m_computeFamily, m_graphicsFamily) }, 
+        {}
+    );
+}
+
+void Compute::release(const vk::CommandBuffer& commandBuffer, const uint32_t index) const
+{
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexInput, vk::PipelineStageFlagBits::eBottomOfPipe,
+        vk::DependencyFlags(), {}, 
+        { ownershipBarrier(frames[index].buffer(), vk::AccessFlags(), vk::AccessFlags(), m_graphicsFamily, m_computeFamily) }, 
+        {}
+    );
+}
+
+uint32_t Compute::slot(const uint64_t step) const
+{
+    return static_cast<uint32_t>(step % frames.size());
+}
+
+const vk::Semaphore& Compute::simulated(const uint64_t step) const
+{
+    return simulatedSemaphores[slot(step)];
+}
+
+const vk::Semaphore& Compute::drawn(const uint64_t step) const
+{
+    return drawnSemaphores[slot(step)];
+}
+
+void Compute::step(const uint32_t substeps)
+{
+    const auto index = slot(m_steps);
+    const auto isFirstUse = m_steps < frames.size();
+
+    std::vector<vk::CommandBuffer> submitted;
+    if (timestamps.isEnabled())
+    {
+        submitted.push_back(timestamps.begin(m_steps));
+    }
+    for (auto i = 1u; i < substeps; ++i)
+    {
+        submitted.push_back(integrateCommandBuffer);
+    }
+    if (substeps)
+    {
+        submitted.push_back(isFirstUse ? firstCommandBuffers[index] : commandBuffers[index]);
+    }
+    else
+    {
+        submitted.push_back(isFirstUse ? firstSnapshotCommandBuffers[index] : snapshotCommandBuffers[index]);
+    }
+    if (m_isReadbackRequested)
+    {
+        submitted.push_back(readbackCommandBuffers[index]);
+    }
+    if (timestamps.isEnabled())
+    {
+        submitted.push_back(timestamps.end(m_steps));
+    }
+
+    const vk::PipelineStageFlags waitStage(vk::PipelineStageFlagBits::eComputeShader);
+
+    vk::SubmitInfo submitInfo(0, nullptr, nullptr, submitted.size(), submitted.data(), 1, &simulatedSemaphores[index]);
+    if (!isFirstUse)
+    {
+        submitInfo.setWaitSemaphoreCount(1);
+        submitInfo.setPWaitSemaphores(&drawnSemaphores[index]);
+        submitInfo.setPWaitDstStageMask(&waitStage);
+    }
+
+    // The step that last used this set is done only if its draw is, results still in flight are dropped
+    m_profiler.collect(index);
+    queue.submit({ submitInfo }, m_isReadbackRequested ? readbackFences[index] : vk::Fence());
+    m_profiler.submitted(index);
+    m_isReadbackRequested = false;
+    ++m_steps;
+
+    if (initialFence and m_device.getFenceStatus(initialFence) == vk::Result::eSuccess)
+    {
+        releaseInitial();
+    }
+}
+
+uint64_t Compute::steps() const
+{
+    return m_steps;
+}
+
+const QueueTimer& Compute::timer() const
+{
+    return timestamps;
+}
+
+const GpuProfiler& Compute::profiler() const
+{
+    return m_profiler;
+}
+
+void Compute::await()
+{
+    if (queue) queue.waitIdle();
+}
+
+void Compute::requestReadback()
+{
+    createReadbacks();
+    m_isReadbackRequested = true;
+}
+
+bool Compute::isReadbackDone(const uint64_t step) const
+{
+    return m_device.getFenceStatus(readbackFences[slot(step)]) == vk::Result::eSuccess;
+}
+
+void Compute::takeReadback(const uint64_t step, Particles& dest)
+{
+    const auto index = slot(step);
+    m_device.waitForFences({ readbackFences[index] }, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    readVertecies(static_cast<const Vertex*>(readbacks[index].data()), m_constants.count, dest);
+    m_device.resetFences({ readbackFences[index] });
+}
+
+void Compute::download(Particles& dest)
+{
+    createReadbacks();
+
+    // the copy's own barrier orders it after everything before it on this queue, the only one writing the state buffer
+    const auto index = slot(m_steps);
+    queue.submit({ vk::SubmitInfo(0, nullptr, nullptr, 1, &readbackCommandBuffers[index]) }, readbackFences[index]);
+    takeReadback(m_steps, dest);
+}
+
+void Compute::reset()
+{
+    commandPool = vk::CommandPool();
+    descriptorSetLayout = vk::DescriptorSetLayout();
+    descriptorPool = vk::DescriptorPool();
+    descriptorSets.clear();
+    pipelineLayout = vk::PipelineLayout();
+    forcePipeline = vk::Pipeline();
+    driftPipeline = vk::Pipeline();
+    initialPipeline = vk::Pipeline();
+    initialDescriptorSet = vk::DescriptorSet();
+    initialCommandBuffer = vk::CommandBuffer();
+    firstCommandBuffers.clear();
+    commandBuffers.clear();
+    firstSnapshotCommandBuffers.clear();
+    snapshotCommandBuffers.clear();
+    integrateCommandBuffer = vk::CommandBuffer();
+    readbackCommandBuffers.clear();
+    simulatedSemaphores.clear();
+    drawnSemaphores.clear();
+    uploadedSemaphore = vk::Semaphore();
+    initialFence = vk::Fence();
+    readbackFences.clear();
+    columns.reset();
+    particles.reset();
+    accelerations.reset();
+    frames.clear();
+    readbacks.clear();
+    timestamps.reset();
+    m_profiler.reset();
+    queue = vk::Queue();
+    m_constants = StepConstants();
+    m_tuning = ComputeTuning();
+    m_computeFamily = 0;
+    m_graphicsFamily = 0;
+    m_steps = 0;
+    m_isReadbackRequested = false;
+    m_physicalDevice = vk::PhysicalDevice();
+    m_device = vk::Device();
+}
+
+void Compute::release()
+{
+    // the interleave or generation may not have run yet when no step ever checked
+    if (initialFence) m_device.waitForFences({ initialFence }, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    releaseInitial();
+    particles.release();
+    accelerations.release();
+
+    for (auto& frame : frames)
+    {
+        frame.release();
+    }
+    frames.clear();
+
+    for (auto& readback : readbacks)
+    {
+        readback.release();
+    }
+    readbacks.clear();
+
+    for (const auto& fence : readbackFences)
+        if (fence)
+            m_device.destroyFence(fence);
+    readbackFences.clear();
+
+    timestamps.release();
+    m_profiler.release();
+
+    for (const auto& semaphore : simulatedSemaphores)
+        if (semaphore)
+            m_device.destroySemaphore(semaphore);
+
+    for (const auto& semaphore : drawnSemaphores)
+        if (semaphore)
+            m_device.destroySemaphore(semaphore);
+
+    if (uploadedSemaphore) m_device.destroySemaphore(uploadedSemaphore);
+
+    if (forcePipeline) m_device.destroyPipeline(forcePipeline);
+    if (driftPipeline) m_device.destroyPipeline(driftPipeline);
+    if (initialPipeline) m_device.destroyPipeline(initialPipeline);
+    if (pipelineLayout) m_device.destroyPipelineLayout(pipelineLayout);
+
+    if (descriptorPool) m_device.destroyDescriptorPool(descriptorPool);
+    if (descriptorSetLayout) m_device.destroyDescriptorSetLayout(descriptorSetLayout);
+
+    // frees the command buffers with it
+    if (commandPool) m_device.destroyCommandPool(commandPool);
+}
+
+void Compute::createState(const size_t count, const float softening, const float dt)
+{
+    m_constants.count = static_cast<uint32_t>(count);
+    m_constants.dt = dt;
+    m_constants.softening2 = softening * softening;
+    m_constants.snapshot = 1;
+
+    vk::CommandPoolCreateInfo commandPoolInfo(vk::CommandPoolCreateFlags(), m_computeFamily);
+    commandPool = m_device.createCommandPool(commandPoolInfo);
+
+    // read back through the readback buffers
+    particles = BoundedBuffer(
+        m_physicalDevice, m_device,
+        sizeof(Vertex) * count, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
+
+    // kept by each force pass for the opening half kick of the next step
+    accelerations = BoundedBuffer(
+        m_physicalDevice, m_device,
+        sizeof(float) * 4 * count, vk::BufferUsageFlagBits::eStorageBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
+}
+
+void Compute::createFrames(const uint32_t bufferCount, const PipelineCache& pipelineCache)
+{
+    frames.resize(bufferCount);
+    for (auto& frame : frames)
+    {
+        frame = BoundedBuffer(
+            m_physicalDevice, m_device,
+            sizeof(Vertex) * m_constants.count, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer,
+            vk::MemoryPropertyFlagBits::eDeviceLocal
+        );
+    }
+
+    for (auto i = 0u; i < bufferCount; ++i)
+    {
+        simulatedSemaphores.push_back(m_device.createSemaphore(vk::SemaphoreCreateInfo()));
+        drawnSemaphores.push_back(m_device.createSemaphore(vk::SemaphoreCreateInfo()));
+    }
+
+    timestamps = QueueTimer(m_device, m_physicalDevice, m_computeFamily, config::TIMER_RING);
+
+    // pipelineStatisticsQuery is enabled on the device whenever it is supported
+    auto statistics = m_physicalDevice.getFeatures().pipelineStatisticsQuery
+        ? vk::QueryPipelineStatisticFlags(vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations)
+        : vk::QueryPipelineStatisticFlags();
+    m_profiler = GpuProfiler(m_device, m_physicalDevice, m_computeFamily, bufferCount, { "force", "drift" }, statistics);
+
+    createDescriptors();
+    createPipelines(pipelineCache);
+    createCommandBuffers();
+}
+
+void Compute::createDescriptors()
+{
+    const vk::DescriptorSetLayoutBinding bindings[] = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute)
+    };
+
+    descriptorSetLayout = m_device.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo(
+            vk::DescriptorSetLayoutCreateFlags(), 
+            3, bindings
+        )
+    );
+
+    const auto setCount = bufferCount();
+
+    // one more for the interleave or the generator
+    vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, 3 * (setCount + 1));
+    descriptorPool = m_device.createDescriptorPool(vk::DescriptorPoolCreateInfo(vk::DescriptorPoolCreateFlags(), setCount + 1, 1, &poolSize));
+
+    const std::vector<vk::DescriptorSetLayout> layouts(setCount, descriptorSetLayout);
+    descriptorSets = m_device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool, layouts.size(), layouts.data()));
+
+    for (auto i = 0u; i < setCount; ++i)
+    {
+        vk::DescriptorBufferInfo particlesInfo(particles.buffer(), 0, VK_WHOLE_SIZE);
+        vk::DescriptorBufferInfo frameInfo(frames[i].buffer(), 0, VK_WHOLE_SIZE);
+        vk::DescriptorBufferInfo accelerationsInfo(accelerations.buffer(), 0, VK_WHOLE_SIZE);
+
+        m_device.updateDescriptorSets({
+            vk::WriteDescriptorSet(descriptorSets[i], 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &particlesInfo),
+            vk::WriteDescriptorSet(descriptorSets[i], 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &frameInfo),
+            vk::WriteDescriptorSet(descriptorSets[i], 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &accelerationsInfo)
+        }, {});
+    }
+
+    initialDescriptorSet = m_device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool, 1, &descriptorSetLayout))[0];
+
+    vk::DescriptorBufferInfo particlesInfo(particles.buffer(), 0, VK_WHOLE_SIZE);
+    vk::DescriptorBufferInfo columnsInfo(columns.buffer(), 0, VK_WHOLE_SIZE);
+
+    // initial.comp never touches binding 1 and neither of them binding 2, those may stay unwritten
+    std::vector<vk::WriteDescriptorSet> writes = {
+        vk::WriteDescriptorSet(initialDescriptorSet, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &particlesInfo)
+    };
+    if (columns.buffer())
+    {
+        writes.push_back(vk::WriteDescriptorSet(initialDescriptorSet, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &columnsInfo));
+    }
+    m_device.updateDescriptorSets(writes, {});
+}
+
+void Compute::createPipelines(const PipelineCache& pipelineCache)
+{
+    vk::PushConstantRange pushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(StepConstants));
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo;
+    pipelineLayoutInfo.setSetLayoutCount(1);
+    pipelineLayoutInfo.setPSetLayouts(&descriptorSetLayout);
+    pipelineLayoutInfo.setPushConstantRangeCount(1);
+    pipelineLayoutInfo.setPPushConstantRanges(&pushConstants);
+
+    pipelineLayout = m_device.createPipelineLayout(pipelineLayoutInfo);
+
+    auto forceShader = loadShaderModule(m_device, "nbody.spv");
+    auto driftShader = loadShaderModule(m_device, "drift.spv");
+    auto initialShader = loadShaderModule(m_device, columns.buffer() ? "interleave.spv" : "initial.spv");
+
+    const auto specialization = m_tuning.specializationInfo();
+    vk::ComputePipelineCreateInfo pipelineInfo(
+        vk::PipelineCreateFlags(),
+        vk::PipelineShaderStageCreateInfo(
+            vk::PipelineShaderStageCreateFlags(), 
+            vk::ShaderStageFlagBits::eCompute, 
+            forceShader.get(), 
+            "main",
+            &specialization
+        ),
+        pipelineLayout
+    );
+    forcePipeline = pipelineCache.createComputePipeline(pipelineInfo, "nbody force");
+
+    pipelineInfo.stage.module = driftShader.get();
+    driftPipeline = pipelineCache.createComputePipeline(pipelineInfo, "nbody drift");
+
+    pipelineInfo.stage.module = initialShader.get();
+    initialPipeline = pipelineCache.createComputePipeline(pipelineInfo, columns.buffer() ? "nbody interleave" : "nbody initial");
+}
+
+void Compute::createCommandBuffers()
+{
+    vk::CommandBufferAllocateInfo allocInfo(commandPool, vk::CommandBufferLevel::ePrimary, bufferCount());
+    firstCommandBuffers = m_device.allocateCommandBuffers(allocInfo);
+    commandBuffers = m_device.allocateCommandBuffers(allocInfo);
+    firstSnapshotCommandBuffers = m_device.allocateCommandBuffers(allocInfo);
+    snapshotCommandBuffers = m_device.allocateCommandBuffers(allocInfo);
+
+    for (auto i = 0u; i < bufferCount(); ++i)
+    {
+        recordStep(firstCommandBuffers[i], i, false, true);
+        recordStep(commandBuffers[i], i, true, true);
+        recordStep(firstSnapshotCommandBuffers[i], i, false, false);
+        recordStep(snapshotCommandBuffers[i], i, true, false);
+    }
+
+    allocInfo.setCommandBufferCount(1);
+    integrateCommandBuffer = m_device.allocateCommandBuffers(allocInfo)[0];
+    recordIntegrate(integrateCommandBuffer);
+}
+
+void Compute::createReadbacks()
+{
+    if (!readbacks.empty())
+    {
+        return;
+    }
+
+    readbacks.resize(bufferCount());
+    for (auto& readback : readbacks)
+    {
+        readback = BoundedBuffer(
+            m_physicalDevice, m_device,
+            sizeof(Vertex) * m_constants.count, vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+        );
+        readbackFences.push_back(m_device.createFence(vk::FenceCreateInfo()));
+    }
+
+    readbackCommandBuffers = m_device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(commandPool, vk::CommandBufferLevel::ePrimary, bufferCount()));
+    for (auto i = 0u; i < bufferCount(); ++i)
+    {
+        recordReadback(readbackCommandBuffers[i], i);
+    }
+}
+
+void Compute::recordStep(const vk::CommandBuffer& commandBuffer, const uint32_t index, const bool acquireFrame, const bool isIntegrating)
+{
+    const auto groups = (m_constants.count + m_tuning.workgroupSize - 1) / m_tuning.workgroupSize;
+    const auto& frame = frames[index].buffer();
+
+    // drifting by 0 leaves the state exactly as it is. An integrating step snapshots in its force pass, after the closing half kick
+    auto driftConstants = m_constants;
+    if (isIntegrating)
+    {
+        driftConstants.snapshot = 0;
+    }
+    else
+    {
+        driftConstants.dt = 0.0f;
+    }
+
+    // Previous step must land before positions are read again, the interleave or generation of the initial state included
+    const vk::MemoryBarrier stepBarrier(
+        vk::AccessFlagBits::eShaderWrite,
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+    );
+
+    // Positions must be drifted before the force pass reads them
+    const vk::MemoryBarrier driftBarrier(
+        vk::AccessFlagBits::eShaderWrite,
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+    );
+
+    commandBuffer.begin(vk::CommandBufferBeginInfo());
+        if (acquireFrame)
+        {
+            commandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader,
+                vk::DependencyFlags(), {}, 
+                { ownershipBarrier(frame, vk::AccessFlags(), vk::AccessFlagBits::eShaderWrite, m_graphicsFamily, m_computeFamily) }, 
+                {}
+            );
+        }
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+            vk::DependencyFlags(), { stepBarrier }, {}, {}
+        );
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, {descriptorSets[index]}, {});
+        commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(StepConstants), &driftConstants);
+
+        m_profiler.reset(commandBuffer, index);
+
+        m_profiler.begin(commandBuffer, index, 1);
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, driftPipeline);
+        commandBuffer.dispatch(groups, 1, 1);
+        m_profiler.end(commandBuffer, index, 1);
+
+        // a snapshot alone leaves the force scope unwritten, GpuProfiler skips such sets
+        if (isIntegrating)
+        {
+            commandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                vk::DependencyFlags(), { driftBarrier }, {}, {}
+            );
+
+            commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(StepConstants), &m_constants);
+
+            m_profiler.begin(commandBuffer, index, 0);
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, forcePipeline);
+            commandBuffer.dispatch(groups, 1, 1);
+            m_profiler.end(commandBuffer, index, 0);
+        }
+
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eBottomOfPipe,
+            vk::DependencyFlags(), {}, 
+            { ownershipBarrier(frame, vk::AccessFlagBits::eShaderWrite, vk::AccessFlags(), m_computeFamily, m_graphicsFamily) }, 
+            {}
+        );
+    commandBuffer.end();
+}
+
+void Compute::recordIntegrate(const vk::CommandBuffer& commandBuffer)
+{
+    const auto groups = (m_constants.count + m_tuning.workgroupSize - 1) / m_tuning.workgroupSize;
+
+    auto constants = m_constants;
+    constants.snapshot = 0;
+
+    const vk::MemoryBarrier barrier(
+        vk::AccessFlagBits::eShaderWrite,
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+    );
+
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse));
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+            vk::DependencyFlags(), { barrier }, {}, {}
+        );
+        // any set will do, the frame buffer is left alone
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, {descriptorSets[0]}, {});
+        commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(StepConstants), &constants);
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, driftPipeline);
+        commandBuffer.dispatch(groups, 1, 1);
+
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+            vk::DependencyFlags(), { barrier }, {}, {}
+        );
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, forcePipeline);
+        commandBuffer.dispatch(groups, 1, 1);
+    commandBuffer.end();
+}
+
+void Compute::recordReadback(const vk::CommandBuffer& commandBuffer, const uint32_t index)
+{
+    const auto size = sizeof(Vertex) * m_constants.count;
+
+    commandBuffer.begin(vk::CommandBufferBeginInfo());
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+            vk::DependencyFlags(), { vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead) }, {}, {}
+        );
+        commandBuffer.copyBuffer(particles.buffer(), readbacks[index].buffer(), { vk::BufferCopy(0, 0, size) });
+        // the next step's drift must not overwrite the state while it is still being copied
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eComputeShader,
+            vk::DependencyFlags(), { vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead) }, {}, {}
+        );
+    commandBuffer.end();
+}
+
+void Compute::recordInitialForces(const vk::CommandBuffer& commandBuffer)
+{
+    const auto groups = (m_constants.count + m_tuning.workgroupSize - 1) / m_tuning.workgroupSize;
+
+    // kicking by 0 only keeps the accelerations
+    auto constants = m_constants;
+    constants.dt = 0.0f;
+    constants.snapshot = 0;
+
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+        vk::DependencyFlags(), { vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead) }, {}, {}
+    );
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, {descriptorSets[0]}, {});
+    commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(StepConstants), &constants);
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, forcePipeline);
+    commandBuffer.dispatch(groups, 1, 1);
+}
+
+void Compute::submitInterleave()
+{
+    const auto groups = (m_constants.count + m_tuning.workgroupSize - 1) / m_tuning.workgroupSize;
+
+    initialCommandBuffer = m_device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(commandPool, vk::CommandBufferLevel::ePrimary, 1))[0];
+    const auto& commandBuffer = initialCommandBuffer;
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, {initialDescriptorSet}, {});
+        commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(StepConstants), &m_constants);
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, initialPipeline);
+        commandBuffer.dispatch(groups, 1, 1);
+        recordInitialForces(commandBuffer);
+    commandBuffer.end();
+
+    const vk::PipelineStageFlags waitStage(vk::PipelineStageFlagBits::eComputeShader);
+
+    initialFence = m_device.createFence(vk::FenceCreateInfo());
+    queue.submit({ vk::SubmitInfo(1, &uploadedSemaphore, &waitStage, 1, &commandBuffer) }, initialFence);
+}
+
+void Compute::submitGenerate(const Distribution distribution, const uint32_t seed)
+{
+    const auto groups = (m_constants.count + m_tuning.workgroupSize - 1) / m_tuning.workgroupSize;
+
+    GenerateConstants constants;
+    constants.count = m_constants.count;
+    constants.seed = seed;
+    constants.distribution = static_cast<uint32_t>(distribution);
+    constants.padding = 0;
+
+    initialCommandBuffer = m_device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(commandPool, vk::CommandBufferLevel::ePrimary, 1))[0];
+    const auto& commandBuffer = initialCommandBuffer;
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, {initialDescriptorSet}, {});
+        commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(GenerateConstants), &constants);
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, initialPipeline);
+        commandBuffer.dispatch(groups, 1, 1);
+        recordInitialForces(commandBuffer);
+    commandBuffer.end();
+
+    // the first step's barrier orders it after this
+    initialFence = m_device.createFence(vk::FenceCreateInfo());
+    queue.submit({ vk::SubmitInfo(0, nullptr, nullptr, 1, &commandBuffer) }, initialFence);
+}
+
+void Compute::releaseInitial()
+{
+    columns.release();
+
+    if (initialCommandBuffer) m_device.freeCommandBuffers(commandPool, { initialCommandBuffer });
+    initialCommandBuffer = vk::CommandBuffer();
+
+    if (initialFence) m_device.destroyFence(initialFence);
+    initialFence = vk::Fence();
+}
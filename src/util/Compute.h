@@ -0,0 +1,215 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "BoundedBuffer.h"
+#include "ComputeTuning.h"
+#include "GpuProfiler.h"
+#include "ParticleSource.h"
+#include "PipelineCache.h"
+#include "QueueTimer.h"
+#include "UploadManager.h"
+#include "../nbody/initial.h"
+#include "../nbody/Particles.h"
+
+// All pairs N-body integrator running on the compute queue.
+// Step k integrates the state buffer in place and snapshots it into frame buffer k % bufferCount() for Graphics to draw, 
+// so step k + 1 runs while frame k is drawn. Frame buffers are exclusive to one queue family at a time and change hands with ownership barriers.
+// A step can take several fixed substeps or none, only the last one is snapshotted.
+// The initial state is either uploaded column by column as given and interleaved on the device, so a mapped checkpoint
+// goes from disk to the GPU without the host touching every particle, or generated on the device with nothing uploaded at all
+class Compute : public ParticleSource
+{
+public:
+    Compute(
+        const vk::Device& dev,
+        const vk::PhysicalDevice& physicalDevice,
+        const uint32_t computeFamilyIndex,
+        const uint32_t computeQueueIndex,
+        const uint32_t graphicsFamilyIndex,
+        const ParticleColumns& initial,
+        const float softening,
+        const float dt,
+        const uint32_t bufferCount,
+        UploadManager& uploads,
+        const PipelineCache& pipelineCache,
+        const ComputeTuning& tuning = ComputeTuning()
+    );
+
+    // `count` particles of `distribution` generated by initial.comp from the random streams generateParticles() draws from `seed`,
+    // see there for how far apart the two can come out
+    Compute(
+        const vk::Device& dev,
+        const vk::PhysicalDevice& physicalDevice,
+        const uint32_t computeFamilyIndex,
+        const uint32_t computeQueueIndex,
+        const uint32_t graphicsFamilyIndex,
+        const Distribution distribution,
+        const size_t count,
+        const uint32_t seed,
+        const float softening,
+        const float dt,
+        const uint32_t bufferCount,
+        const PipelineCache& pipelineCache,
+        const ComputeTuning& tuning = ComputeTuning()
+    );
+
+    Compute();
+
+    Compute(const Compute& other) = delete;
+
+    Compute(Compute&& other);
+
+    ~Compute();
+
+    Compute& operator=(const Compute& other) = delete;
+
+    Compute& operator=(Compute&& other);
+
+    uint32_t count() const override;
+
+    uint32_t bufferCount() const override;
+
+    const vk::Buffer& buffer(const uint32_t index) const override;
+
+    void acquire(const vk::CommandBuffer& commandBuffer, const uint32_t index) const override;
+
+    void release(const vk::CommandBuffer& commandBuffer, const uint32_t index) const override;
+
+    // Frame buffer written by step `step`
+    uint32_t slot(const uint64_t step) const;
+
+    // Signaled once step `step` is done with its frame buffer
+    const vk::Semaphore& simulated(const uint64_t step) const;
+
+    // To be signaled by the draw of step `step`, the step bufferCount() later waits on it before reusing the buffer
+    const vk::Semaphore& drawn(const uint64_t step) const;
+
+    // Submits the next step, `substeps` kick-drift-kick leapfrog integrations of dt and a snapshot of the result, the same scheme
+    // as the CPU engines. 0 snapshots the current state again.
+    // The snapshot moved by -dt along its velocities is the previous state up to a term of order dt^2
+    void step(const uint32_t substeps = 1);
+
+    uint64_t steps() const;
+
+    const QueueTimer& timer() const;
+
+    // "force" and "drift" scopes, one query set per frame buffer
+    const GpuProfiler& profiler() const;
+
+    void await();
+
+    // The next step() also copies its result into the host visible readback buffer of its slot, in the same submission.
+    // What the slot's buffer holds from bufferCount() steps before has to be taken by then
+    void requestReadback();
+
+    // Whether the readback of step `step` landed
+    bool isReadbackDone(const uint64_t step) const;
+
+    // Waits for the readback of step `step` if it did not land yet and reads it into `dest`
+    void takeReadback(const uint64_t step, Particles& dest);
+
+    // Blocks until everything submitted so far is done and reads the state buffer back into `dest`, through the readback
+    // buffer of the next step's slot - no readback may be pending there.
+    // The state is that of the last submitted step, which is ahead of the drawn one
+    void download(Particles& dest);
+
+    void reset();
+
+    void release();
+
+private:
+    struct StepConstants
+    {
+        uint32_t    count;
+        float       dt;
+        float       softening2;
+        uint32_t    snapshot;       // the last pass of the step copies the result into the frame buffer
+    };
+
+    // initial.comp's, pushed through the same range
+    struct GenerateConstants
+    {
+        uint32_t    count;
+        uint32_t    seed;
+        uint32_t    distribution;
+        uint32_t    padding;
+    };
+    static_assert(sizeof(GenerateConstants) <= sizeof(StepConstants), "push constant range is sized for StepConstants");
+
+    // Command pool and the state buffer for `count` particles
+    void createState(const size_t count, const float softening, const float dt);
+
+    // Everything else, once the state buffer and the columns if any exist
+    void createFrames(const uint32_t bufferCount, const PipelineCache& pipelineCache);
+
+    void createDescriptors();
+
+    void createPipelines(const PipelineCache& pipelineCache);
+
+    void createCommandBuffers();
+
+    // Readback buffers, their fences and copies, on the first readback
+    void createReadbacks();
+
+    // `isIntegrating` false only snapshots, drifting by 0
+    void recordStep(const vk::CommandBuffer& commandBuffer, const uint32_t index, const bool acquireFrame, const bool isIntegrating);
+
+    // Substeps ahead of the snapshotted one, no frame buffer involved
+    void recordIntegrate(const vk::CommandBuffer& commandBuffer);
+
+    // State buffer into readback buffer `index`, visible to the host and out of the way of the next step's writes once done
+    void recordReadback(const vk::CommandBuffer& commandBuffer, const uint32_t index);
+
+    // Accelerations of the initial state for the first step's opening half kick, after the interleave or generation
+    void recordInitialForces(const vk::CommandBuffer& commandBuffer);
+
+    // Columns into the state buffer once their upload is in, the first step follows it in queue order
+    void submitInterleave();
+
+    // Fills the state buffer ahead of the first step, no upload to wait for
+    void submitGenerate(const Distribution distribution, const uint32_t seed);
+
+    // The uploaded columns and the interleave's or generator's command buffer are only needed until it ran
+    void releaseInitial();
+
+    vk::CommandPool                 commandPool;
+    vk::DescriptorSetLayout         descriptorSetLayout;
+    vk::DescriptorPool              descriptorPool;
+    std::vector<vk::DescriptorSet>  descriptorSets;
+    vk::PipelineLayout              pipelineLayout;
+    vk::Pipeline                    forcePipeline;
+    vk::Pipeline                    driftPipeline;
+    vk::Pipeline                    initialPipeline;        // interleave.comp with columns, initial.comp without
+    vk::DescriptorSet               initialDescriptorSet;
+    std::vector<vk::CommandBuffer>  firstCommandBuffers;    // first use of a frame buffer, nothing to take back from graphics yet
+    std::vector<vk::CommandBuffer>  commandBuffers;
+    std::vector<vk::CommandBuffer>  firstSnapshotCommandBuffers;
+    std::vector<vk::CommandBuffer>  snapshotCommandBuffers;
+    vk::CommandBuffer               integrateCommandBuffer; // simultaneous use, submitted once per extra substep
+    std::vector<vk::CommandBuffer>  readbackCommandBuffers;
+    std::vector<vk::Semaphore>      simulatedSemaphores;
+    std::vector<vk::Semaphore>      drawnSemaphores;
+    vk::Semaphore                   uploadedSemaphore;      // initial columns, waited on by the interleave
+    vk::CommandBuffer               initialCommandBuffer;   // the interleave or the generator
+    vk::Fence                       initialFence;           // columns and command buffer may go once signaled
+    std::vector<vk::Fence>          readbackFences;         // signaled by the step that read back, reset once taken
+    BoundedBuffer                   columns;
+    BoundedBuffer                   particles;
+    BoundedBuffer                   accelerations;
+    std::vector<BoundedBuffer>      frames;
+    std::vector<BoundedBuffer>      readbacks;              // host visible, one per frame buffer
+    QueueTimer                      timestamps;
+    GpuProfiler                     m_profiler;
+    vk::Queue                       queue;
+    StepConstants                   m_constants;
+    ComputeTuning                   m_tuning;
+    uint32_t                        m_computeFamily;
+    uint32_t                        m_graphicsFamily;
+    uint64_t                        m_steps;
+    bool                            m_isReadbackRequested;
+    vk::PhysicalDevice              m_physicalDevice;
+    vk::Device                      m_device;
+};
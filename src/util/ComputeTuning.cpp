@@ -0,0 +1,24 @@
+#include "ComputeTuning.h"
+
+#include <cstddef>
+
+namespace
+{
+
+const vk::SpecializationMapEntry SPECIALIZATION_ENTRIES[] = {
+    vk::SpecializationMapEntry(0, offsetof(ComputeTuning, workgroupSize), sizeof(uint32_t)),
+    vk::SpecializationMapEntry(1, offsetof(ComputeTuning, tileSize), sizeof(uint32_t))
+};
+
+}
+
+vk::SpecializationInfo ComputeTuning::specializationInfo() const
+{
+    // drift.comp has no constant 1, entries for missing constants are ignored
+    return vk::SpecializationInfo(2, SPECIALIZATION_ENTRIES, sizeof(ComputeTuning), this);
+}
+
+std::string ComputeTuning::toString() const
+{
+    return "workgroup " + std::to_string(workgroupSize) + ", tile " + std::to_string(tileSize);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+
+#include "../config.h"
+
+// Specialization constants of the compute shaders - 0 is the workgroup size, 1 the tile width of nbody.comp
+struct ComputeTuning
+{
+    uint32_t workgroupSize = config::COMPUTE_WORKGROUP_SIZE;
+    uint32_t tileSize = config::COMPUTE_TILE_SIZE;
+
+    // Points into `this`, which has to outlive the pipeline creation it is used for
+    vk::SpecializationInfo specializationInfo() const;
+
+    std::string toString() const;
+};
@@ -0,0 +1,44 @@
+#include "DeletionQueue.h"
+
+DeletionQueue::DeletionQueue(const uint64_t latency)
+    : m_latency(latency), m_frame(0)
+{
+}
+
+DeletionQueue::~DeletionQueue()
+{
+    flush();
+}
+
+void DeletionQueue::retire(std::function<void()> destroy)
+{
+    m_entries.push_back({ m_frame, std::move(destroy) });
+}
+
+void DeletionQueue::collect(const uint64_t frame)
+{
+    m_frame = frame;
+
+    // entries are in frame order, frame N is done once frame N + latency has waited on its fence
+    while (!m_entries.empty() and m_entries.front().lastUse + m_latency <= frame)
+    {
+        auto destroy = std::move(m_entries.front().destroy);
+        m_entries.pop_front();
+        destroy();
+    }
+}
+
+void DeletionQueue::flush()
+{
+    while (!m_entries.empty())
+    {
+        auto destroy = std::move(m_entries.front().destroy);
+        m_entries.pop_front();
+        destroy();
+    }
+}
+
+size_t DeletionQueue::size() const
+{
+    return m_entries.size();
+}
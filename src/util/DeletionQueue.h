@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// Defers destruction of objects the GPU may still use until the frames that could reference them have retired.
+// The owner of the frame fences reports every frame through collect(), retire() then ties a destructor to the current frame
+class DeletionQueue
+{
+public:
+    // `latency` frames after a frame started, its fence has been waited on
+    explicit DeletionQueue(const uint64_t latency);
+
+    DeletionQueue(const DeletionQueue& other) = delete;
+
+    // Runs whatever is still queued, the device must be idle by then
+    ~DeletionQueue();
+
+    DeletionQueue& operator=(const DeletionQueue& other) = delete;
+
+    // `destroy` runs once every frame up to the current one is known to be done
+    void retire(std::function<void()> destroy);
+
+    // Call after waiting on the fence of the frame `latency` frames back, before frame `frame` is recorded
+    void collect(const uint64_t frame);
+
+    // Runs everything right away, e.g. after a vkDeviceWaitIdle
+    void flush();
+
+    size_t size() const;
+
+private:
+    struct Entry
+    {
+        uint64_t                lastUse;
+        std::function<void()>   destroy;
+    };
+
+    std::deque<Entry>   m_entries;
+    uint64_t            m_latency;
+    uint64_t            m_frame;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "MVPTransform.h"
+
+// Per frame shader constants, std140 mirror of the Frame block in simple.vert
+struct FrameConstants
+{
+    MVPTransform    transform;
+    glm::vec4       camera;         // eye position, w unused
+    float           time;           // frame time of the simulation clock
+    float           dt;             // simulation time step
+    uint32_t        particleCount;
+    float           rewind;         // drawn position is position + velocity * rewind, interpolates back from a drift-last step
+    glm::vec2       billboardScale; // clip space half size of a billboard at unit depth
+};
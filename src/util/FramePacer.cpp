@@ -0,0 +1,63 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "../config.h"
+
+namespace
+{
+
+const std::chrono::microseconds MIN_SPIN(config::PACING_SPIN_MICROSECONDS);
+
+}
+
+FramePacer::FramePacer(const double targetFps)
+    : m_period(Clock::duration::zero()), m_spin(MIN_SPIN), m_deadline(Clock::now())
+{
+    if (targetFps > 0.0)
+    {
+        m_period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+    }
+}
+
+bool FramePacer::isEnabled() const
+{
+    return m_period != Clock::duration::zero();
+}
+
+void FramePacer::wait()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    m_deadline += m_period;
+    const auto now = Clock::now();
+
+    if (now >= m_deadline)
+    {
+        // More than a frame behind, e.g. after a stall - start over rather than rushing frames out to catch up
+        if (now - m_deadline > m_period)
+        {
+            m_deadline = now;
+        }
+        return;
+    }
+
+    const auto sleep = m_deadline - now - m_spin;
+    if (sleep > Clock::duration::zero())
+    {
+        std::this_thread::sleep_for(sleep);
+
+        // decays slowly back to the minimum once the scheduler calms down
+        const auto overshoot = Clock::now() - (now + sleep);
+        m_spin = std::max<Clock::duration>(MIN_SPIN, std::max<Clock::duration>(overshoot, m_spin - m_spin / 64));
+    }
+
+    while (Clock::now() < m_deadline)
+    {
+        std::this_thread::yield();
+    }
+}
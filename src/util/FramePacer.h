@@ -0,0 +1,24 @@
+#pragma once
+
+#include <chrono>
+
+// Caps the frame rate, e.g. to save power on shared hosts. Sleeps most of the way to the next frame's deadline
+// and spins the rest, sleeps overshoot by up to a scheduler tick - the spin margin follows the worst overshoot seen
+class FramePacer
+{
+public:
+    // `targetFps` 0 never waits
+    explicit FramePacer(const double targetFps = 0.0);
+
+    bool isEnabled() const;
+
+    // Returns once the next frame is due, right away when running behind
+    void wait();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::duration     m_period;
+    Clock::duration     m_spin;
+    Clock::time_point   m_deadline;
+};
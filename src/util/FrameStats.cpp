@@ -0,0 +1,163 @@
+#include "FrameStats.h"
+
+#include <iomanip>
+#include <stdexcept>
+
+namespace
+{
+
+constexpr double QUANTILES[] = { 0.5, 0.95, 0.99 };
+
+double toMilliseconds(const uint64_t nanoseconds)
+{
+    return nanoseconds * 1e-6;
+}
+
+}
+
+const char* FrameStats::toString(const Phase phase)
+{
+    switch (phase)
+    {
+    case Pace:      return "pace";
+    case Fence:     return "fence";
+    case Simulate:  return "simulate";
+    case Acquire:   return "acquire";
+    case Render:    return "render";
+    case Present:   return "present";
+    case Frame:     return "frame";
+    case InputToPresent: return "input_to_present";
+    default:        return "unknown";
+    }
+}
+
+void FrameStats::start()
+{
+    m_frameStart = Clock::now();
+    m_lapStart = m_frameStart;
+    m_current.fill(0);
+}
+
+void FrameStats::lap(const Phase phase)
+{
+    auto now = Clock::now();
+    auto elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_lapStart).count());
+
+    m_phases[phase].record(elapsed);
+    m_current[phase] += elapsed;
+    m_lapStart = now;
+}
+
+void FrameStats::finish()
+{
+    auto elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_frameStart).count());
+
+    m_phases[Frame].record(elapsed);
+    m_current[Frame] = elapsed;
+
+    if (m_trace.is_open())
+    {
+        m_trace << m_frames;
+        for (auto phase = 0; phase < PhaseCount; ++phase)
+        {
+            m_trace << ',' << m_current[phase] / 1000;
+        }
+        m_trace << '\n';
+    }
+
+    ++m_frames;
+}
+
+void FrameStats::latency(const uint64_t nanoseconds)
+{
+    m_phases[InputToPresent].record(nanoseconds);
+    m_current[InputToPresent] = nanoseconds;
+}
+
+void FrameStats::openTrace(const std::string& path)
+{
+    m_trace.open(path, std::ios::trunc);
+    if (!m_trace)
+    {
+        throw std::runtime_error("could not open trace file: " + path);
+    }
+
+    m_trace << "frame";
+    for (auto phase = 0; phase < PhaseCount; ++phase)
+    {
+        m_trace << ',' << toString(static_cast<Phase>(phase)) << "_us";
+    }
+    m_trace << '\n';
+}
+
+void FrameStats::write(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+    {
+        throw std::runtime_error("could not open stats file: " + path);
+    }
+
+    auto isJson = path.size() >= 5 and path.compare(path.size() - 5, 5, ".json") == 0;
+    if (isJson)
+    {
+        writeJson(file);
+    }
+    else
+    {
+        writeCsv(file);
+    }
+}
+
+void FrameStats::writeCsv(std::ostream& os) const
+{
+    os << "phase,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+    for (auto phase = 0; phase < PhaseCount; ++phase)
+    {
+        const auto& histogram = m_phases[phase];
+
+        os << toString(static_cast<Phase>(phase)) << ',' << histogram.count() << ',' << histogram.mean() * 1e-6;
+        for (auto quantile : QUANTILES)
+        {
+            os << ',' << toMilliseconds(histogram.quantile(quantile));
+        }
+        os << ',' << toMilliseconds(histogram.max()) << '\n';
+    }
+}
+
+void FrameStats::writeJson(std::ostream& os) const
+{
+    os << "{\n";
+    for (auto phase = 0; phase < PhaseCount; ++phase)
+    {
+        const auto& histogram = m_phases[phase];
+
+        os  << "  \"" << toString(static_cast<Phase>(phase)) << "\": { "
+            << "\"count\": " << histogram.count() << ", "
+            << "\"mean_ms\": " << histogram.mean() * 1e-6 << ", "
+            << "\"p50_ms\": " << toMilliseconds(histogram.quantile(0.5)) << ", "
+            << "\"p95_ms\": " << toMilliseconds(histogram.quantile(0.95)) << ", "
+            << "\"p99_ms\": " << toMilliseconds(histogram.quantile(0.99)) << ", "
+            << "\"max_ms\": " << toMilliseconds(histogram.max()) << " }"
+            << (phase + 1 < PhaseCount ? ",\n" : "\n");
+    }
+    os << "}\n";
+}
+
+void FrameStats::report(std::ostream& os) const
+{
+    for (auto phase = 0; phase < PhaseCount; ++phase)
+    {
+        const auto& histogram = m_phases[phase];
+        if (!histogram.count())
+        {
+            continue;
+        }
+
+        os  << "CPU " << std::left << std::setw(16) << toString(static_cast<Phase>(phase)) << std::right
+            << " p50 " << toMilliseconds(histogram.quantile(0.5)) << "ms"
+            << ", p95 " << toMilliseconds(histogram.quantile(0.95)) << "ms"
+            << ", p99 " << toMilliseconds(histogram.quantile(0.99)) << "ms"
+            << ", max " << toMilliseconds(histogram.max()) << "ms\n";
+    }
+}
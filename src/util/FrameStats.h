@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+#include "LatencyHistogram.h"
+
+// Where drawFrame spends its CPU time, one latency histogram per phase plus the whole frame and the input latency.
+// Phases are closed with lap() in order, each measures from the previous lap (or start()) on the steady clock
+class FrameStats
+{
+public:
+    enum Phase
+    {
+        Pace,       // FramePacer holding the frame back to the target rate
+        Fence,      // waiting for the frame in flight slot to free up
+        Simulate,   // CPU engine step
+        Acquire,
+        Render,     // uniform update, uploads and queue submits
+        Present,
+        Frame,      // start() to finish()
+        InputToPresent, // not a phase, see latency()
+        PhaseCount
+    };
+
+    static const char* toString(const Phase phase);
+
+    void start();
+
+    void lap(const Phase phase);
+
+    void finish();
+
+    // Input polled before a frame was recorded until its rendering was seen done, ready for the presentation engine.
+    // The display itself is not visible from here, whatever the swapchain queues up comes on top
+    void latency(const uint64_t nanoseconds);
+
+    // Adds a line per frame with every phase in microseconds
+    void openTrace(const std::string& path);
+
+    // p50 / p95 / p99 / max per phase, format picked by the extension: .json, anything else is CSV
+    void write(const std::string& path) const;
+
+    void writeCsv(std::ostream& os) const;
+
+    void writeJson(std::ostream& os) const;
+
+    // Short human readable summary
+    void report(std::ostream& os) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::array<LatencyHistogram, PhaseCount>    m_phases;
+    std::array<uint64_t, PhaseCount>            m_current {};
+    Clock::time_point                           m_frameStart;
+    Clock::time_point                           m_lapStart;
+    std::ofstream                               m_trace;
+    uint64_t                                    m_frames = 0;
+};
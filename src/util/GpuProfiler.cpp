@@ -0,0 +1,264 @@
+#include "GpuProfiler.h"
+
+#include "../config.h"
+
+namespace
+{
+
+// Statistics come back ordered by flag bit
+const std::pair<vk::QueryPipelineStatisticFlagBits, const char*> STATISTIC_NAMES[] = {
+    { vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices, "vertices" },
+    { vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives, "primitives" },
+    { vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations, "vertex invocations" },
+    { vk::QueryPipelineStatisticFlagBits::eGeometryShaderInvocations, "geometry invocations" },
+    { vk::QueryPipelineStatisticFlagBits::eGeometryShaderPrimitives, "geometry primitives" },
+    { vk::QueryPipelineStatisticFlagBits::eClippingInvocations, "clipping invocations" },
+    { vk::QueryPipelineStatisticFlagBits::eClippingPrimitives, "clipped primitives" },
+    { vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations, "fragment invocations" },
+    { vk::QueryPipelineStatisticFlagBits::eTessellationControlShaderPatches, "control patches" },
+    { vk::QueryPipelineStatisticFlagBits::eTessellationEvaluationShaderInvocations, "evaluation invocations" },
+    { vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations, "compute invocations" },
+};
+
+}
+
+GpuProfiler::GpuProfiler(
+    const vk::Device& dev, const vk::PhysicalDevice& physicalDevice, const uint32_t familyIndex,
+    const uint32_t sets, const std::vector<std::string>& scopes, 
+    const vk::QueryPipelineStatisticFlags& statistics)
+    :   m_scopes(scopes), 
+        m_times(scopes.size(), RollingStats(config::PROFILER_WINDOW)),
+        m_statisticSamples(scopes.size(), 0),
+        m_pending(sets, false),
+        m_statisticFlags(statistics),
+        m_statisticCount(0),
+        m_validMask(0),
+        m_period(physicalDevice.getProperties().limits.timestampPeriod),
+        m_device(dev)
+{
+    auto queries = sets * static_cast<uint32_t>(scopes.size());
+
+    auto validBits = physicalDevice.getQueueFamilyProperties()[familyIndex].timestampValidBits;
+    if (validBits)
+    {
+        m_validMask = validBits >= 64 ? ~uint64_t(0) : (uint64_t(1) << validBits) - 1;
+        timestampPool = dev.createQueryPool(vk::QueryPoolCreateInfo(vk::QueryPoolCreateFlags(), vk::QueryType::eTimestamp, 2 * queries));
+    }
+
+    for (const auto& statistic : STATISTIC_NAMES)
+    {
+        if (statistics & statistic.first)
+        {
+            ++m_statisticCount;
+        }
+    }
+
+    if (m_statisticCount)
+    {
+        statisticsPool = dev.createQueryPool(vk::QueryPoolCreateInfo(vk::QueryPoolCreateFlags(), vk::QueryType::ePipelineStatistics, queries, statistics));
+    }
+    m_statistics.assign(scopes.size(), std::vector<double>(m_statisticCount, 0.0));
+}
+
+GpuProfiler::GpuProfiler()
+    : m_statisticCount(0), m_validMask(0), m_period(0.0f)
+{
+}
+
+GpuProfiler::GpuProfiler(GpuProfiler&& other)
+{
+    timestampPool = other.timestampPool;
+    statisticsPool = other.statisticsPool;
+    m_scopes = std::move(other.m_scopes);
+    m_times = std::move(other.m_times);
+    m_statistics = std::move(other.m_statistics);
+    m_statisticSamples = std::move(other.m_statisticSamples);
+    m_pending = std::move(other.m_pending);
+    m_statisticFlags = other.m_statisticFlags;
+    m_statisticCount = other.m_statisticCount;
+    m_validMask = other.m_validMask;
+    m_period = other.m_period;
+    m_device = other.m_device;
+
+    other.reset();
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    release();
+    reset();
+}
+
+GpuProfiler& GpuProfiler::operator=(GpuProfiler&& other)
+{
+    release();
+
+    timestampPool = other.timestampPool;
+    statisticsPool = other.statisticsPool;
+    m_scopes = std::move(other.m_scopes);
+    m_times = std::move(other.m_times);
+    m_statistics = std::move(other.m_statistics);
+    m_statisticSamples = std::move(other.m_statisticSamples);
+    m_pending = std::move(other.m_pending);
+    m_statisticFlags = other.m_statisticFlags;
+    m_statisticCount = other.m_statisticCount;
+    m_validMask = other.m_validMask;
+    m_period = other.m_period;
+    m_device = other.m_device;
+
+    other.reset();
+
+    return *this;
+}
+
+bool GpuProfiler::isEnabled() const
+{
+    return timestampPool or statisticsPool;
+}
+
+void GpuProfiler::reset(const vk::CommandBuffer& commandBuffer, const uint32_t set) const
+{
+    auto first = query(set, 0);
+    auto count = static_cast<uint32_t>(m_scopes.size());
+
+    if (timestampPool) commandBuffer.resetQueryPool(timestampPool, 2 * first, 2 * count);
+    if (statisticsPool) commandBuffer.resetQueryPool(statisticsPool, first, count);
+}
+
+void GpuProfiler::begin(const vk::CommandBuffer& commandBuffer, const uint32_t set, const uint32_t scope) const
+{
+    auto index = query(set, scope);
+
+    if (timestampPool) commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampPool, 2 * index);
+    if (statisticsPool) commandBuffer.beginQuery(statisticsPool, index, vk::QueryControlFlags());
+}
+
+void GpuProfiler::end(const vk::CommandBuffer& commandBuffer, const uint32_t set, const uint32_t scope) const
+{
+    auto index = query(set, scope);
+
+    if (statisticsPool) commandBuffer.endQuery(statisticsPool, index);
+    if (timestampPool) commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampPool, 2 * index + 1);
+}
+
+void GpuProfiler::submitted(const uint32_t set)
+{
+    if (isEnabled())
+    {
+        m_pending[set] = true;
+    }
+}
+
+void GpuProfiler::collect(const uint32_t set)
+{
+    if (!m_pending[set])
+    {
+        return;
+    }
+    m_pending[set] = false;
+
+    auto first = query(set, 0);
+    auto count = static_cast<uint32_t>(m_scopes.size());
+
+    if (timestampPool)
+    {
+        // begin, availability, end, availability per scope
+        std::vector<uint64_t> results(4 * count);
+        auto status = m_device.getQueryPoolResults(
+            timestampPool, 2 * first, 2 * count, 
+            results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t), 
+            vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability
+        );
+
+        for (auto scope = 0u; status == vk::Result::eSuccess and scope < count; ++scope)
+        {
+            const auto* pair = &results[4 * scope];
+            if (pair[1] and pair[3])
+            {
+                auto ticks = ((pair[2] & m_validMask) - (pair[0] & m_validMask)) & m_validMask;
+                m_times[scope].add(ticks * static_cast<double>(m_period) * 1e-6);
+            }
+        }
+    }
+
+    if (statisticsPool)
+    {
+        // statistics then availability per scope
+        auto stride = m_statisticCount + 1;
+        std::vector<uint64_t> results(stride * count);
+        auto status = m_device.getQueryPoolResults(
+            statisticsPool, first, count, 
+            results.size() * sizeof(uint64_t), results.data(), stride * sizeof(uint64_t), 
+            vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability
+        );
+
+        for (auto scope = 0u; status == vk::Result::eSuccess and scope < count; ++scope)
+        {
+            const auto* values = &results[stride * scope];
+            if (values[m_statisticCount])
+            {
+                for (auto i = 0u; i < m_statisticCount; ++i)
+                {
+                    m_statistics[scope][i] += values[i];
+                }
+                ++m_statisticSamples[scope];
+            }
+        }
+    }
+}
+
+void GpuProfiler::report(std::ostream& os) const
+{
+    for (auto scope = 0u; scope < m_scopes.size(); ++scope)
+    {
+        const auto& times = m_times[scope];
+        if (!times.count() and !m_statisticSamples[scope])
+        {
+            continue;
+        }
+
+        os << "GPU " << m_scopes[scope] << ":";
+        if (times.count())
+        {
+            os  << " min " << times.min() << "ms, avg " << times.mean() << "ms, p99 " << times.percentile(0.99) << "ms"
+                << " (last " << times.count() << ")";
+        }
+
+        auto statistic = 0u;
+        for (const auto& name : STATISTIC_NAMES)
+        {
+            if (m_statisticSamples[scope] and (m_statisticFlags & name.first))
+            {
+                os << ", " << m_statistics[scope][statistic++] / m_statisticSamples[scope] << ' ' << name.second;
+            }
+        }
+        os << '\n';
+    }
+}
+
+void GpuProfiler::reset()
+{
+    timestampPool = vk::QueryPool();
+    statisticsPool = vk::QueryPool();
+    m_scopes.clear();
+    m_times.clear();
+    m_statistics.clear();
+    m_statisticSamples.clear();
+    m_pending.clear();
+    m_statisticFlags = vk::QueryPipelineStatisticFlags();
+    m_statisticCount = 0;
+    m_validMask = 0;
+    m_period = 0.0f;
+    m_device = vk::Device();
+}
+
+void GpuProfiler::release()
+{
+    if (timestampPool) m_device.destroyQueryPool(timestampPool);
+    if (statisticsPool) m_device.destroyQueryPool(statisticsPool);
+}
+
+uint32_t GpuProfiler::query(const uint32_t set, const uint32_t scope) const
+{
+    return set * static_cast<uint32_t>(m_scopes.size()) + scope;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "RollingStats.h"
+
+// Timestamps and optional pipeline statistics around named scopes of recorded command buffers.
+// Queries are grouped in sets, one per command buffer that can be in flight (e.g. per frame in flight), 
+// and read back without waiting when the owner knows the set's last submission is done
+class GpuProfiler
+{
+public:
+    // `statistics` empty disables pipeline statistics, the device must have pipelineStatisticsQuery enabled otherwise
+    GpuProfiler(
+        const vk::Device& dev, const vk::PhysicalDevice& physicalDevice, const uint32_t familyIndex,
+        const uint32_t sets, const std::vector<std::string>& scopes, 
+        const vk::QueryPipelineStatisticFlags& statistics = vk::QueryPipelineStatisticFlags()
+    );
+
+    GpuProfiler();
+
+    GpuProfiler(const GpuProfiler& other) = delete;
+
+    GpuProfiler(GpuProfiler&& other);
+
+    ~GpuProfiler();
+
+    GpuProfiler& operator=(const GpuProfiler& other) = delete;
+
+    GpuProfiler& operator=(GpuProfiler&& other);
+
+    bool isEnabled() const;
+
+    // Recorded outside a render pass before any scope of `set`
+    void reset(const vk::CommandBuffer& commandBuffer, const uint32_t set) const;
+
+    void begin(const vk::CommandBuffer& commandBuffer, const uint32_t set, const uint32_t scope) const;
+
+    void end(const vk::CommandBuffer& commandBuffer, const uint32_t set, const uint32_t scope) const;
+
+    // A command buffer using `set` was submitted
+    void submitted(const uint32_t set);
+
+    // Folds the results of `set` into the rolling stats if they are available, never blocks
+    void collect(const uint32_t set);
+
+    // One line per scope: min / avg / p99 GPU time and average statistics
+    void report(std::ostream& os) const;
+
+    void reset();
+
+    void release();
+
+private:
+    uint32_t query(const uint32_t set, const uint32_t scope) const;
+
+    vk::QueryPool                       timestampPool;
+    vk::QueryPool                       statisticsPool;
+    std::vector<std::string>            m_scopes;
+    std::vector<RollingStats>           m_times;
+    std::vector<std::vector<double>>    m_statistics;       // per scope running sums, one per enabled statistic
+    std::vector<uint64_t>               m_statisticSamples;
+    std::vector<bool>                   m_pending;          // submitted but not collected yet
+    vk::QueryPipelineStatisticFlags     m_statisticFlags;
+    uint32_t                            m_statisticCount;
+    uint64_t                            m_validMask;
+    float                               m_period;
+    vk::Device                          m_device;
+};
@@ -1,29 +1,76 @@
 #include "Graphics.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
 #include "general.h"
+#include "shaders.h"
+#include "../config.h"
+
+namespace
+{
 
-const std::array<Vertex, 4> g_vertecies
+const std::array<uint16_t, 6> g_indices
 {
-    Vertex{ {-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-	Vertex{ { 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-    Vertex{ { 0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}},
-    Vertex{ {-0.5f,  0.5f}, {1.0f, 1.0f, 1.0f}}
+    0, 1, 2, 2, 3, 0
 };
 
+}
+
+const char* toString(const ParticleStyle style)
+{
+    switch (style)
+    {
+    case ParticleStyle::Points:
+        return "points";
+    case ParticleStyle::Billboards:
+        return "billboards";
+    }
+
+    return "unknown";
+}
+
+ParticleStyle parseParticleStyle(const std::string& name)
+{
+    for (auto style : { ParticleStyle::Points, ParticleStyle::Billboards })
+    {
+        if (name == toString(style))
+        {
+            return style;
+        }
+    }
+
+    throw std::invalid_argument("unknown particle style: " + name);
+}
+
 Graphics::Graphics(
     const vk::Device& dev,
-    const Present& present,
+    const RenderTarget& target,
     const uint32_t graphicsFamilyIndex,
-    const vk::PhysicalDevice& physicalDevice)
-    : m_device(dev), m_physicalDevice(physicalDevice), m_projection(1.0f)
+    const vk::PhysicalDevice& physicalDevice,
+    const ParticleSource& particles,
+    const PipelineCache& pipelineCache,
+    const ParticleStyle style,
+    const bool cull,
+    const uint32_t recordThreads,
+    const uint32_t framesInFlight)
+    : m_device(dev), m_physicalDevice(physicalDevice), m_projection(1.0f), m_time(0.0), m_rewind(0.0f), m_style(style), m_cull(cull), m_frames(framesInFlight), m_renders(0), m_particles(&particles), m_pipelineCache(&pipelineCache)
 {
+    // One draw per recording thread, chunks line up with cull workgroups so each workgroup counts into a single draw
+    const auto count = std::max(1u, m_particles->count());
+    const auto threads = std::max(1u, recordThreads);
+    m_chunkSize = (count + threads - 1) / threads;
+    m_chunkSize = (m_chunkSize + config::COMPUTE_WORKGROUP_SIZE - 1) / config::COMPUTE_WORKGROUP_SIZE * config::COMPUTE_WORKGROUP_SIZE;
+    m_chunks = (count + m_chunkSize - 1) / m_chunkSize;
+
     queue = dev.getQueue(graphicsFamilyIndex, 0);
 
-    createRenderPass(present);
+    createRenderPass(target);
 
-    vk::DescriptorSetLayoutBinding mvpLayoutBinding(
+    vk::DescriptorSetLayoutBinding frameLayoutBinding(
         0, 
-        vk::DescriptorType::eUniformBuffer, 
+        vk::DescriptorType::eUniformBufferDynamic, 
         1, 
         vk::ShaderStageFlagBits::eVertex
     );
@@ -31,49 +78,85 @@ Graphics::Graphics(
     descriptorSetLayout = dev.createDescriptorSetLayout(
         vk::DescriptorSetLayoutCreateInfo(
             vk::DescriptorSetLayoutCreateFlags(), 
-            1, &mvpLayoutBinding
+            1, &frameLayoutBinding
         )
     );
 
-    createGraphicsPipeline(present);
-    createFramebuffers(present);
+    createGraphicsPipeline();
+    createFramebuffers(target);
 
-    vk::CommandPoolCreateInfo commandPoolInfo(vk::CommandPoolCreateFlags(), graphicsFamilyIndex);
-    commandPool = dev.createCommandPool(commandPoolInfo);
+    m_recorder = CommandRecorder(dev, graphicsFamilyIndex, m_frames, threads);
 
-    deviceVertecies = createStagedBuffer(physicalDevice, g_vertecies, vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    frameConstants = UniformRing(physicalDevice, dev, sizeof(FrameConstants), m_frames);
+    indexBuffer = BoundedBuffer(
+        physicalDevice, dev, g_indices, vk::BufferUsageFlagBits::eIndexBuffer, 
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+    );
+    if (m_cull)
+    {
+        createCulling();
+    }
+    createDescriptors();
+
+    timestamps = QueueTimer(dev, physicalDevice, graphicsFamilyIndex, config::TIMER_RING);
 
-    createUniformBuffers(present);
-    createDescriptorPool(present);
-    createDescriptorSets(present);
-    createCommandBuffers(present);
+    // pipelineStatisticsQuery and inheritedQueries are enabled on the device whenever they are supported,
+    // the draw scope's query stays active while the secondaries execute
+    const auto features = physicalDevice.getFeatures();
+    m_statistics = features.pipelineStatisticsQuery and features.inheritedQueries
+        ? vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations | vk::QueryPipelineStatisticFlagBits::eClippingPrimitives | vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations
+        : vk::QueryPipelineStatisticFlags();
+    auto scopes = m_cull ? std::vector<std::string>{ "cull", "draw" } : std::vector<std::string>{ "draw" };
+    m_profiler = GpuProfiler(dev, physicalDevice, graphicsFamilyIndex, m_frames, scopes, m_statistics);
 
-    m_projection = glm::perspective(glm::radians(45.0f), present.extent().width / static_cast<float>(present.extent().height), 0.1f, 10.0f);
+    m_projection = glm::perspective(glm::radians(45.0f), target.extent().width / static_cast<float>(target.extent().height), 0.1f, 10.0f);
     m_projection[1][1] *= -1;   
 }
 
 Graphics::Graphics()
+    : m_time(0.0), m_rewind(0.0f), m_format(vk::Format::eUndefined), m_finalLayout(vk::ImageLayout::eUndefined), m_style(ParticleStyle::Billboards), m_cull(false), m_chunkSize(0), m_chunks(0), m_frames(0), m_renders(0), m_particles(nullptr), m_pipelineCache(nullptr)
 {
 
 }
 
 Graphics::Graphics(Graphics&& other)
 {
-    commandPool = other.commandPool;
     renderPass = other.renderPass;
     pipelineLayout = other.pipelineLayout;
     pipeline = other.pipeline;
-    commandBuffers = other.commandBuffers;
     frameBuffers = other.frameBuffers;
     descriptorSetLayout = other.descriptorSetLayout;
     descriptorPool = other.descriptorPool;
-    descriptorSets = other.descriptorSets;
-    deviceVertecies = std::move(other.deviceVertecies);
-    uniforms = std::move(other.uniforms);
+    descriptorSet = other.descriptorSet;
+    indexBuffer = std::move(other.indexBuffer);
+    cullSetLayout = other.cullSetLayout;
+    cullPipelineLayout = other.cullPipelineLayout;
+    cullPipeline = other.cullPipeline;
+    cullSets = other.cullSets;
+    visibleBuffers = std::move(other.visibleBuffers);
+    indirectBuffers = std::move(other.indirectBuffers);
+    m_recorder = std::move(other.m_recorder);
+    frameConstants = std::move(other.frameConstants);
+    timestamps = std::move(other.timestamps);
+    m_profiler = std::move(other.m_profiler);
+    m_statistics = other.m_statistics;
     queue = other.queue;
     m_projection = other.m_projection;
+    m_time = other.m_time;
+    m_rewind = other.m_rewind;
+    m_format = other.m_format;
+    m_finalLayout = other.m_finalLayout;
+    m_extent = other.m_extent;
+    m_style = other.m_style;
+    m_cull = other.m_cull;
+    m_chunkSize = other.m_chunkSize;
+    m_chunks = other.m_chunks;
+    m_frames = other.m_frames;
+    m_renders = other.m_renders;
     m_device = other.m_device;
     m_physicalDevice = other.m_physicalDevice;
+    m_particles = other.m_particles;
+    m_pipelineCache = other.m_pipelineCache;
 
     other.reset();
 }
@@ -88,71 +171,189 @@ Graphics& Graphics::operator=(Graphics&& other)
 {
     release();
 
-    commandPool = other.commandPool;
     renderPass = other.renderPass;
     pipelineLayout = other.pipelineLayout;
     pipeline = other.pipeline;
-    commandBuffers = other.commandBuffers;
     frameBuffers = other.frameBuffers;
     descriptorSetLayout = other.descriptorSetLayout;
     descriptorPool = other.descriptorPool;
-    descriptorSets = other.descriptorSets;
-    deviceVertecies = std::move(other.deviceVertecies);
-    uniforms = std::move(other.uniforms);
+    descriptorSet = other.descriptorSet;
+    indexBuffer = std::move(other.indexBuffer);
+    cullSetLayout = other.cullSetLayout;
+    cullPipelineLayout = other.cullPipelineLayout;
+    cullPipeline = other.cullPipeline;
+    cullSets = other.cullSets;
+    visibleBuffers = std::move(other.visibleBuffers);
+    indirectBuffers = std::move(other.indirectBuffers);
+    m_recorder = std::move(other.m_recorder);
+    frameConstants = std::move(other.frameConstants);
+    timestamps = std::move(other.timestamps);
+    m_profiler = std::move(other.m_profiler);
+    m_statistics = other.m_statistics;
     queue = other.queue;
     m_projection = other.m_projection;
+    m_time = other.m_time;
+    m_rewind = other.m_rewind;
+    m_format = other.m_format;
+    m_finalLayout = other.m_finalLayout;
+    m_extent = other.m_extent;
+    m_style = other.m_style;
+    m_cull = other.m_cull;
+    m_chunkSize = other.m_chunkSize;
+    m_chunks = other.m_chunks;
+    m_frames = other.m_frames;
+    m_renders = other.m_renders;
     m_device = other.m_device;
     m_physicalDevice = other.m_physicalDevice;
+    m_particles = other.m_particles;
+    m_pipelineCache = other.m_pipelineCache;
 
     other.reset();
+
+    return *this;
 }
 
-void Graphics::render(const vk::Semaphore& wait, const vk::Semaphore& signal, const vk::Fence& hostNotify, const uint32_t& imageIndex)
+void Graphics::render(
+    const vk::Semaphore& wait, const vk::Semaphore& signal, const vk::Fence& hostNotify, 
+    const uint32_t& imageIndex, const uint32_t frame, const uint32_t particleBuffer)
 {
-    updateData(imageIndex);
-
     const vk::PipelineStageFlags waitStage(vk::PipelineStageFlagBits::eColorAttachmentOutput);
-    const vk::SubmitInfo submitInfo(1, &wait, &waitStage, 1, &commandBuffers[imageIndex], 1, &signal);
+
+    render(wait, waitStage, signal, hostNotify, imageIndex, frame, particleBuffer);
+}
+
+void Graphics::render(
+    vk::ArrayProxy<const vk::Semaphore> waits, vk::ArrayProxy<const vk::PipelineStageFlags> waitStages,
+    vk::ArrayProxy<const vk::Semaphore> signals, 
+    const vk::Fence& hostNotify, const uint32_t& imageIndex, const uint32_t frame, const uint32_t particleBuffer)
+{
+    updateData(frame);
+    m_profiler.collect(frame);
+
+    std::vector<vk::CommandBuffer> submitted = { record(imageIndex, frame, particleBuffer) };
+    if (timestamps.isEnabled())
+    {
+        submitted = { timestamps.begin(m_renders), submitted[0], timestamps.end(m_renders) };
+    }
+
+    const vk::SubmitInfo submitInfo(
+        waits.size(), waits.data(), waitStages.data(), 
+        submitted.size(), submitted.data(), 
+        signals.size(), signals.data()
+    );
 
     queue.submit({ submitInfo }, hostNotify);
+    m_profiler.submitted(frame);
+    ++m_renders;
 }
 
+void Graphics::setTime(const double seconds, const float rewind)
+{
+    m_time = seconds;
+    m_rewind = rewind;
+}
 
-void Graphics::update(const Present& present)
+vk::CommandBuffer Graphics::record(const uint32_t imageIndex, const uint32_t frame, const uint32_t particleBuffer)
 {
-    for (auto& uniform : uniforms)
+    const auto commandBuffer = m_recorder.beginFrame(frame);
+    const auto dynamicOffset = frameConstants.offset(frame);
+    const auto drawScope = m_cull ? 1u : 0u;
+
+    std::vector<RecordJob> jobs;
+    if (m_cull)
     {
-        uniform.release();
+        jobs.push_back({ vk::CommandBufferInheritanceInfo(), [=](const vk::CommandBuffer& secondary) {
+            recordCull(secondary, frame, particleBuffer, dynamicOffset);
+        } });
     }
-    uniforms.clear();
-    
-    if (descriptorPool) m_device.destroyDescriptorPool(descriptorPool);
-    
-    for (auto& framebuffer : frameBuffers)
+
+    const vk::CommandBufferInheritanceInfo inheritance(renderPass, 0, frameBuffers[imageIndex], VK_FALSE, vk::QueryControlFlags(), m_statistics);
+    for (auto chunk = 0u; chunk < m_chunks; ++chunk)
     {
-        if (framebuffer) m_device.destroyFramebuffer(framebuffer);
+        jobs.push_back({ inheritance, [=](const vk::CommandBuffer& secondary) {
+            recordDraw(secondary, frame, particleBuffer, chunk, dynamicOffset);
+        } });
     }
+
+    const auto secondaries = m_recorder.record(frame, jobs);
+    const auto firstDraw = m_cull ? 1u : 0u;
+
+    vk::RenderPassBeginInfo renderPassBegin;
+    renderPassBegin.renderPass = renderPass;
+    renderPassBegin.framebuffer = frameBuffers[imageIndex];
+    renderPassBegin.renderArea.offset = vk::Offset2D(0, 0);
+    renderPassBegin.renderArea.extent = m_extent;
+    vk::ClearValue clearColor(vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}));
+    renderPassBegin.clearValueCount = 1;
+    renderPassBegin.pClearValues = &clearColor;
+
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        m_profiler.reset(commandBuffer, frame);
+        m_particles->acquire(commandBuffer, particleBuffer);
+        if (m_cull)
+        {
+            commandBuffer.executeCommands(1, &secondaries[0]);
+        }
+        m_profiler.begin(commandBuffer, frame, drawScope);
+        commandBuffer.beginRenderPass(renderPassBegin, vk::SubpassContents::eSecondaryCommandBuffers);
+        commandBuffer.executeCommands(secondaries.size() - firstDraw, &secondaries[firstDraw]);
+        commandBuffer.endRenderPass();
+        m_profiler.end(commandBuffer, frame, drawScope);
+        m_particles->release(commandBuffer, particleBuffer);
+    commandBuffer.end();
+
+    return commandBuffer;
+}
+
+uint64_t Graphics::renders() const
+{
+    return m_renders;
+}
+
+const QueueTimer& Graphics::timer() const
+{
+    return timestamps;
+}
+
+const GpuProfiler& Graphics::profiler() const
+{
+    return m_profiler;
+}
+
+
+void Graphics::update(const RenderTarget& target, DeletionQueue& deletions)
+{
+    // Frames still in flight keep using the old objects, they go once those frames retired
+    // Command buffers are recorded every frame, so those need nothing
+    auto device = m_device;
+    auto oldFramebuffers = frameBuffers;
+    deletions.retire([device, oldFramebuffers]() {
+        for (const auto& framebuffer : oldFramebuffers)
+            if (framebuffer)
+                device.destroyFramebuffer(framebuffer);
+    });
     frameBuffers.clear();
 
-    if (commandBuffers.size())
+    // Only the framebuffers and the recorded viewport depend on the extent,
+    // the render pass and with it the pipeline survive unless the images changed format
+    if (target.format() != m_format or target.finalLayout() != m_finalLayout)
     {
-        m_device.freeCommandBuffers(commandPool, commandBuffers.size(), commandBuffers.data());
-        commandBuffers.clear();
-    } 
-
-    if (pipeline) m_device.destroyPipeline(pipeline);
-    if (pipelineLayout) m_device.destroyPipelineLayout(pipelineLayout);
-    if (renderPass) m_device.destroyRenderPass(renderPass);
+        auto oldPipeline = pipeline;
+        auto oldPipelineLayout = pipelineLayout;
+        auto oldRenderPass = renderPass;
+        deletions.retire([device, oldPipeline, oldPipelineLayout, oldRenderPass]() {
+            if (oldPipeline) device.destroyPipeline(oldPipeline);
+            if (oldPipelineLayout) device.destroyPipelineLayout(oldPipelineLayout);
+            if (oldRenderPass) device.destroyRenderPass(oldRenderPass);
+        });
+
+        createRenderPass(target);
+        createGraphicsPipeline();
+    }
 
-    createRenderPass(present);
-    createGraphicsPipeline(present);
-    createFramebuffers(present);
-    createUniformBuffers(present);
-    createDescriptorPool(present);
-    createDescriptorSets(present);
-    createCommandBuffers(present);
+    createFramebuffers(target);
 
-    m_projection = glm::perspective(glm::radians(45.0f), present.extent().width / static_cast<float>(present.extent().height), 0.1f, 10.0f);
+    m_projection = glm::perspective(glm::radians(45.0f), target.extent().width / static_cast<float>(target.extent().height), 0.1f, 10.0f);
 	m_projection[1][1] *= -1;
 }
 
@@ -163,32 +364,68 @@ void Graphics::await()
 
 void Graphics::reset()
 {
-    commandPool = vk::CommandPool();
     renderPass = vk::RenderPass();
     pipelineLayout = vk::PipelineLayout();
     pipeline = vk::Pipeline();
-    commandBuffers.clear();
     frameBuffers.clear();
     descriptorSetLayout = vk::DescriptorSetLayout(); 
     descriptorPool = vk::DescriptorPool();
-    descriptorSets.clear();
-    deviceVertecies.reset();
-    uniforms.clear();
+    descriptorSet = vk::DescriptorSet();
+    indexBuffer.reset();
+    cullSetLayout = vk::DescriptorSetLayout();
+    cullPipelineLayout = vk::PipelineLayout();
+    cullPipeline = vk::Pipeline();
+    cullSets.clear();
+    visibleBuffers.clear();
+    indirectBuffers.clear();
+    m_recorder.reset();
+    frameConstants.reset();
+    timestamps.reset();
+    m_profiler.reset();
+    m_statistics = vk::QueryPipelineStatisticFlags();
     queue = vk::Queue();
     m_projection = glm::mat4(1.0f);
+    m_time = 0.0;
+    m_rewind = 0.0f;
+    m_format = vk::Format::eUndefined;
+    m_finalLayout = vk::ImageLayout::eUndefined;
+    m_extent = vk::Extent2D();
+    m_style = ParticleStyle::Billboards;
+    m_cull = false;
+    m_chunkSize = 0;
+    m_chunks = 0;
+    m_frames = 0;
+    m_renders = 0;
     m_device = vk::Device();
     m_physicalDevice = vk::PhysicalDevice();
+    m_particles = nullptr;
+    m_pipelineCache = nullptr;
 }
 
 void Graphics::release()
 {
-    for (auto& uniform : uniforms)
+    m_recorder.release();
+    frameConstants.release();
+    indexBuffer.release();
+
+    for (auto& buffer : visibleBuffers)
+    {
+        buffer.release();
+    }
+    visibleBuffers.clear();
+
+    for (auto& buffer : indirectBuffers)
     {
-        uniform.release();
+        buffer.release();
     }
-    uniforms.clear();
+    indirectBuffers.clear();
 
-    deviceVertecies.release();
+    if (cullPipeline) m_device.destroyPipeline(cullPipeline);
+    if (cullPipelineLayout) m_device.destroyPipelineLayout(cullPipelineLayout);
+    if (cullSetLayout) m_device.destroyDescriptorSetLayout(cullSetLayout);
+
+    timestamps.release();
+    m_profiler.release();
     
     if (descriptorPool) m_device.destroyDescriptorPool(descriptorPool);
     if (descriptorSetLayout) m_device.destroyDescriptorSetLayout(descriptorSetLayout);
@@ -199,49 +436,43 @@ void Graphics::release()
     }
     frameBuffers.clear();
 
-    if (commandBuffers.size())
-    {
-        m_device.freeCommandBuffers(commandPool, commandBuffers.size(), commandBuffers.data());
-        commandBuffers.clear();
-    } 
-
     if (pipeline) m_device.destroyPipeline(pipeline);
     if (pipelineLayout) m_device.destroyPipelineLayout(pipelineLayout);
     if (renderPass) m_device.destroyRenderPass(renderPass);
-
-    if (commandPool) m_device.destroyCommandPool(commandPool);
 }
 
-void Graphics::updateData(const uint32_t& imageIndex)
+void Graphics::updateData(const uint32_t frame)
 {
-    static const auto initTime = std::chrono::high_resolution_clock::now();
-
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    float dt = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - initTime).count();
+    const auto dt = static_cast<float>(m_time);
 
+    const glm::vec3 eye(2.0f, 2.0f, 2.0f);
     auto model = glm::rotate(glm::mat4(1.0f), dt * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    auto view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-
-    auto transform = mkTransform(model, view, m_projection);
-
-    void* data = m_device.mapMemory(uniforms[imageIndex].memory(), 0, sizeof(MVPTransform));
-    memcpy(data, &transform, sizeof(transform));
-    m_device.unmapMemory(uniforms[imageIndex].memory());
+    auto view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
+    // written in place, the slice is only read by this frame's previous submission which the fence already covered
+    auto& constants = frameConstants.at<FrameConstants>(frame);
+    constants.transform = mkTransform(model, view, m_projection);
+    constants.camera = glm::vec4(eye, 1.0f);
+    constants.time = dt;
+    constants.dt = config::TIME_STEP;
+    constants.particleCount = m_particles->count();
+    constants.rewind = m_rewind;
+    constants.billboardScale = config::PARTICLE_SIZE * glm::abs(glm::vec2(m_projection[0][0], m_projection[1][1]));
 }
 
 
-void Graphics::createRenderPass(const Present& present)
+void Graphics::createRenderPass(const RenderTarget& target)
 {
     vk::AttachmentDescription color(
         vk::AttachmentDescriptionFlags(),
-        present.format(),
+        target.format(),
         vk::SampleCountFlagBits::e1,
         vk::AttachmentLoadOp::eClear,
         vk::AttachmentStoreOp::eStore,
         vk::AttachmentLoadOp::eDontCare,
         vk::AttachmentStoreOp::eDontCare,
         vk::ImageLayout::eUndefined,
-        vk::ImageLayout::ePresentSrcKHR
+        target.finalLayout()
     );
 
     vk::AttachmentReference colorRef(0, vk::ImageLayout::eColorAttachmentOptimal);
@@ -264,28 +495,16 @@ void Graphics::createRenderPass(const Present& present)
     );
 
     renderPass = m_device.createRenderPass(renderPassInfo);
+    m_format = target.format();
+    m_finalLayout = target.finalLayout();
 }
 
-void Graphics::createGraphicsPipeline(const Present& present)
+void Graphics::createGraphicsPipeline()
 {
-    auto vertShaderCode = readFile("vert.spv");
-    auto fragShaderCode = readFile("frag.spv");
-
-    auto fragShader = m_device.createShaderModuleUnique(
-        vk::ShaderModuleCreateInfo(
-            vk::ShaderModuleCreateFlags(),
-            fragShaderCode.size(), 
-            reinterpret_cast<const uint32_t *>(fragShaderCode.data())
-        )
-    );
-    
-    auto vertShader = m_device.createShaderModuleUnique(
-        vk::ShaderModuleCreateInfo(
-            vk::ShaderModuleCreateFlags(),
-            vertShaderCode.size(), 
-            reinterpret_cast<const uint32_t *>(vertShaderCode.data())
-        )
-    );
+    const auto isBillboards = m_style == ParticleStyle::Billboards;
+
+    auto vertShader = loadShaderModule(m_device, isBillboards ? "billboard.spv" : "vert.spv");
+    auto fragShader = loadShaderModule(m_device, "frag.spv");
 
     vk::PipelineShaderStageCreateInfo vertInfo(
         vk::PipelineShaderStageCreateFlags(), 
@@ -303,7 +522,7 @@ void Graphics::createGraphicsPipeline(const Present& present)
 
     vk::PipelineShaderStageCreateInfo shaderStages[] = {vertInfo, fragInfo};
 
-    auto bindingDesc = Vertex::getBindingDescription();
+    auto bindingDesc = Vertex::getBindingDescription(isBillboards ? vk::VertexInputRate::eInstance : vk::VertexInputRate::eVertex);
     auto attributeDesc = Vertex::getAttributeDescription();
 
     vk::PipelineVertexInputStateCreateInfo vertexInput(
@@ -314,33 +533,26 @@ void Graphics::createGraphicsPipeline(const Present& present)
 
     vk::PipelineInputAssemblyStateCreateInfo inputAssembly(
         vk::PipelineInputAssemblyStateCreateFlags(),
-        vk::PrimitiveTopology::ePointList,
+        isBillboards ? vk::PrimitiveTopology::eTriangleList : vk::PrimitiveTopology::ePointList,
         VK_FALSE
     );
 
-    vk::Viewport viewport(
-        0, 0, 
-        static_cast<float>(present.extent().width), static_cast<float>(present.extent().height),
-        0.0f, 1.0f
-    );
-
-    vk::Rect2D scissor(
-        vk::Offset2D(0, 0), 
-        present.extent()
-    );
-
+    // Viewport and scissor are set per command buffer, so the pipeline outlives resizes
     vk::PipelineViewportStateCreateInfo viewportState(
         vk::PipelineViewportStateCreateFlags(), 
-        1, &viewport, 
-        1, &scissor
+        1, nullptr, 
+        1, nullptr
     );
 
+    const vk::DynamicState dynamicStates[] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+    vk::PipelineDynamicStateCreateInfo dynamicState(vk::PipelineDynamicStateCreateFlags(), 2, dynamicStates);
+
     vk::PipelineRasterizationStateCreateInfo rasterizerState(
         vk::PipelineRasterizationStateCreateFlags(),
         VK_FALSE,
         VK_FALSE,
         vk::PolygonMode::eFill,
-        vk::CullModeFlagBits::eBack,
+        vk::CullModeFlagBits::eNone,     // billboards always face the camera, their winding flips with the projection
         vk::FrontFace::eCounterClockwise,
         VK_FALSE,
         0.0f, 0.0f, 0.0f,
@@ -378,109 +590,239 @@ void Graphics::createGraphicsPipeline(const Present& present)
         &multisamplingState,
         nullptr,
         &colorBlending,
-        nullptr,
+        &dynamicState,
         pipelineLayout,
         renderPass
     );
 
-    pipeline = m_device.createGraphicsPipeline(vk::PipelineCache(), graphicsInfo);
+    pipeline = m_pipelineCache->createGraphicsPipeline(graphicsInfo, "particles");
 }
 
-void Graphics::createFramebuffers(const Present& present)
+void Graphics::createFramebuffers(const RenderTarget& target)
 {
-    frameBuffers.resize(present.imageCount());
+    frameBuffers.resize(target.imageCount());
 
     vk::FramebufferCreateInfo framebufferInfo(
         vk::FramebufferCreateFlags(), 
         renderPass, 
         1, nullptr, 
-        present.extent().width, present.extent().height, 
+        target.extent().width, target.extent().height, 
         1
     );
 
-    for (auto i = 0u; i < present.imageCount(); ++i)
+    for (auto i = 0u; i < target.imageCount(); ++i)
     {
-        framebufferInfo.pAttachments = &present.view(i);
+        framebufferInfo.pAttachments = &target.view(i);
         frameBuffers[i] = m_device.createFramebuffer(framebufferInfo);
     }
+    m_extent = target.extent();
 }
 
-void Graphics::createUniformBuffers(const Present& present)
+void Graphics::createDescriptors()
 {
-    uniforms.resize(present.imageCount());
+    // the draw's set, plus a cull set per frame in flight and particle buffer
+    const auto cullSetCount = m_cull ? m_frames * m_particles->bufferCount() : 0;
+
+    const vk::DescriptorPoolSize poolSizes[] = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, 1 + cullSetCount),
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 3 * cullSetCount)
+    };
+    vk::DescriptorPoolCreateInfo poolInfo(vk::DescriptorPoolCreateFlags(), 1 + cullSetCount, cullSetCount ? 2 : 1, poolSizes);
+
+    descriptorPool = m_device.createDescriptorPool(poolInfo);
+
+    vk::DescriptorSetAllocateInfo allocInfo(descriptorPool, 1, &descriptorSetLayout);
+    descriptorSet = m_device.allocateDescriptorSets(allocInfo)[0];
+
+    vk::DescriptorBufferInfo bufferInfo(frameConstants.buffer(), 0, frameConstants.range());
+    vk::WriteDescriptorSet descriptorWrite(descriptorSet, 0, 0, 1, vk::DescriptorType::eUniformBufferDynamic, nullptr, &bufferInfo);
 
-    auto bufferSize = sizeof(MVPTransform);
-    for (auto i = 0; i < uniforms.size(); ++i)
+    m_device.updateDescriptorSets({descriptorWrite}, {});
+
+    if (!cullSetCount)
     {
-        uniforms[i] = BoundedBuffer(
-            m_physicalDevice, m_device, 
-            bufferSize, vk::BufferUsageFlagBits::eUniformBuffer, 
-            vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible
-        );
+        return;
     }
-}
 
-void Graphics::createDescriptorPool(const Present& present)
-{
-    vk::DescriptorPoolSize poolSize(vk::DescriptorType::eUniformBuffer, present.imageCount());
-    vk::DescriptorPoolCreateInfo poolInfo(vk::DescriptorPoolCreateFlags(), present.imageCount(), 1, &poolSize);
+    const std::vector<vk::DescriptorSetLayout> layouts(cullSetCount, cullSetLayout);
+    cullSets = m_device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool, layouts.size(), layouts.data()));
 
-    descriptorPool = m_device.createDescriptorPool(poolInfo);
+    for (auto frame = 0u; frame < m_frames; ++frame)
+    {
+        for (auto j = 0u; j < m_particles->bufferCount(); ++j)
+        {
+            const auto& set = cullSets[frame * m_particles->bufferCount() + j];
+
+            vk::DescriptorBufferInfo particlesInfo(m_particles->buffer(j), 0, VK_WHOLE_SIZE);
+            vk::DescriptorBufferInfo visibleInfo(visibleBuffers[frame].buffer(), 0, VK_WHOLE_SIZE);
+            vk::DescriptorBufferInfo indirectInfo(indirectBuffers[frame].buffer(), 0, VK_WHOLE_SIZE);
+
+            m_device.updateDescriptorSets({
+                vk::WriteDescriptorSet(set, 0, 0, 1, vk::DescriptorType::eUniformBufferDynamic, nullptr, &bufferInfo),
+                vk::WriteDescriptorSet(set, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &particlesInfo),
+                vk::WriteDescriptorSet(set, 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &visibleInfo),
+                vk::WriteDescriptorSet(set, 3, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &indirectInfo)
+            }, {});
+        }
+    }
 }
 
-void Graphics::createDescriptorSets(const Present& present)
+void Graphics::createCulling()
 {
-    const std::vector<vk::DescriptorSetLayout> layouts(present.imageCount(), descriptorSetLayout);
-    vk::DescriptorSetAllocateInfo allocInfo(descriptorPool, layouts.size(), layouts.data());
-    descriptorSets = m_device.allocateDescriptorSets(allocInfo);
+    const auto visibleSize = sizeof(Vertex) * std::max(1u, m_particles->count());
 
-    vk::DescriptorBufferInfo bufferInfo(vk::Buffer(), 0, sizeof(MVPTransform));
-    vk::WriteDescriptorSet descriptorWrite(vk::DescriptorSet(), 0, 0, 1, vk::DescriptorType::eUniformBuffer, nullptr, &bufferInfo);
-    for (auto i = 0u; i < present.imageCount(); ++i)
+    for (auto frame = 0u; frame < m_frames; ++frame)
     {
-        bufferInfo.setBuffer(uniforms[i].buffer());
-        descriptorWrite.setDstSet(descriptorSets[i]);
-
-        m_device.updateDescriptorSets({descriptorWrite}, {});
+        visibleBuffers.emplace_back(
+            m_physicalDevice, m_device, 
+            visibleSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer, 
+            vk::MemoryPropertyFlagBits::eDeviceLocal
+        );
+        indirectBuffers.emplace_back(
+            m_physicalDevice, m_device, 
+            m_chunks * sizeof(vk::DrawIndexedIndirectCommand), 
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst, 
+            vk::MemoryPropertyFlagBits::eDeviceLocal
+        );
     }
+
+    const vk::DescriptorSetLayoutBinding bindings[] = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBufferDynamic, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute)
+    };
+    cullSetLayout = m_device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo(vk::DescriptorSetLayoutCreateFlags(), 4, bindings));
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo;
+    pipelineLayoutInfo.setSetLayoutCount(1);
+    pipelineLayoutInfo.setPSetLayouts(&cullSetLayout);
+    cullPipelineLayout = m_device.createPipelineLayout(pipelineLayoutInfo);
+
+    // workgroup size, which word of an indirect command is the count, and the particles per draw
+    struct
+    {
+        uint32_t workgroupSize = config::COMPUTE_WORKGROUP_SIZE;
+        uint32_t countWord;
+        uint32_t chunkSize;
+    } constants;
+    constants.countWord = m_style == ParticleStyle::Billboards ? 1 : 0;
+    constants.chunkSize = m_chunkSize;
+
+    const vk::SpecializationMapEntry entries[] = {
+        vk::SpecializationMapEntry(0, offsetof(decltype(constants), workgroupSize), sizeof(uint32_t)),
+        vk::SpecializationMapEntry(1, offsetof(decltype(constants), countWord), sizeof(uint32_t)),
+        vk::SpecializationMapEntry(2, offsetof(decltype(constants), chunkSize), sizeof(uint32_t))
+    };
+    const vk::SpecializationInfo specialization(3, entries, sizeof(constants), &constants);
+
+    auto shader = loadShaderModule(m_device, "cull.spv");
+    vk::ComputePipelineCreateInfo pipelineInfo(
+        vk::PipelineCreateFlags(),
+        vk::PipelineShaderStageCreateInfo(
+            vk::PipelineShaderStageCreateFlags(), 
+            vk::ShaderStageFlagBits::eCompute, 
+            shader.get(), 
+            "main",
+            &specialization
+        ),
+        cullPipelineLayout
+    );
+    cullPipeline = m_pipelineCache->createComputePipeline(pipelineInfo, "frustum cull");
 }
 
-void Graphics::createCommandBuffers(const Present& present)
+void Graphics::recordCull(const vk::CommandBuffer& commandBuffer, const uint32_t frame, const uint32_t particleBuffer, const uint32_t dynamicOffset) const
 {
-    vk::CommandBufferAllocateInfo commandBufferAllocInfo(
-        commandPool, 
-        vk::CommandBufferLevel::ePrimary, 
-        static_cast<uint32_t>(present.imageCount())
+    const auto& indirect = indirectBuffers[frame].buffer();
+    const auto groups = (m_particles->count() + config::COMPUTE_WORKGROUP_SIZE - 1) / config::COMPUTE_WORKGROUP_SIZE;
+
+    // One command per chunk, 5 words apart, the count starts at 0 - vertexCount of a VkDrawIndirectCommand for points,
+    // instanceCount of 6 indices for billboards. The survivors of a chunk are compacted to the start of its range
+    std::vector<uint32_t> initial(5 * m_chunks, 0);
+    for (auto chunk = 0u; chunk < m_chunks; ++chunk)
+    {
+        auto* command = &initial[5 * chunk];
+        if (m_style == ParticleStyle::Billboards)
+        {
+            command[0] = static_cast<uint32_t>(g_indices.size());
+            command[4] = chunk * m_chunkSize;   // firstInstance
+        }
+        else
+        {
+            command[1] = 1;
+            command[2] = chunk * m_chunkSize;   // firstVertex
+        }
+    }
+
+    m_profiler.begin(commandBuffer, frame, 0);
+    commandBuffer.updateBuffer(indirect, 0, initial.size() * sizeof(uint32_t), initial.data());
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+        vk::DependencyFlags(), {}, 
+        { vk::BufferMemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, indirect, 0, VK_WHOLE_SIZE) }, 
+        {}
     );
 
-    commandBuffers = m_device.allocateCommandBuffers(commandBufferAllocInfo);
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullPipelineLayout, 0, 1, &cullSets[frame * m_particles->bufferCount() + particleBuffer], 1, &dynamicOffset);
+    commandBuffer.dispatch(groups, 1, 1);
+
+    // The draw reads the count as its indirect command and the survivors as vertex input
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput,
+        vk::DependencyFlags(), {}, 
+        { 
+            vk::BufferMemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, indirect, 0, VK_WHOLE_SIZE),
+            vk::BufferMemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eVertexAttributeRead, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, visibleBuffers[frame].buffer(), 0, VK_WHOLE_SIZE)
+        }, 
+        {}
+    );
+    m_profiler.end(commandBuffer, frame, 0);
+}
 
-    vk::CommandBufferBeginInfo commandBufferBegin{};
+void Graphics::recordDraw(const vk::CommandBuffer& commandBuffer, const uint32_t frame, const uint32_t particleBuffer, const uint32_t chunk, const uint32_t dynamicOffset) const
+{
+    // Nothing is inherited from the primary, every secondary sets up its own state
+    const vk::DeviceSize vertexOffsets[] = { 0 };
+    const auto first = chunk * m_chunkSize;
+    const auto count = std::min(m_particles->count(), first + m_chunkSize) - first;
+    const auto indirectOffset = chunk * sizeof(vk::DrawIndexedIndirectCommand);
 
-    vk::Buffer vertexBuffers[] = { deviceVertecies.buffer() };
-    vk::DeviceSize vertexOffsets[] = { 0 };
+    const vk::Viewport viewport(
+        0, 0, 
+        static_cast<float>(m_extent.width), static_cast<float>(m_extent.height),
+        0.0f, 1.0f
+    );
 
-    vk::RenderPassBeginInfo renderPassBegin;
-    renderPassBegin.renderPass = renderPass;
-    renderPassBegin.renderArea.offset = vk::Offset2D(0, 0);
-    renderPassBegin.renderArea.extent = present.extent();
-    vk::ClearValue clearColor(vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}));
-    renderPassBegin.clearValueCount = 1;
-    renderPassBegin.pClearValues = &clearColor;
+    const vk::Rect2D scissor(
+        vk::Offset2D(0, 0), 
+        m_extent
+    );
 
-    for (auto i = 0u; i < present.imageCount(); ++i)
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    commandBuffer.setViewport(0, { viewport });
+    commandBuffer.setScissor(0, { scissor });
+    commandBuffer.bindVertexBuffers(0, 1, m_cull ? &visibleBuffers[frame].buffer() : &m_particles->buffer(particleBuffer), vertexOffsets);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &descriptorSet, 1, &dynamicOffset);
+    if (m_style == ParticleStyle::Billboards)
+    {
+        commandBuffer.bindIndexBuffer(indexBuffer.buffer(), 0, vk::IndexType::eUint16);
+        if (m_cull)
+        {
+            commandBuffer.drawIndexedIndirect(indirectBuffers[frame].buffer(), indirectOffset, 1, sizeof(vk::DrawIndexedIndirectCommand));
+        }
+        else
+        {
+            commandBuffer.drawIndexed(static_cast<uint32_t>(g_indices.size()), count, 0, 0, first);
+        }
+    }
+    else if (m_cull)
     {
-        renderPassBegin.framebuffer = frameBuffers[i];
-
-        commandBuffers[i].begin(commandBufferBegin);
-            commandBuffers[i].beginRenderPass(renderPassBegin, vk::SubpassContents::eInline);
-            commandBuffers[i].bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
-            commandBuffers[i].bindVertexBuffers(0, 1, vertexBuffers, vertexOffsets);
-            commandBuffers[i].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, {descriptorSets[i]}, {});
-            commandBuffers[i].draw(3, 1, 0, 0);
-            commandBuffers[i].endRenderPass();
-        commandBuffers[i].end();
+        // the same 5 word stride as the indexed commands, the last word is unused
+        commandBuffer.drawIndirect(indirectBuffers[frame].buffer(), indirectOffset, 1, sizeof(vk::DrawIndexedIndirectCommand));
+    }
+    else
+    {
+        commandBuffer.draw(count, 1, first, 0);
     }
 }
-
-
@@ -1,7 +1,7 @@
 #pragma once
 
-#include <chrono>
 #include <ostream>
+#include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -9,29 +9,30 @@
 #include <vulkan/vulkan.hpp>
 
 #include "BoundedBuffer.h"
+#include "CommandRecorder.h"
+#include "DeletionQueue.h"
+#include "FrameConstants.h"
 #include "general.h"
+#include "GpuProfiler.h"
 #include "MVPTransform.h"
-#include "Present.h"
-
-struct Vertex
+#include "ParticleSource.h"
+#include "PipelineCache.h"
+#include "QueueTimer.h"
+#include "RenderTarget.h"
+#include "UniformRing.h"
+#include "Vertex.h"
+#include "../config.h"
+
+// How particles are drawn - one point each, or one instanced quad each that faces the camera and shrinks with distance
+enum class ParticleStyle
 {
-	glm::vec2 pos;
-	glm::vec3 color;
-
-	static vk::VertexInputBindingDescription getBindingDescription()
-	{
-		return vk::VertexInputBindingDescription(0, sizeof(Vertex));
-	}
-
-	static std::array<vk::VertexInputAttributeDescription, 2> getAttributeDescription()
-	{
-		return {
-			vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, pos)),
-			vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, color))
-		};
-	}
+    Points,
+    Billboards
 };
 
+const char* toString(const ParticleStyle style);
+
+ParticleStyle parseParticleStyle(const std::string& name);
 
 class Graphics
 {
@@ -39,9 +40,15 @@ public:
 
     Graphics(
         const vk::Device& dev,
-        const Present& present,
+        const RenderTarget& target,
         const uint32_t graphicsFamilyIndex,
-        const vk::PhysicalDevice& physicalDevice
+        const vk::PhysicalDevice& physicalDevice,
+        const ParticleSource& particles,
+        const PipelineCache& pipelineCache,
+        const ParticleStyle style = ParticleStyle::Billboards,
+        const bool cull = true,
+        const uint32_t recordThreads = config::RECORD_THREADS,
+        const uint32_t framesInFlight = config::FRAMES_IN_FLIGHT
     );
 
     Graphics();
@@ -56,68 +63,99 @@ public:
 
     Graphics& operator=(Graphics&& other);
 
-    void render(const vk::Semaphore& wait, const vk::Semaphore& signal, const vk::Fence& hostNotify, const uint32_t& imageIndex);
+    // Draws particle buffer `particleBuffer` of the ParticleSource into image `imageIndex`,
+    // with the constants of frame in flight `frame` < framesInFlight (guarded by `hostNotify`)
+    void render(
+        const vk::Semaphore& wait, const vk::Semaphore& signal, const vk::Fence& hostNotify, 
+        const uint32_t& imageIndex, const uint32_t frame, const uint32_t particleBuffer
+    );
 
-    void update(const Present& present);
+    // Same as above with extra dependencies, e.g. on the compute queue producing the particles
+    void render(
+        vk::ArrayProxy<const vk::Semaphore> waits, vk::ArrayProxy<const vk::PipelineStageFlags> waitStages,
+        vk::ArrayProxy<const vk::Semaphore> signals, 
+        const vk::Fence& hostNotify, const uint32_t& imageIndex, const uint32_t frame, const uint32_t particleBuffer
+    );
 
-    void await();
+    // Clock of the frames rendered from now on - `seconds` drives the animation, `rewind` moves each particle along its velocity
+    // to interpolate between simulation steps when the source cannot (see FrameConstants). Both stay 0 unless set
+    void setTime(const double seconds, const float rewind);
 
-    void reset();
+    // Records the frame render() submits into the primary command buffer of `frame`, whose fence must have been waited on.
+    // The cull pass and one draw per particle chunk are recorded as secondaries in parallel
+    vk::CommandBuffer record(const uint32_t imageIndex, const uint32_t frame, const uint32_t particleBuffer);
 
-    void release();
+    // Number of render() calls so far, the timestamps of call `n` are timer().read(n, ...)
+    uint64_t renders() const;
 
-private:
-	void updateData(const uint32_t& imageIndex);
+    const QueueTimer& timer() const;
+
+    // "cull" (when culling) and "draw" scopes, one query set per frame in flight
+    const GpuProfiler& profiler() const;
 
-    template <class Container>
-    BoundedBuffer createStagedBuffer(const vk::PhysicalDevice& physicalDevice, const Container& hostData, const vk::BufferUsageFlags& usage, const vk::MemoryPropertyFlags& properties)
-    {
-        auto size = sizeof(hostData[0]) * hostData.size();
+    // Rebuilds what depends on the target after it was recreated, e.g. on resize.
+    // Replaced objects are handed to `deletions` instead of waiting for the GPU to go idle
+    void update(const RenderTarget& target, DeletionQueue& deletions);
 
-        auto stagingBuffer = BoundedBuffer(
-            physicalDevice, m_device, 
-            hostData, vk::BufferUsageFlagBits::eTransferSrc, 
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-        );
+    void await();
 
-        auto ret = BoundedBuffer(
-            physicalDevice, m_device,
-            size, usage | vk::BufferUsageFlagBits::eTransferDst,
-            properties 
-        );
+    void reset();
 
-        copyBuffer(m_device, queue, commandPool, stagingBuffer.buffer(), ret.buffer(), size);
+    void release();
 
-        return ret;
-    }
+private:
+	void updateData(const uint32_t frame);
 
-	void createRenderPass(const Present& present);
+	void createRenderPass(const RenderTarget& target);
 
-    void createGraphicsPipeline(const Present& present);
+    void createGraphicsPipeline();
 
-    void createFramebuffers(const Present& present);
+    void createFramebuffers(const RenderTarget& target);
 
-    void createUniformBuffers(const Present& present);
+    void createDescriptors();
 
-    void createDescriptorPool(const Present& present);
+    // Frustum culling pre-pass, see cull.comp
+    void createCulling();
 
-    void createDescriptorSets(const Present& present);
+    void recordCull(const vk::CommandBuffer& commandBuffer, const uint32_t frame, const uint32_t particleBuffer, const uint32_t dynamicOffset) const;
 
-    void createCommandBuffers(const Present& present);
+    // Particles [chunk * m_chunkSize, (chunk + 1) * m_chunkSize), or what the cull pass kept of them
+    void recordDraw(const vk::CommandBuffer& commandBuffer, const uint32_t frame, const uint32_t particleBuffer, const uint32_t chunk, const uint32_t dynamicOffset) const;
     
-    vk::CommandPool 				commandPool;
     vk::RenderPass 					renderPass;
     vk::PipelineLayout 				pipelineLayout;
     vk::Pipeline 					pipeline;
-    std::vector<vk::CommandBuffer>	commandBuffers;
     std::vector<vk::Framebuffer>	frameBuffers;
     vk::DescriptorSetLayout			descriptorSetLayout;
     vk::DescriptorPool				descriptorPool;
-    std::vector<vk::DescriptorSet> 	descriptorSets;
-    BoundedBuffer					deviceVertecies;
-    std::vector<BoundedBuffer>		uniforms;
+    vk::DescriptorSet 	            descriptorSet;
+    BoundedBuffer                   indexBuffer;        // g_indices, the corners of one billboard
+    vk::DescriptorSetLayout         cullSetLayout;
+    vk::PipelineLayout              cullPipelineLayout;
+    vk::Pipeline                    cullPipeline;
+    std::vector<vk::DescriptorSet>  cullSets;           // indexed frame * bufferCount + particle buffer
+    std::vector<BoundedBuffer>      visibleBuffers;     // per frame in flight, the particles that survived culling
+    std::vector<BoundedBuffer>      indirectBuffers;    // per frame in flight, one draw per chunk the cull pass counts into
+    CommandRecorder                 m_recorder;
+    UniformRing		                frameConstants;
+    QueueTimer                      timestamps;
+    GpuProfiler                     m_profiler;
+    vk::QueryPipelineStatisticFlags m_statistics;       // what m_profiler collects, secondaries inherit them
     vk::Queue 						queue;
     glm::mat4                       m_projection;
+    double                          m_time;
+    float                           m_rewind;
+    vk::Format                      m_format;           // what renderPass was built for
+    vk::ImageLayout                 m_finalLayout;
+    vk::Extent2D                    m_extent;           // what frameBuffers were built for
+    ParticleStyle                   m_style;
+    bool                            m_cull;
+    uint32_t                        m_chunkSize;        // particles per draw, a multiple of the cull workgroup size
+    uint32_t                        m_chunks;
+    uint32_t                        m_frames;           // in flight
+    uint64_t                        m_renders;
     vk::Device                      m_device;
     vk::PhysicalDevice              m_physicalDevice;
+    const ParticleSource*           m_particles;
+    const PipelineCache*            m_pipelineCache;
 };
@@ -0,0 +1,109 @@
+#include "HostParticles.h"
+
+#include "Vertex.h"
+
+HostParticles::HostParticles(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, const Particles& particles, const uint32_t bufferCount)
+    : m_device(dev), m_particles(&particles)
+{
+    snapshot();
+
+    m_buffers.resize(bufferCount);
+
+    auto bufferSize = sizeof(Vertex) * particles.size();
+    for (auto& buffer : m_buffers)
+    {
+        buffer = BoundedBuffer(
+            physicalDevice, dev, 
+            bufferSize, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer, 
+            vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible
+        );
+    }
+}
+
+HostParticles::HostParticles()
+    : m_particles(nullptr)
+{
+}
+
+HostParticles::HostParticles(HostParticles&& other)
+{
+    m_buffers = std::move(other.m_buffers);
+    m_previous = std::move(other.m_previous);
+    m_device = other.m_device;
+    m_particles = other.m_particles;
+
+    other.reset();
+}
+
+HostParticles::~HostParticles()
+{
+    release();
+    reset();
+}
+
+HostParticles& HostParticles::operator=(HostParticles&& other)
+{
+    release();
+
+    m_buffers = std::move(other.m_buffers);
+    m_previous = std::move(other.m_previous);
+    m_device = other.m_device;
+    m_particles = other.m_particles;
+
+    other.reset();
+
+    return *this;
+}
+
+uint32_t HostParticles::count() const
+{
+    return static_cast<uint32_t>(m_particles->size());
+}
+
+uint32_t HostParticles::bufferCount() const
+{
+    return static_cast<uint32_t>(m_buffers.size());
+}
+
+const vk::Buffer& HostParticles::buffer(const uint32_t index) const
+{
+    return m_buffers[index].buffer();
+}
+
+void HostParticles::upload(const uint32_t index)
+{
+    writeVertecies(*m_particles, static_cast<Vertex*>(m_buffers[index].data()));
+}
+
+void HostParticles::upload(const uint32_t index, const float alpha)
+{
+    writeVertecies(*m_particles, m_previous, alpha, static_cast<Vertex*>(m_buffers[index].data()));
+}
+
+void HostParticles::snapshot()
+{
+    const auto& particles = *m_particles;
+
+    m_previous.resize(particles.size());
+    for (auto i = 0u; i < particles.size(); ++i)
+    {
+        m_previous[i] = glm::vec3(particles.x[i], particles.y[i], particles.z[i]);
+    }
+}
+
+void HostParticles::reset()
+{
+    m_buffers.clear();
+    m_previous.clear();
+    m_device = vk::Device();
+    m_particles = nullptr;
+}
+
+void HostParticles::release()
+{
+    for (auto& buffer : m_buffers)
+    {
+        buffer.release();
+    }
+    m_buffers.clear();
+}
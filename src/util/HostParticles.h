@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "BoundedBuffer.h"
+#include "ParticleSource.h"
+#include "../nbody/Particles.h"
+
+// Uploads the state of a CPU engine into one host visible vertex buffer per frame in flight,
+// optionally blended with the positions snapshot() kept from before the latest step
+class HostParticles : public ParticleSource
+{
+public:
+    HostParticles(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, const Particles& particles, const uint32_t bufferCount);
+
+    HostParticles();
+
+    HostParticles(const HostParticles& other) = delete;
+
+    HostParticles(HostParticles&& other);
+
+    ~HostParticles();
+
+    HostParticles& operator=(const HostParticles& other) = delete;
+
+    HostParticles& operator=(HostParticles&& other);
+
+    uint32_t count() const override;
+
+    uint32_t bufferCount() const override;
+
+    const vk::Buffer& buffer(const uint32_t index) const override;
+
+    // The frame fence guarding buffer `index` must have been waited on
+    void upload(const uint32_t index);
+
+    // Same, positions `alpha` of the way from the snapshot to the current state
+    void upload(const uint32_t index, const float alpha);
+
+    // Keeps the current positions, call right before the engine's last step of a frame
+    void snapshot();
+
+    void reset();
+
+    void release();
+
+private:
+    std::vector<BoundedBuffer>  m_buffers;
+    std::vector<glm::vec3>      m_previous;
+    vk::Device                  m_device;
+    const Particles*            m_particles;
+};
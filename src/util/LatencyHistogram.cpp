@@ -0,0 +1,91 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+{
+    clear();
+}
+
+void LatencyHistogram::record(const uint64_t nanoseconds)
+{
+    ++m_counts[bucket(nanoseconds)];
+    ++m_count;
+    m_max = std::max(m_max, nanoseconds);
+    m_sum += nanoseconds;
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+uint64_t LatencyHistogram::quantile(const double fraction) const
+{
+    if (!m_count)
+    {
+        return 0;
+    }
+
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * m_count)));
+
+    uint64_t seen = 0;
+    for (auto i = 0u; i < BUCKETS; ++i)
+    {
+        seen += m_counts[i];
+        if (seen >= rank)
+        {
+            // the top bucket is known exactly
+            return std::min(value(i), m_max);
+        }
+    }
+
+    return m_max;
+}
+
+uint64_t LatencyHistogram::max() const
+{
+    return m_max;
+}
+
+double LatencyHistogram::mean() const
+{
+    return m_count ? m_sum / m_count : 0.0;
+}
+
+void LatencyHistogram::clear()
+{
+    m_counts.fill(0);
+    m_count = 0;
+    m_max = 0;
+    m_sum = 0.0;
+}
+
+uint32_t LatencyHistogram::bucket(const uint64_t value)
+{
+    // below 2 * SUB_BUCKETS every value has its own bucket
+    if (value < 2 * SUB_BUCKETS)
+    {
+        return static_cast<uint32_t>(value);
+    }
+
+    auto msb = 63u - static_cast<uint32_t>(__builtin_clzll(value));
+    auto shift = msb - SUB_BUCKET_BITS;
+    auto sub = static_cast<uint32_t>(value >> shift);    // in [SUB_BUCKETS, 2 * SUB_BUCKETS)
+
+    return 2 * SUB_BUCKETS + (shift - 1) * SUB_BUCKETS + (sub - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::value(const uint32_t index)
+{
+    if (index < 2 * SUB_BUCKETS)
+    {
+        return index;
+    }
+
+    auto shift = (index - 2 * SUB_BUCKETS) / SUB_BUCKETS + 1;
+    uint64_t sub = (index - 2 * SUB_BUCKETS) % SUB_BUCKETS + SUB_BUCKETS;
+
+    return (sub << shift) + (uint64_t(1) << shift) / 2;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Log-linear (HDR style) histogram of durations in nanoseconds.
+// Every power of two range is split into 64 linear buckets, so any quantile is within ~1.6% of the exact value
+// at a fixed 30KiB and O(1) record(), whatever the number of samples
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(const uint64_t nanoseconds);
+
+    uint64_t count() const;
+
+    // `fraction` in [0, 1], 0 for an empty histogram
+    uint64_t quantile(const double fraction) const;
+
+    uint64_t max() const;
+
+    double mean() const;
+
+    void clear();
+
+private:
+    static constexpr uint32_t SUB_BUCKET_BITS = 6;
+    static constexpr uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr uint32_t BUCKETS = 2 * SUB_BUCKETS + (64 - SUB_BUCKET_BITS - 1) * SUB_BUCKETS;
+
+    static uint32_t bucket(const uint64_t value);
+
+    // Midpoint of the values falling into `index`
+    static uint64_t value(const uint32_t index);
+
+    std::array<uint64_t, BUCKETS>   m_counts;
+    uint64_t                        m_count;
+    uint64_t                        m_max;
+    double                          m_sum;
+};
@@ -0,0 +1,231 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+
+#include "BoundedBuffer.h"
+#include "../config.h"
+
+namespace
+{
+
+vk::DeviceSize alignUp(const vk::DeviceSize value, const vk::DeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+MemoryAllocator& MemoryAllocator::get(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev)
+{
+    static std::mutex registryMutex;
+    static std::map<VkDevice, std::unique_ptr<MemoryAllocator>> registry;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    // A handle can be reused by a later device, the old allocator is empty by then
+    auto& allocator = registry[static_cast<VkDevice>(dev)];
+    if (!allocator or allocator->m_physicalDevice != physicalDevice)
+    {
+        allocator = std::make_unique<MemoryAllocator>(physicalDevice, dev);
+    }
+
+    return *allocator;
+}
+
+MemoryAllocator::MemoryAllocator(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev)
+    :   m_properties(physicalDevice.getMemoryProperties()),
+        m_physicalDevice(physicalDevice), 
+        m_device(dev)
+{
+    m_pools.resize(2 * m_properties.memoryTypeCount);
+    for (auto i = 0u; i < m_pools.size(); ++i)
+    {
+        m_pools[i].memoryType = i / 2;
+        m_pools[i].isLinear = i % 2 == 0;
+    }
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    for (auto& pool : m_pools)
+        for (auto& block : pool.blocks)
+            if (block.memory)
+                m_device.freeMemory(block.memory);
+}
+
+MemoryAllocation MemoryAllocator::allocate(const vk::MemoryRequirements& requirements, const vk::MemoryPropertyFlags& properties, const bool isLinear)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto memoryType = findMemoryType(m_properties, requirements.memoryTypeBits, properties);
+    auto poolIndex = 2 * memoryType + (isLinear ? 0 : 1);
+    auto& pool = m_pools[poolIndex];
+
+    MemoryAllocation ret;
+    ret.pool = poolIndex;
+
+    auto found = false;
+    for (auto i = 0u; i < pool.blocks.size() and !found; ++i)
+    {
+        found = pool.blocks[i].memory and allocateFrom(pool, i, requirements, ret);
+    }
+
+    if (!found)
+    {
+        // Anything bigger than half a block gets a block of its own
+        auto size = blockSize(memoryType);
+        if (requirements.size > size / 2)
+        {
+            size = requirements.size;
+        }
+
+        auto blockIndex = createBlock(pool, size);
+        if (!allocateFrom(pool, blockIndex, requirements, ret))
+        {
+            throw std::runtime_error("could not sub-allocate from a fresh memory block");
+        }
+    }
+
+    pool.used += ret.size;
+    pool.peakUsed = std::max(pool.peakUsed, pool.used);
+    ++pool.allocations;
+
+    return ret;
+}
+
+void MemoryAllocator::free(const MemoryAllocation& allocation)
+{
+    if (!allocation.memory)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto& pool = m_pools[allocation.pool];
+    auto& block = pool.blocks[allocation.block];
+
+    auto begin = allocation.offset;
+    auto end = allocation.offset + allocation.size;
+
+    // Merge with the free neighbours on either side
+    auto next = block.freeRanges.lower_bound(begin);
+    if (next != block.freeRanges.end() and next->first == end)
+    {
+        end += next->second;
+        next = block.freeRanges.erase(next);
+    }
+    if (next != block.freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == begin)
+        {
+            begin = previous->first;
+            block.freeRanges.erase(previous);
+        }
+    }
+    block.freeRanges[begin] = end - begin;
+
+    pool.used -= allocation.size;
+    --pool.allocations;
+
+    if (!--block.allocations)
+    {
+        m_device.freeMemory(block.memory);
+        pool.reserved -= block.size;
+        block = Block();
+    }
+}
+
+void MemoryAllocator::report(std::ostream& os) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const auto& pool : m_pools)
+    {
+        if (!pool.blockAllocations)
+        {
+            continue;
+        }
+
+        auto blocks = std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const Block& block) { return static_cast<bool>(block.memory); });
+
+        os  << "Memory type " << pool.memoryType << (pool.isLinear ? " (linear)" : " (optimal)") << ": "
+            << pool.allocations << " allocations in " << blocks << " blocks, "
+            << pool.used / 1024 << "KiB used of " << pool.reserved / 1024 << "KiB, "
+            << "peak " << pool.peakUsed / 1024 << "KiB, "
+            << pool.blockAllocations << " vkAllocateMemory calls\n";
+    }
+}
+
+bool MemoryAllocator::allocateFrom(Pool& pool, const uint32_t blockIndex, const vk::MemoryRequirements& requirements, MemoryAllocation& out)
+{
+    auto& block = pool.blocks[blockIndex];
+
+    for (auto range = block.freeRanges.begin(); range != block.freeRanges.end(); ++range)
+    {
+        auto rangeEnd = range->first + range->second;
+        auto offset = alignUp(range->first, requirements.alignment);
+        if (offset + requirements.size > rangeEnd)
+        {
+            continue;
+        }
+
+        // Split off the alignment padding in front and the remainder behind
+        auto rangeBegin = range->first;
+        block.freeRanges.erase(range);
+        if (offset > rangeBegin)
+        {
+            block.freeRanges[rangeBegin] = offset - rangeBegin;
+        }
+        if (offset + requirements.size < rangeEnd)
+        {
+            block.freeRanges[offset + requirements.size] = rangeEnd - offset - requirements.size;
+        }
+
+        ++block.allocations;
+
+        out.memory = block.memory;
+        out.offset = offset;
+        out.size = requirements.size;
+        out.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+        out.block = blockIndex;
+        return true;
+    }
+
+    return false;
+}
+
+uint32_t MemoryAllocator::createBlock(Pool& pool, const vk::DeviceSize size)
+{
+    Block block;
+    block.size = size;
+    block.memory = m_device.allocateMemory(vk::MemoryAllocateInfo(size, pool.memoryType));
+    block.freeRanges[0] = size;
+
+    if (m_properties.memoryTypes[pool.memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+    {
+        block.mapped = m_device.mapMemory(block.memory, 0, VK_WHOLE_SIZE);
+    }
+
+    pool.reserved += size;
+    ++pool.blockAllocations;
+
+    // Reuse a released slot before growing
+    auto slot = std::find_if(pool.blocks.begin(), pool.blocks.end(), [](const Block& candidate) { return !candidate.memory; });
+    if (slot != pool.blocks.end())
+    {
+        *slot = std::move(block);
+        return static_cast<uint32_t>(slot - pool.blocks.begin());
+    }
+
+    pool.blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(pool.blocks.size() - 1);
+}
+
+vk::DeviceSize MemoryAllocator::blockSize(const uint32_t memoryType) const
+{
+    // Small heaps (e.g. the 256MiB host visible device local one) get proportionally smaller blocks
+    auto heapSize = m_properties.memoryHeaps[m_properties.memoryTypes[memoryType].heapIndex].size;
+    return std::min(config::MEMORY_BLOCK_SIZE, heapSize / 8);
+}
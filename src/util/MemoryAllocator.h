@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+// A range of a shared vk::DeviceMemory block handed out by MemoryAllocator
+struct MemoryAllocation
+{
+    vk::DeviceMemory    memory;
+    vk::DeviceSize      offset = 0;
+    vk::DeviceSize      size = 0;
+    void*               mapped = nullptr;   // host visible memory stays mapped for the block's whole life
+    uint32_t            pool = 0;
+    uint32_t            block = 0;
+};
+
+// Sub-allocates buffers and images out of large vk::DeviceMemory blocks, one pool per memory type.
+// Each block keeps a first fit free list of [offset, size) ranges that is coalesced on free.
+// Linear (buffers) and optimal (images) resources live in separate pools, so bufferImageGranularity never has to be padded for.
+// Blocks are given back to the driver as soon as they are empty, which is what lets the per device instance outlive the vk::Device
+class MemoryAllocator
+{
+public:
+    // Shared allocator of `dev`, created on first use
+    static MemoryAllocator& get(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev);
+
+    MemoryAllocator(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev);
+
+    MemoryAllocator(const MemoryAllocator& other) = delete;
+
+    ~MemoryAllocator();
+
+    MemoryAllocator& operator=(const MemoryAllocator& other) = delete;
+
+    MemoryAllocation allocate(const vk::MemoryRequirements& requirements, const vk::MemoryPropertyFlags& properties, const bool isLinear);
+
+    void free(const MemoryAllocation& allocation);
+
+    // Per pool usage, one line each
+    void report(std::ostream& os) const;
+
+private:
+    struct Block
+    {
+        vk::DeviceMemory                            memory;
+        vk::DeviceSize                              size = 0;
+        void*                                       mapped = nullptr;
+        std::map<vk::DeviceSize, vk::DeviceSize>    freeRanges;     // offset -> size
+        uint32_t                                    allocations = 0;
+    };
+
+    struct Pool
+    {
+        uint32_t            memoryType = 0;
+        bool                isLinear = true;
+        std::vector<Block>  blocks;     // released blocks stay as empty slots so block indices remain valid
+
+        // usage stats
+        vk::DeviceSize      reserved = 0;
+        vk::DeviceSize      used = 0;
+        vk::DeviceSize      peakUsed = 0;
+        uint32_t            allocations = 0;
+        uint32_t            blockAllocations = 0;
+    };
+
+    bool allocateFrom(Pool& pool, const uint32_t blockIndex, const vk::MemoryRequirements& requirements, MemoryAllocation& out);
+
+    uint32_t createBlock(Pool& pool, const vk::DeviceSize size);
+
+    vk::DeviceSize blockSize(const uint32_t memoryType) const;
+
+    mutable std::mutex                  m_mutex;
+    std::vector<Pool>                   m_pools;    // memoryType * 2 + (isLinear ? 0 : 1)
+    vk::PhysicalDeviceMemoryProperties  m_properties;
+    vk::PhysicalDevice                  m_physicalDevice;
+    vk::Device                          m_device;
+};
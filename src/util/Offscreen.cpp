@@ -0,0 +1,198 @@
+#include "Offscreen.h"
+
+
+Offscreen::Offscreen(
+    const vk::Device& dev, const vk::PhysicalDevice& physicalDevice, const uint32_t queueFamilyIndex,
+    const vk::Extent2D& extent, const vk::Format& format, const uint32_t imageCount)
+    : m_device(dev), m_extent(extent), m_format(format), m_allocator(&MemoryAllocator::get(physicalDevice, dev)), m_nextImage(0)
+{
+    vk::ImageCreateInfo imageInfo(
+        vk::ImageCreateFlags(),
+        vk::ImageType::e2D,
+        format,
+        vk::Extent3D(extent.width, extent.height, 1),
+        1,
+        1,
+        vk::SampleCountFlagBits::e1,
+        vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc
+    );
+
+    vk::ImageViewCreateInfo viewInfo(
+        vk::ImageViewCreateFlags(),
+        vk::Image(),
+        vk::ImageViewType::e2D,
+        format,
+        vk::ComponentMapping(),
+        vk::ImageSubresourceRange(
+            vk::ImageAspectFlagBits::eColor,
+            0,
+            1,
+            0,
+            1
+        )
+    );
+
+    m_images.resize(imageCount);
+    m_memories.resize(imageCount);
+    m_imageViews.resize(imageCount);
+    for (auto i = 0u; i < imageCount; ++i)
+    {
+        m_images[i] = dev.createImage(imageInfo);
+        m_memories[i] = m_allocator->allocate(dev.getImageMemoryRequirements(m_images[i]), vk::MemoryPropertyFlagBits::eDeviceLocal, false);
+        dev.bindImageMemory(m_images[i], m_memories[i].memory, m_memories[i].offset);
+
+        viewInfo.image = m_images[i];
+        m_imageViews[i] = dev.createImageView(viewInfo);
+    }
+
+    m_queue = dev.getQueue(queueFamilyIndex, 0);
+}
+
+Offscreen::Offscreen()
+    : m_allocator(nullptr), m_nextImage(0)
+{
+
+}
+
+Offscreen::Offscreen(Offscreen&& other)
+{
+    m_device = other.m_device;
+    m_queue = other.m_queue;
+    m_extent = other.m_extent;
+    m_format = other.m_format;
+    m_images = other.m_images;
+    m_memories = other.m_memories;
+    m_allocator = other.m_allocator;
+    m_imageViews = other.m_imageViews;
+    m_nextImage = other.m_nextImage;
+
+    other.reset();
+}
+
+Offscreen::~Offscreen()
+{
+    release();
+    reset();
+}
+
+Offscreen& Offscreen::operator=(Offscreen&& other)
+{
+    release();
+
+    m_device = other.m_device;
+    m_queue = other.m_queue;
+    m_extent = other.m_extent;
+    m_format = other.m_format;
+    m_images = other.m_images;
+    m_memories = other.m_memories;
+    m_allocator = other.m_allocator;
+    m_imageViews = other.m_imageViews;
+    m_nextImage = other.m_nextImage;
+
+    other.reset();
+
+    return *this;
+}
+
+std::ostream& operator<<(std::ostream& os, const Offscreen& self)
+{
+    os << "Offscreen: {";
+
+    os << "Extent: (" << self.m_extent.width << ", " << self.m_extent.height << ')';
+
+    os << ", Image Views: [ ";
+    for (const auto& view : self.m_imageViews)
+    {
+        os << view << " ";
+    }
+    os << ']';
+
+    os << ", Queue: " << self.m_queue;
+
+    return os;
+}
+
+vk::Extent2D Offscreen::extent() const
+{
+    return m_extent;
+}
+
+vk::Format Offscreen::format() const
+{
+    return m_format;
+}
+
+const uint32_t Offscreen::imageCount() const
+{
+    return m_imageViews.size();
+}
+
+const vk::ImageView& Offscreen::view(const uint32_t idx) const
+{
+    return m_imageViews[idx];
+}
+
+const vk::Image& Offscreen::image(const uint32_t idx) const
+{
+    return m_images[idx];
+}
+
+vk::ImageLayout Offscreen::finalLayout() const
+{
+    return vk::ImageLayout::eTransferSrcOptimal;
+}
+
+vk::Result Offscreen::present(const vk::Semaphore& signal, const uint32_t& imageIndex)
+{
+    // Nothing to show - consume the render semaphore so it can be signaled again next time
+    const vk::PipelineStageFlags waitStage(vk::PipelineStageFlagBits::eBottomOfPipe);
+    const vk::SubmitInfo submitInfo(1, &signal, &waitStage, 0, nullptr, 0, nullptr);
+
+    m_queue.submit({ submitInfo }, vk::Fence());
+    return vk::Result::eSuccess;
+}
+
+vk::Result Offscreen::acquireNextImage(const vk::Semaphore& wait, uint32_t& index)
+{
+    // Images are handed out round robin, frames in flight fences make sure the oldest one is done by now
+    index = m_nextImage;
+    m_nextImage = (m_nextImage + 1) % imageCount();
+
+    const vk::SubmitInfo submitInfo(0, nullptr, nullptr, 0, nullptr, 1, &wait);
+
+    m_queue.submit({ submitInfo }, vk::Fence());
+    return vk::Result::eSuccess;
+}
+
+void Offscreen::await()
+{
+    m_queue.waitIdle();
+}
+
+void Offscreen::reset()
+{
+    m_device = vk::Device();
+    m_queue = vk::Queue();
+    m_extent = vk::Extent2D();
+    m_format = vk::Format();
+    m_images.clear();
+    m_memories.clear();
+    m_allocator = nullptr;
+    m_imageViews.clear();
+    m_nextImage = 0;
+}
+
+void Offscreen::release()
+{
+    for (const auto& view : m_imageViews)
+        if (view)
+            m_device.destroyImageView(view);
+
+    for (const auto& image : m_images)
+        if (image)
+            m_device.destroyImage(image);
+
+    for (const auto& memory : m_memories)
+        m_allocator->free(memory);
+}
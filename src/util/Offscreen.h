@@ -0,0 +1,67 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "MemoryAllocator.h"
+#include "RenderTarget.h"
+
+// Headless render target - a ring of plain color images, no window, surface or swapchain involved.
+// Acquire and present only forward the semaphores through the queue, so frames are never throttled by a compositor
+class Offscreen : public RenderTarget
+{
+public:
+    friend std::ostream& operator<<(std::ostream& os, const Offscreen& self);
+
+    Offscreen();
+
+    Offscreen(
+        const vk::Device& dev, const vk::PhysicalDevice& physicalDevice, const uint32_t queueFamilyIndex,
+        const vk::Extent2D& extent, const vk::Format& format, const uint32_t imageCount
+    );
+
+    Offscreen(const Offscreen& other) = delete;
+
+    Offscreen(Offscreen&& other);
+
+    ~Offscreen();
+
+    Offscreen& operator=(const Offscreen& other) = delete;
+
+    Offscreen& operator=(Offscreen&& other);
+
+    vk::Extent2D extent() const override;
+
+    vk::Format format() const override;
+
+    const uint32_t imageCount() const override;
+
+    const vk::ImageView& view(const uint32_t idx) const override;
+
+    const vk::Image& image(const uint32_t idx) const;
+
+    vk::ImageLayout finalLayout() const override;
+
+    vk::Result present(const vk::Semaphore& signal, const uint32_t& imageIndex) override;
+
+    vk::Result acquireNextImage(const vk::Semaphore& wait, uint32_t& index) override;
+
+    void await() override;
+
+    void reset();
+
+    void release();
+
+private:
+    vk::Device                      m_device;
+    vk::Queue                       m_queue;
+    vk::Extent2D                    m_extent;
+    vk::Format                      m_format;
+    std::vector<vk::Image>          m_images;
+    std::vector<MemoryAllocation>   m_memories;
+    MemoryAllocator*                m_allocator;
+    std::vector<vk::ImageView>      m_imageViews;
+    uint32_t                        m_nextImage;
+};
@@ -0,0 +1,196 @@
+#include "Options.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+const char* nextValue(const int argc, const char* const* argv, int& i)
+{
+    if (i + 1 >= argc)
+    {
+        throw std::invalid_argument(std::string("missing value for option: ") + argv[i]);
+    }
+
+    return argv[++i];
+}
+
+}
+
+Options parseOptions(const int argc, const char* const* argv)
+{
+    Options ret;
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--headless"))
+        {
+            ret.headless = true;
+        }
+        else if (!strcmp(argv[i], "--frames"))
+        {
+            ret.frames = std::stoull(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--particles"))
+        {
+            ret.particles = std::stoull(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--initial"))
+        {
+            ret.initial = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--seed"))
+        {
+            ret.seed = static_cast<uint32_t>(std::stoul(nextValue(argc, argv, i)));
+        }
+        else if (!strcmp(argv[i], "--engine"))
+        {
+            ret.engine = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--step-rate"))
+        {
+            ret.stepRate = std::stod(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--max-substeps"))
+        {
+            ret.maxSubsteps = std::stoul(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--virtual-fps"))
+        {
+            ret.virtualFps = std::stod(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--theta"))
+        {
+            ret.theta = std::stof(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--kernel"))
+        {
+            ret.kernel = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--threads"))
+        {
+            ret.threads = std::stoul(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--style"))
+        {
+            ret.style = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--no-cull"))
+        {
+            ret.cull = false;
+        }
+        else if (!strcmp(argv[i], "--present-mode"))
+        {
+            ret.presentMode = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--fps"))
+        {
+            ret.fps = std::stod(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--frames-in-flight"))
+        {
+            ret.framesInFlight = std::stoul(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--record-threads"))
+        {
+            ret.recordThreads = std::stoul(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--stats"))
+        {
+            ret.statsPath = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--trace"))
+        {
+            ret.tracePath = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--checkpoint"))
+        {
+            ret.checkpointPath = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--checkpoint-every"))
+        {
+            ret.checkpointEvery = std::stoull(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--restore"))
+        {
+            ret.restorePath = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--trajectory"))
+        {
+            ret.trajectoryPath = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--trajectory-every"))
+        {
+            ret.trajectoryEvery = std::stoull(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--trajectory-bits"))
+        {
+            ret.trajectoryBits = std::stoul(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--playback"))
+        {
+            ret.playbackPath = nextValue(argc, argv, i);
+        }
+        else if (!strcmp(argv[i], "--playback-speed"))
+        {
+            ret.playbackSpeed = std::stod(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--playback-from"))
+        {
+            ret.playbackFrom = std::stoull(nextValue(argc, argv, i));
+        }
+        else if (!strcmp(argv[i], "--autotune"))
+        {
+            ret.autotune = true;
+        }
+        else
+        {
+            throw std::invalid_argument(std::string("unknown option: ") + argv[i]);
+        }
+    }
+
+    if (ret.stepRate <= 0.0)
+    {
+        throw std::invalid_argument("--step-rate must be positive");
+    }
+
+    if (ret.framesInFlight < 1 or ret.framesInFlight > config::MAX_FRAMES_IN_FLIGHT)
+    {
+        throw std::invalid_argument("--frames-in-flight must be between 1 and " + std::to_string(config::MAX_FRAMES_IN_FLIGHT));
+    }
+
+    if (ret.checkpointEvery and ret.checkpointPath.empty())
+    {
+        throw std::invalid_argument("--checkpoint-every needs --checkpoint");
+    }
+
+    if (!ret.trajectoryEvery)
+    {
+        throw std::invalid_argument("--trajectory-every must be positive");
+    }
+
+    if (ret.trajectoryBits < 1 or ret.trajectoryBits > 24)
+    {
+        throw std::invalid_argument("--trajectory-bits must be between 1 and 24");
+    }
+
+    if (!ret.playbackPath.empty() and (!ret.checkpointPath.empty() or !ret.trajectoryPath.empty() or !ret.restorePath.empty() or ret.autotune))
+    {
+        throw std::invalid_argument("--playback does not simulate, it cannot be combined with --checkpoint, --trajectory, --restore or --autotune");
+    }
+
+    // Offline tuning needs no window
+    if (ret.autotune)
+    {
+        ret.headless = true;
+    }
+
+    if (ret.headless and !ret.frames)
+    {
+        ret.frames = config::HEADLESS_FRAMES;
+    }
+
+    return ret;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "../config.h"
+
+struct Options
+{
+    // Render into offscreen images instead of a window, no GLFW or VkSurfaceKHR involved
+    bool headless = false;
+
+    // Stop after this many frames, 0 runs until the window is closed
+    uint64_t frames = 0;
+
+    size_t particles = config::PARTICLE_COUNT;
+
+    // Initial conditions, "sphere", "plummer", "cube", "disk" or "collision", and the seed that reproduces them.
+    // The GPU engine generates them on the device
+    std::string initial = "sphere";
+    uint32_t seed = config::SEED;
+
+    // Force solver, "barnes-hut", "direct" or "gpu"
+    std::string engine = "barnes-hut";
+
+    // Fixed simulation steps per second of frame time, and at most this many per rendered frame
+    double stepRate = config::STEP_RATE;
+    uint32_t maxSubsteps = config::MAX_SUBSTEPS;
+
+    // Frames advance the simulation clock by 1 / virtualFps each instead of following the wall clock, 0 for real time
+    double virtualFps = 0.0;
+
+    // Barnes-Hut opening angle
+    float theta = config::THETA;
+
+    // Force kernel name (scalar, sse, avx2, avx512), empty picks the widest the CPU supports
+    std::string kernel;
+
+    unsigned threads = std::thread::hardware_concurrency();
+
+    // "billboards" or "points"
+    std::string style = "billboards";
+
+    // GPU frustum culling ahead of the draw
+    bool cull = true;
+
+    // "immediate", "mailbox", "fifo" or "fifo-relaxed", FIFO when the surface lacks it
+    std::string presentMode = "mailbox";
+
+    // Frame rate cap, 0 runs as fast as the present mode lets it
+    double fps = 0.0;
+
+    // Frames recorded ahead of the GPU, 1 to config::MAX_FRAMES_IN_FLIGHT
+    uint32_t framesInFlight = config::FRAMES_IN_FLIGHT;
+
+    // Threads recording each frame's command buffers
+    uint32_t recordThreads = config::RECORD_THREADS;
+
+    // Per phase frame time percentiles written at exit and on SIGUSR1, .json or CSV otherwise
+    std::string statsPath;
+
+    // Per frame phase times, CSV
+    std::string tracePath;
+
+    // Binary checkpoint written at exit and every checkpointEvery steps when that is not 0, see nbody/Checkpoint.h
+    std::string checkpointPath;
+    uint64_t checkpointEvery = 0;
+
+    // Checkpoint to start from instead of the generated initial conditions, its particle count wins over `particles`
+    std::string restorePath;
+
+    // Compressed positions every trajectoryEvery steps, see nbody/Trajectory.h
+    std::string trajectoryPath;
+    uint64_t trajectoryEvery = config::TRAJECTORY_EVERY;
+    uint32_t trajectoryBits = config::TRAJECTORY_BITS;
+
+    // Play a trajectory or checkpoint back instead of simulating, from the last frame at or before step playbackFrom.
+    // playbackSpeed is relative to the recording's simulated time at stepRate, negative plays backwards
+    std::string playbackPath;
+    double playbackSpeed = 1.0;
+    uint64_t playbackFrom = 0;
+
+    // Tune the GPU engine's compute kernels for this device and exit, otherwise that only happens when no tuning was saved yet
+    bool autotune = false;
+};
+
+Options parseOptions(const int argc, const char* const* argv);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+// Buffers of Vertex records Graphics draws from, filled either by a CPU engine (HostParticles) or on the GPU (Compute)
+class ParticleSource
+{
+public:
+    virtual ~ParticleSource() = default;
+
+    virtual uint32_t count() const = 0;
+
+    // Number of distinct buffers a frame may draw from
+    virtual uint32_t bufferCount() const = 0;
+
+    // Usable as vertex and storage buffer, Graphics' cull pass reads it from a compute shader
+    virtual const vk::Buffer& buffer(const uint32_t index) const = 0;
+
+    // Recorded on the graphics queue around the draw, for queue family ownership transfers of buffer `index`
+    virtual void acquire(const vk::CommandBuffer& commandBuffer, const uint32_t index) const
+    {
+    }
+
+    virtual void release(const vk::CommandBuffer& commandBuffer, const uint32_t index) const
+    {
+    }
+};
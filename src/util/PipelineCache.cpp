@@ -0,0 +1,199 @@
+#include "PipelineCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+
+// Layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+struct CacheHeader
+{
+    uint32_t    length;
+    uint32_t    version;
+    uint32_t    vendorID;
+    uint32_t    deviceID;
+    uint8_t     uuid[VK_UUID_SIZE];
+};
+
+std::string cachePath(const std::string& directory, const vk::PhysicalDeviceProperties& properties)
+{
+    std::ostringstream path;
+    path << directory << "/pipeline-cache-" << std::hex << std::setfill('0') 
+         << std::setw(4) << properties.vendorID << '-' << std::setw(4) << properties.deviceID << ".bin";
+    return path.str();
+}
+
+}
+
+PipelineCache::PipelineCache(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, const std::string& directory)
+    : m_properties(physicalDevice.getProperties()), m_device(dev)
+{
+    m_path = cachePath(directory, m_properties);
+
+    auto data = load();
+    m_isWarm = !data.empty();
+
+    m_cache = dev.createPipelineCache(vk::PipelineCacheCreateInfo(vk::PipelineCacheCreateFlags(), data.size(), data.data()));
+
+    std::cout << "Pipeline cache " << m_path << ": " << (m_isWarm ? "loaded " + std::to_string(data.size()) + " bytes" : "cold") << '\n';
+}
+
+PipelineCache::PipelineCache()
+    : m_isWarm(false)
+{
+}
+
+PipelineCache::PipelineCache(PipelineCache&& other)
+{
+    m_cache = other.m_cache;
+    m_properties = other.m_properties;
+    m_path = std::move(other.m_path);
+    m_isWarm = other.m_isWarm;
+    m_device = other.m_device;
+
+    other.reset();
+}
+
+PipelineCache::~PipelineCache()
+{
+    release();
+    reset();
+}
+
+PipelineCache& PipelineCache::operator=(PipelineCache&& other)
+{
+    release();
+
+    m_cache = other.m_cache;
+    m_properties = other.m_properties;
+    m_path = std::move(other.m_path);
+    m_isWarm = other.m_isWarm;
+    m_device = other.m_device;
+
+    other.reset();
+
+    return *this;
+}
+
+const vk::PipelineCache& PipelineCache::cache() const
+{
+    return m_cache;
+}
+
+vk::Pipeline PipelineCache::createGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& info, const char* name) const
+{
+    auto start = std::chrono::steady_clock::now();
+    auto ret = m_device.createGraphicsPipeline(m_cache, info);
+    logBuild(name, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    return ret;
+}
+
+vk::Pipeline PipelineCache::createComputePipeline(const vk::ComputePipelineCreateInfo& info, const char* name) const
+{
+    auto start = std::chrono::steady_clock::now();
+    auto ret = m_device.createComputePipeline(m_cache, info);
+    logBuild(name, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    return ret;
+}
+
+void PipelineCache::save() const
+{
+    if (!m_cache)
+    {
+        return;
+    }
+
+    // Called on the way out, a failed save should not take the app down with it
+    try
+    {
+        auto data = m_device.getPipelineCacheData(m_cache);
+
+        auto temporary = m_path + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(data.data()), data.size());
+            if (!file)
+            {
+                throw std::runtime_error("could not write " + temporary);
+            }
+        }
+
+        if (std::rename(temporary.c_str(), m_path.c_str()))
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("could not replace " + m_path);
+        }
+    }
+    catch (const std::exception& err)
+    {
+        std::cerr << "Pipeline cache not saved: " << err.what() << '\n';
+    }
+}
+
+void PipelineCache::reset()
+{
+    m_cache = vk::PipelineCache();
+    m_properties = vk::PhysicalDeviceProperties();
+    m_path.clear();
+    m_isWarm = false;
+    m_device = vk::Device();
+}
+
+void PipelineCache::release()
+{
+    if (m_cache)
+    {
+        save();
+        m_device.destroyPipelineCache(m_cache);
+    }
+}
+
+std::vector<char> PipelineCache::load() const
+{
+    std::ifstream file(m_path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        return {};
+    }
+
+    std::vector<char> data(file.tellg());
+    file.seekg(0);
+    file.read(data.data(), data.size());
+
+    CacheHeader header;
+    if (!file or data.size() < sizeof(header))
+    {
+        return {};
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    // A driver update changes pipelineCacheUUID, the old data would only be rejected or worse
+    auto isCompatible = 
+        header.length >= sizeof(header) and
+        header.version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE and
+        header.vendorID == m_properties.vendorID and
+        header.deviceID == m_properties.deviceID and
+        !std::memcmp(header.uuid, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    if (!isCompatible)
+    {
+        std::cout << "Pipeline cache " << m_path << " is from another device or driver, ignoring it\n";
+        return {};
+    }
+
+    return data;
+}
+
+void PipelineCache::logBuild(const char* name, const double milliseconds) const
+{
+    std::cout << "Pipeline " << name << " built in " << milliseconds << "ms (" << (m_isWarm ? "warm" : "cold") << " cache)\n";
+}
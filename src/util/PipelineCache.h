@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+// vk::PipelineCache persisted to disk between runs, one file per GPU.
+// Data whose header does not match the device (other vendor, device or driver build) is dropped on load.
+// Saving goes through a temporary file and a rename, so a crash never leaves a torn cache behind
+class PipelineCache
+{
+public:
+    PipelineCache(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, const std::string& directory = ".");
+
+    PipelineCache();
+
+    PipelineCache(const PipelineCache& other) = delete;
+
+    PipelineCache(PipelineCache&& other);
+
+    // Saves before destroying the cache
+    ~PipelineCache();
+
+    PipelineCache& operator=(const PipelineCache& other) = delete;
+
+    PipelineCache& operator=(PipelineCache&& other);
+
+    const vk::PipelineCache& cache() const;
+
+    // Build through the cache and log how long it took, `name` only labels the log line
+    vk::Pipeline createGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& info, const char* name) const;
+
+    vk::Pipeline createComputePipeline(const vk::ComputePipelineCreateInfo& info, const char* name) const;
+
+    void save() const;
+
+    void reset();
+
+    void release();
+
+private:
+    // Raw cache data if it was written for this device, empty otherwise
+    std::vector<char> load() const;
+
+    void logBuild(const char* name, const double milliseconds) const;
+
+    vk::PipelineCache               m_cache;
+    vk::PhysicalDeviceProperties    m_properties;
+    std::string                     m_path;
+    bool                            m_isWarm;
+    vk::Device                      m_device;
+};
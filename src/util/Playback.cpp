@@ -0,0 +1,571 @@
+#include "Playback.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "Vertex.h"
+#include "../nbody/Checkpoint.h"
+#include "../nbody/parallel.h"
+#include "../nbody/Trajectory.h"
+
+// The recording and the thread decoding it. Slots are claimed for the frames from `wanted` on in the play direction,
+// a slot is reused once no frame in flight copies from it, it is not the one on screen and its frame fell out of that window
+struct Playback::Prefetcher
+{
+    struct Slot
+    {
+        Vertex*     data = nullptr;
+        int64_t     frame = -1;
+        uint32_t    pins = 0;           // frames in flight copying from it
+        bool        isReady = false;
+    };
+
+    Prefetcher(const std::string& path, const unsigned threads)
+        : threads(threads)
+    {
+        if (isCheckpointFile(path))
+        {
+            checkpoint = MappedCheckpoint(path);
+            const auto info = checkpoint.info();
+            times.push_back(info.time);
+            steps.push_back(info.step);
+            count = checkpoint.size();
+            return;
+        }
+
+        trajectory.reset(new TrajectoryReader(path));
+        if (!trajectory->frameCount())
+        {
+            throw std::runtime_error("trajectory holds no frames: " + path);
+        }
+
+        for (auto i = 0u; i < trajectory->frameCount(); ++i)
+        {
+            times.push_back(trajectory->frame(i).time);
+            steps.push_back(trajectory->frame(i).step);
+        }
+        count = trajectory->count();
+
+        for (auto column : { &x, &y, &z, &previousX, &previousY, &previousZ })
+        {
+            column->resize(count);
+        }
+    }
+
+    ~Prefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isStopping = true;
+        }
+        wake.notify_one();
+
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+
+    void start(const std::vector<Vertex*>& data)
+    {
+        for (const auto pointer : data)
+        {
+            slots.emplace_back();
+            slots.back().data = pointer;
+        }
+
+        thread = std::thread([this]() { work(); });
+    }
+
+    bool isInWindow(const int64_t frame) const
+    {
+        const auto ahead = (frame - wanted) * direction;
+        return ahead >= 0 and ahead < static_cast<int64_t>(slots.size());
+    }
+
+    // Under the lock - the first frame of the window no slot holds or decodes yet, -1 once the window is covered
+    int64_t next() const
+    {
+        for (int64_t frame = wanted; isInWindow(frame) and frame >= 0 and frame < static_cast<int64_t>(times.size()); frame += direction)
+        {
+            const auto isHeld = std::any_of(slots.begin(), slots.end(), [frame](const Slot& slot) { return slot.frame == frame; });
+            if (!isHeld)
+            {
+                return frame;
+            }
+        }
+
+        return -1;
+    }
+
+    // Under the lock
+    int64_t freeSlot() const
+    {
+        for (auto i = 0u; i < slots.size(); ++i)
+        {
+            const auto& slot = slots[i];
+            if (slot.frame < 0 or (slot.isReady and !slot.pins and slot.frame != shown and !isInWindow(slot.frame)))
+            {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    // Under the lock
+    int64_t slotOf(const int64_t frame) const
+    {
+        for (auto i = 0u; i < slots.size(); ++i)
+        {
+            if (slots[i].isReady and slots[i].frame == frame)
+            {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            wake.wait(lock, [this]() { return isStopping or (!error and next() >= 0 and freeSlot() >= 0); });
+            if (isStopping)
+            {
+                return;
+            }
+
+            const auto frame = next();
+            auto& slot = slots[freeSlot()];
+            slot.frame = frame;
+            slot.isReady = false;
+            lock.unlock();
+
+            std::exception_ptr failure;
+            try
+            {
+                decode(frame, slot.data);
+            }
+            catch (...)
+            {
+                failure = std::current_exception();
+            }
+
+            lock.lock();
+            if (failure)
+            {
+                error = failure;
+                slot.frame = -1;
+            }
+            slot.isReady = !failure;
+            decoded.notify_all();
+        }
+    }
+
+    // Prefetch thread only
+    void decode(const int64_t frame, Vertex* dest)
+    {
+        if (!trajectory)
+        {
+            const auto columns = checkpoint.columns();
+            parallelFor(count, threads, [&](const size_t begin, const size_t end) {
+                for (auto i = begin; i < end; ++i)
+                {
+                    dest[i].position = glm::vec4(columns.x[i], columns.y[i], columns.z[i], columns.mass[i]);
+                    dest[i].velocity = glm::vec4(columns.vx[i], columns.vy[i], columns.vz[i], 0.0f);
+                }
+            });
+            return;
+        }
+
+        // the previous frame for the velocities - what was just decoded when playing forwards, read again otherwise
+        if (frame > 0 and previousFrame != frame - 1)
+        {
+            if (currentFrame == frame - 1)
+            {
+                std::swap(x, previousX);
+                std::swap(y, previousY);
+                std::swap(z, previousZ);
+                previousFrame = currentFrame;
+                currentFrame = -1;
+            }
+            else
+            {
+                trajectory->read(frame - 1, previousX.data(), previousY.data(), previousZ.data(), threads);
+                previousFrame = frame - 1;
+            }
+        }
+
+        if (currentFrame != frame)
+        {
+            currentFrame = -1;
+            trajectory->read(frame, x.data(), y.data(), z.data(), threads);
+            currentFrame = frame;
+        }
+
+        const auto& masses = trajectory->masses();
+        const auto dt = frame > 0 ? static_cast<float>(times[frame] - times[frame - 1]) : 0.0f;
+        const auto invDt = dt > 0.0f ? 1.0f / dt : 0.0f;
+
+        parallelFor(count, threads, [&](const size_t begin, const size_t end) {
+            for (auto i = begin; i < end; ++i)
+            {
+                const glm::vec3 position(x[i], y[i], z[i]);
+                const auto velocity = frame > 0 ? (position - glm::vec3(previousX[i], previousY[i], previousZ[i])) * invDt : glm::vec3(0.0f);
+
+                dest[i].position = glm::vec4(position, masses[i]);
+                dest[i].velocity = glm::vec4(velocity, 0.0f);
+            }
+        });
+    }
+
+    // the recording, fixed after construction
+    std::unique_ptr<TrajectoryReader>   trajectory;
+    MappedCheckpoint                    checkpoint;
+    std::vector<double>                 times;
+    std::vector<uint64_t>               steps;
+    size_t                              count = 0;
+    unsigned                            threads;
+
+    // prefetch thread only
+    std::vector<float>                  x, y, z;
+    std::vector<float>                  previousX, previousY, previousZ;
+    int64_t                             currentFrame = -1;
+    int64_t                             previousFrame = -1;
+
+    std::mutex                          mutex;
+    std::condition_variable             wake;
+    std::condition_variable             decoded;
+    std::vector<Slot>                   slots;
+    int64_t                             wanted = 0;
+    int64_t                             direction = 1;
+    int64_t                             shown = -1;
+    std::exception_ptr                  error;
+    bool                                isStopping = false;
+    std::thread                         thread;
+};
+
+Playback::Playback(
+    const vk::PhysicalDevice& physicalDevice, const vk::Device& dev,
+    const std::string& path, const uint32_t bufferCount, const uint32_t stagingCount,
+    const double rate, const unsigned threads)
+    : m_playhead(0.0), m_lastSeconds(0.0), m_speed(1.0), m_rate(rate), m_shown(-1), m_stalls(0), m_isStarted(false), m_device(dev)
+{
+    m_prefetcher.reset(new Prefetcher(path, threads));
+    m_playhead = m_prefetcher->times.front();
+
+    const auto size = sizeof(Vertex) * std::max<size_t>(1, m_prefetcher->count);
+
+    m_buffers.resize(bufferCount);
+    for (auto& buffer : m_buffers)
+    {
+        buffer = BoundedBuffer(
+            physicalDevice, dev,
+            size, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eDeviceLocal
+        );
+    }
+
+    // one for the frame on screen and one to decode into at the least
+    std::vector<Vertex*> data;
+    m_staging.resize(std::max(2u, stagingCount));
+    for (auto& staging : m_staging)
+    {
+        staging = BoundedBuffer(
+            physicalDevice, dev,
+            size, vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible
+        );
+        data.push_back(static_cast<Vertex*>(staging.data()));
+    }
+
+    m_bufferFrames.assign(bufferCount, -1);
+    m_copies.assign(bufferCount, -1);
+    m_pinned.assign(bufferCount, -1);
+
+    m_prefetcher->start(data);
+}
+
+Playback::Playback()
+    : m_playhead(0.0), m_lastSeconds(0.0), m_speed(1.0), m_rate(0.0), m_shown(-1), m_stalls(0), m_isStarted(false)
+{
+
+}
+
+Playback::Playback(Playback&& other)
+{
+    m_buffers = std::move(other.m_buffers);
+    m_staging = std::move(other.m_staging);
+    m_bufferFrames = std::move(other.m_bufferFrames);
+    m_copies = std::move(other.m_copies);
+    m_pinned = std::move(other.m_pinned);
+    m_prefetcher = std::move(other.m_prefetcher);
+    m_playhead = other.m_playhead;
+    m_lastSeconds = other.m_lastSeconds;
+    m_speed = other.m_speed;
+    m_rate = other.m_rate;
+    m_shown = other.m_shown;
+    m_stalls = other.m_stalls;
+    m_isStarted = other.m_isStarted;
+    m_device = other.m_device;
+
+    other.reset();
+}
+
+Playback::~Playback()
+{
+    release();
+    reset();
+}
+
+Playback& Playback::operator=(Playback&& other)
+{
+    release();
+
+    m_buffers = std::move(other.m_buffers);
+    m_staging = std::move(other.m_staging);
+    m_bufferFrames = std::move(other.m_bufferFrames);
+    m_copies = std::move(other.m_copies);
+    m_pinned = std::move(other.m_pinned);
+    m_prefetcher = std::move(other.m_prefetcher);
+    m_playhead = other.m_playhead;
+    m_lastSeconds = other.m_lastSeconds;
+    m_speed = other.m_speed;
+    m_rate = other.m_rate;
+    m_shown = other.m_shown;
+    m_stalls = other.m_stalls;
+    m_isStarted = other.m_isStarted;
+    m_device = other.m_device;
+
+    other.reset();
+
+    return *this;
+}
+
+uint32_t Playback::count() const
+{
+    return static_cast<uint32_t>(m_prefetcher->count);
+}
+
+uint32_t Playback::bufferCount() const
+{
+    return static_cast<uint32_t>(m_buffers.size());
+}
+
+const vk::Buffer& Playback::buffer(const uint32_t index) const
+{
+    return m_buffers[index].buffer();
+}
+
+void Playback::acquire(const vk::CommandBuffer& commandBuffer, const uint32_t index) const
+{
+    if (m_copies[index] < 0)
+    {
+        return;
+    }
+
+    const auto size = sizeof(Vertex) * m_prefetcher->count;
+    commandBuffer.copyBuffer(m_staging[m_copies[index]].buffer(), m_buffers[index].buffer(), { vk::BufferCopy(0, 0, size) });
+
+    // read by Graphics' cull pass when it culls, as vertex input otherwise
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexInput,
+        vk::DependencyFlags(),
+        { vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eVertexAttributeRead) },
+        {}, {}
+    );
+}
+
+void Playback::update(const uint32_t index, const double seconds)
+{
+    auto& prefetcher = *m_prefetcher;
+    const auto& times = prefetcher.times;
+
+    if (!m_isStarted)
+    {
+        m_lastSeconds = seconds;
+        m_isStarted = true;
+    }
+    m_playhead = std::min(std::max(m_playhead + (seconds - m_lastSeconds) * m_rate * m_speed, times.front()), times.back());
+    m_lastSeconds = seconds;
+
+    // the first frame at or after the playhead, rewind() slides it back to where the playhead is
+    const auto wanted = static_cast<int64_t>(std::lower_bound(times.begin(), times.end(), m_playhead) - times.begin());
+    const auto direction = m_speed < 0.0 ? -1 : 1;
+
+    std::unique_lock<std::mutex> lock(prefetcher.mutex);
+
+    // the draw that last used `index` is done, and so is the copy it started with
+    if (m_pinned[index] >= 0)
+    {
+        --prefetcher.slots[m_pinned[index]].pins;
+        m_pinned[index] = -1;
+    }
+
+    if (prefetcher.error)
+    {
+        std::rethrow_exception(prefetcher.error);
+    }
+
+    prefetcher.wanted = wanted;
+    prefetcher.direction = direction;
+    prefetcher.wake.notify_one();
+
+    // nothing to fall back on yet
+    if (m_shown < 0)
+    {
+        prefetcher.decoded.wait(lock, [&]() { return prefetcher.error or prefetcher.slotOf(wanted) >= 0; });
+        if (prefetcher.error)
+        {
+            std::rethrow_exception(prefetcher.error);
+        }
+    }
+
+    // the decoded frame closest to the wanted one without overshooting it, as long as it gets closer than the shown one
+    auto best = -1;
+    auto bestDistance = m_shown < 0 ? std::numeric_limits<int64_t>::max() : std::abs(wanted - m_shown);
+    for (auto i = 0u; i < prefetcher.slots.size(); ++i)
+    {
+        const auto& slot = prefetcher.slots[i];
+        const auto distance = (wanted - slot.frame) * direction;
+        if (slot.isReady and distance >= 0 and distance < bestDistance)
+        {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+
+    if (best >= 0)
+    {
+        m_shown = prefetcher.slots[best].frame;
+    }
+    else
+    {
+        best = prefetcher.slotOf(m_shown);
+    }
+    prefetcher.shown = m_shown;
+
+    if (m_shown != wanted)
+    {
+        ++m_stalls;
+    }
+
+    m_copies[index] = -1;
+    if (m_bufferFrames[index] != m_shown and best >= 0)
+    {
+        m_copies[index] = best;
+        m_pinned[index] = best;
+        ++prefetcher.slots[best].pins;
+        m_bufferFrames[index] = m_shown;
+    }
+}
+
+float Playback::rewind() const
+{
+    const auto& times = m_prefetcher->times;
+    if (m_shown <= 0)
+    {
+        return 0.0f;
+    }
+
+    const auto span = times[m_shown] - times[m_shown - 1];
+    return static_cast<float>(std::min(0.0, std::max(m_playhead - times[m_shown], -span)));
+}
+
+void Playback::seek(const double time)
+{
+    m_playhead = std::min(std::max(time, startTime()), endTime());
+}
+
+void Playback::seekStep(const uint64_t step)
+{
+    const auto& steps = m_prefetcher->steps;
+    const auto it = std::upper_bound(steps.begin(), steps.end(), step);
+
+    seek(m_prefetcher->times[it == steps.begin() ? 0 : it - steps.begin() - 1]);
+}
+
+void Playback::setSpeed(const double speed)
+{
+    m_speed = speed;
+}
+
+double Playback::speed() const
+{
+    return m_speed;
+}
+
+double Playback::time() const
+{
+    return m_playhead;
+}
+
+double Playback::startTime() const
+{
+    return m_prefetcher->times.front();
+}
+
+double Playback::endTime() const
+{
+    return m_prefetcher->times.back();
+}
+
+size_t Playback::frameCount() const
+{
+    return m_prefetcher->times.size();
+}
+
+uint64_t Playback::step() const
+{
+    return m_prefetcher->steps[std::max<int64_t>(0, m_shown)];
+}
+
+uint64_t Playback::stalls() const
+{
+    return m_stalls;
+}
+
+void Playback::reset()
+{
+    m_buffers.clear();
+    m_staging.clear();
+    m_bufferFrames.clear();
+    m_copies.clear();
+    m_pinned.clear();
+    m_prefetcher.reset();
+    m_playhead = 0.0;
+    m_lastSeconds = 0.0;
+    m_speed = 1.0;
+    m_rate = 0.0;
+    m_shown = -1;
+    m_stalls = 0;
+    m_isStarted = false;
+    m_device = vk::Device();
+}
+
+void Playback::release()
+{
+    // the prefetch thread writes into the staging buffers until it is stopped
+    m_prefetcher.reset();
+
+    for (auto& buffer : m_buffers)
+    {
+        buffer.release();
+    }
+    m_buffers.clear();
+
+    for (auto& staging : m_staging)
+    {
+        staging.release();
+    }
+    m_staging.clear();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "BoundedBuffer.h"
+#include "ParticleSource.h"
+
+// Plays a recorded trajectory (or a single checkpoint) instead of simulating. A prefetch thread decodes the frames around
+// the playhead into a ring of host visible staging buffers, the frame a draw shows is copied from there into that frame's
+// device local vertex buffer on the graphics queue. Velocities are the difference to the previous recorded frame, so
+// Graphics' rewind slides each particle between two recorded frames.
+// Neither decoding nor the disk ever holds up a frame - when the wanted frame is not decoded yet the newest one that is stays up
+class Playback : public ParticleSource
+{
+public:
+    // `rate` simulated seconds pass per second of frame time at speed 1, `stagingCount` frames are decoded ahead at most
+    Playback(
+        const vk::PhysicalDevice& physicalDevice, const vk::Device& dev,
+        const std::string& path, const uint32_t bufferCount, const uint32_t stagingCount,
+        const double rate, const unsigned threads
+    );
+
+    Playback();
+
+    Playback(const Playback& other) = delete;
+
+    Playback(Playback&& other);
+
+    ~Playback();
+
+    Playback& operator=(const Playback& other) = delete;
+
+    Playback& operator=(Playback&& other);
+
+    uint32_t count() const override;
+
+    uint32_t bufferCount() const override;
+
+    const vk::Buffer& buffer(const uint32_t index) const override;
+
+    // Copies the frame update() picked for buffer `index` when the buffer does not hold it yet
+    void acquire(const vk::CommandBuffer& commandBuffer, const uint32_t index) const override;
+
+    // Moves the playhead to frame time `seconds` at the current speed and picks the frame buffer `index` shows.
+    // The frame fence guarding `index` must have been waited on. Only the very first frame waits for decoding
+    void update(const uint32_t index, const double seconds);
+
+    // Simulated seconds from the shown frame back to the playhead, for Graphics::setTime - at most one recorded frame
+    float rewind() const;
+
+    // Simulated time, clamped to the recording
+    void seek(const double time);
+
+    // Seeks to the last recorded frame at or before `step`
+    void seekStep(const uint64_t step);
+
+    // Negative plays backwards, 0 pauses
+    void setSpeed(const double speed);
+
+    double speed() const;
+
+    double time() const;
+
+    double startTime() const;
+
+    double endTime() const;
+
+    size_t frameCount() const;
+
+    // Step of the frame shown last
+    uint64_t step() const;
+
+    // Frames that showed an older recorded frame than wanted because it was not decoded in time
+    uint64_t stalls() const;
+
+    void reset();
+
+    void release();
+
+private:
+    struct Prefetcher;
+
+    std::vector<BoundedBuffer>      m_buffers;          // device local, per frame in flight
+    std::vector<BoundedBuffer>      m_staging;          // host visible, written by the prefetch thread
+    std::vector<int64_t>            m_bufferFrames;     // recorded frame each buffer holds, -1 for none
+    std::vector<int64_t>            m_copies;           // staging slot to copy into each buffer at its next draw, -1 for none
+    std::vector<int64_t>            m_pinned;           // staging slot each frame in flight copies from until its fence
+    std::unique_ptr<Prefetcher>     m_prefetcher;
+    double                          m_playhead;
+    double                          m_lastSeconds;
+    double                          m_speed;
+    double                          m_rate;
+    int64_t                         m_shown;            // recorded frame
+    uint64_t                        m_stalls;
+    bool                            m_isStarted;
+    vk::Device                      m_device;
+};
@@ -5,13 +5,15 @@
 #include "query.h"
 #include "QueueFamilyIndices.h"
 
-Present::Present(const vk::Device& dev, const vk::PhysicalDevice& physicalDevice, const vk::SurfaceKHR& surface, GLFWwindow* window)
+Present::Present(
+    const vk::Device& dev, const vk::PhysicalDevice& physicalDevice, const vk::SurfaceKHR& surface, GLFWwindow* window,
+    const vk::PresentModeKHR presentMode, const vk::SwapchainKHR& oldSwapchain)
     : m_device(dev)
 {
     auto support = SwapChainSupportDetails(physicalDevice, surface);
 
     auto format = support.chooseFormat();
-    auto presentationMode = support.choosePresentMode();
+    auto presentationMode = support.choosePresentMode(presentMode);
     auto extent = support.chooseExtent(window);
 
     auto imageCount = support.chooseImageCount();
@@ -46,11 +48,12 @@ Present::Present(const vk::Device& dev, const vk::PhysicalDevice& physicalDevice
     chainInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
     chainInfo.presentMode = presentationMode;
     chainInfo.clipped = VK_TRUE;
-    chainInfo.oldSwapchain = vk::SwapchainKHR();
+    chainInfo.oldSwapchain = oldSwapchain;
 
     m_swapChain = dev.createSwapchainKHR(chainInfo);
     m_swapChainExtent = extent;
     m_swapChainImageFormat = format.format;
+    m_presentMode = presentationMode;
 
     auto m_swapChainImages = dev.getSwapchainImagesKHR(m_swapChain);
 
@@ -80,6 +83,7 @@ Present::Present(const vk::Device& dev, const vk::PhysicalDevice& physicalDevice
 }
 
 Present::Present()
+    : m_presentMode(vk::PresentModeKHR::eFifo)
 {
     
 }
@@ -91,6 +95,7 @@ Present::Present(Present&& other)
     m_queue = other.m_queue;
     m_swapChainExtent = other.m_swapChainExtent;
     m_swapChainImageFormat = other.m_swapChainImageFormat;
+    m_presentMode = other.m_presentMode;
     m_device = other.m_device;
 
     other.reset();
@@ -111,9 +116,12 @@ Present& Present::operator=(Present&& other)
     m_queue = other.m_queue;
     m_swapChainExtent = other.m_swapChainExtent;
     m_swapChainImageFormat = other.m_swapChainImageFormat;
+    m_presentMode = other.m_presentMode;
     m_device = other.m_device;
 
     other.reset();
+
+    return *this;
 }
 
 std::ostream& operator<<(std::ostream& os, const vk::Extent2D& extent)
@@ -149,6 +157,16 @@ vk::Format Present::format() const
     return m_swapChainImageFormat;
 }
 
+const vk::SwapchainKHR& Present::swapchain() const
+{
+    return m_swapChain;
+}
+
+vk::PresentModeKHR Present::presentMode() const
+{
+    return m_presentMode;
+}
+
 const uint32_t Present::imageCount() const
 {
     return m_swapChainImageViews.size();
@@ -159,6 +177,11 @@ const vk::ImageView& Present::view(const uint32_t idx) const
     return m_swapChainImageViews[idx];
 }
 
+vk::ImageLayout Present::finalLayout() const
+{
+    return vk::ImageLayout::ePresentSrcKHR;
+}
+
 vk::Result Present::present(const vk::Semaphore& signal, const uint32_t& imageIndex)
 {
     vk::PresentInfoKHR presentInfo(1, &signal, 1, &m_swapChain, &imageIndex);
@@ -182,6 +205,7 @@ void Present::reset()
     m_queue = vk::Queue();
     m_swapChainExtent = vk::Extent2D();
     m_swapChainImageFormat = vk::Format();
+    m_presentMode = vk::PresentModeKHR::eFifo;
     m_device = vk::Device();
 }
 
@@ -6,14 +6,21 @@
 #include <vulkan/vulkan.hpp>
 #include <GLFW/glfw3.h>
 
-class Present
+#include "RenderTarget.h"
+
+class Present : public RenderTarget
 {
 public:
     friend std::ostream& operator<<(std::ostream& os, const Present& self);
 
     Present();
 
-    Present(const vk::Device& dev, const vk::PhysicalDevice& physicalDevice, const vk::SurfaceKHR& surface, GLFWwindow* window);
+    // `presentMode` falls back to FIFO when the surface does not support it.
+    // `oldSwapchain` is handed over to the driver, it keeps presenting what is queued until destroyed
+    Present(
+        const vk::Device& dev, const vk::PhysicalDevice& physicalDevice, const vk::SurfaceKHR& surface, GLFWwindow* window,
+        const vk::PresentModeKHR presentMode = vk::PresentModeKHR::eMailbox, const vk::SwapchainKHR& oldSwapchain = vk::SwapchainKHR()
+    );
 
     Present(const Present& other) = delete;
 
@@ -25,19 +32,26 @@ public:
 
     Present& operator=(Present&& other);
 
-    vk::Extent2D extent() const;
+    vk::Extent2D extent() const override;
+
+    vk::Format format() const override;
+
+    const vk::SwapchainKHR& swapchain() const;
+
+    // What the swapchain ended up with
+    vk::PresentModeKHR presentMode() const;
 
-    vk::Format format() const;
+    const uint32_t imageCount() const override;
 
-    const uint32_t imageCount() const;
+    const vk::ImageView& view(const uint32_t idx) const override;
 
-    const vk::ImageView& view(const uint32_t idx) const;
+    vk::ImageLayout finalLayout() const override;
 
-    vk::Result present(const vk::Semaphore& signal, const uint32_t& imageIndex);
+    vk::Result present(const vk::Semaphore& signal, const uint32_t& imageIndex) override;
 
-    vk::Result acquireNextImage(const vk::Semaphore& wait, uint32_t& index);
+    vk::Result acquireNextImage(const vk::Semaphore& wait, uint32_t& index) override;
 
-    void await();
+    void await() override;
 
     void reset();
 
@@ -49,5 +63,6 @@ private:
     vk::SwapchainKHR            m_swapChain;
     vk::Extent2D                m_swapChainExtent;
     vk::Format                  m_swapChainImageFormat;
+    vk::PresentModeKHR          m_presentMode;
     std::vector<vk::ImageView>  m_swapChainImageViews;
 };
@@ -33,6 +33,75 @@ QueueFamilyIndices::QueueFamilyIndices(const vk::PhysicalDevice& dev, const vk::
 			break;
 		}
 	}
+
+	findCompute(families);
+	findTransfer(families);
+}
+
+QueueFamilyIndices::QueueFamilyIndices(const vk::PhysicalDevice& dev)
+{
+	auto families = dev.getQueueFamilyProperties();
+
+	uint32_t queueIdx = 0;
+	for (const auto& family : families)
+	{
+		if (family.queueCount > 0)
+		{
+			if (family.queueFlags & vk::QueueFlagBits::eGraphics)
+			{
+				m_graphics = queueIdx;
+				m_present = queueIdx;
+			}
+
+			if (family.queueFlags & vk::QueueFlagBits::eCompute)
+			{
+				m_compute = queueIdx;
+			}
+		}
+
+		queueIdx++;
+		if (hasAllQueues())
+		{
+			break;
+		}
+	}
+
+	findCompute(families);
+	findTransfer(families);
+}
+
+void QueueFamilyIndices::findCompute(const std::vector<vk::QueueFamilyProperties>& families)
+{
+	for (auto i = 0u; i < families.size(); ++i)
+	{
+		const auto& flags = families[i].queueFlags;
+		if (families[i].queueCount > 0 and (flags & vk::QueueFlagBits::eCompute) and !(flags & vk::QueueFlagBits::eGraphics))
+		{
+			m_compute = i;
+			return;
+		}
+	}
+
+	// Queue 0 of a family is the graphics one, a second queue keeps the step from waiting behind the draw
+	if (m_compute and m_compute == m_graphics and families[*m_compute].queueCount > 1)
+	{
+		m_computeQueue = 1;
+	}
+}
+
+void QueueFamilyIndices::findTransfer(const std::vector<vk::QueueFamilyProperties>& families)
+{
+	m_transfer = m_graphics;
+
+	for (auto i = 0u; i < families.size(); ++i)
+	{
+		const auto& flags = families[i].queueFlags;
+		if (families[i].queueCount > 0 and (flags & vk::QueueFlagBits::eTransfer) and !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)))
+		{
+			m_transfer = i;
+			return;
+		}
+	}
 }
 
 const uint32_t& QueueFamilyIndices::compute() const
@@ -40,6 +109,16 @@ const uint32_t& QueueFamilyIndices::compute() const
     return *m_compute;
 }
 
+uint32_t QueueFamilyIndices::computeQueue() const
+{
+    return m_computeQueue;
+}
+
+bool QueueFamilyIndices::isComputeQueueShared() const
+{
+    return m_compute == m_graphics and m_computeQueue == 0;
+}
+
 const uint32_t& QueueFamilyIndices::graphics() const
 {
     return *m_graphics;
@@ -50,6 +129,11 @@ const uint32_t& QueueFamilyIndices::present() const
     return *m_present;
 }
 
+const uint32_t& QueueFamilyIndices::transfer() const
+{
+    return *m_transfer;
+}
+
 bool QueueFamilyIndices::hasAllQueues() const
 {
     return hasCompute() and hasGraphics() and hasPresent();
@@ -2,6 +2,7 @@
 
 #include <optional>
 #include <functional>
+#include <vector>
 
 #include <vulkan/vulkan.hpp>
 
@@ -10,12 +11,26 @@ class QueueFamilyIndices
 public:
     QueueFamilyIndices(const vk::PhysicalDevice& dev, const vk::SurfaceKHR& surface);
 
+    // Headless lookup, with no surface to present to the graphics family stands in for present
+    explicit QueueFamilyIndices(const vk::PhysicalDevice& dev);
+
+    // A compute family without graphics when the device has one (async compute), the first compute capable family otherwise
     const uint32_t& compute() const;
 
+    // Queue of compute() the simulation runs on. 1 when it shares the graphics family and the family has a second queue,
+    // so the two still overlap
+    uint32_t computeQueue() const;
+
+    // Compute and graphics end up on the very same queue, the family has just the one
+    bool isComputeQueueShared() const;
+
     const uint32_t& graphics() const;
 
     const uint32_t& present() const;
 
+    // A transfer only family when the device has one (DMA engine), the graphics family otherwise
+    const uint32_t& transfer() const;
+
     bool hasAllQueues() const;
     
     bool hasCompute() const;
@@ -27,7 +42,13 @@ public:
     operator bool() const;
 
 private:
+    void findCompute(const std::vector<vk::QueueFamilyProperties>& families);
+
+    void findTransfer(const std::vector<vk::QueueFamilyProperties>& families);
+
     std::optional<uint32_t> m_compute = std::nullopt;
     std::optional<uint32_t> m_graphics = std::nullopt;
     std::optional<uint32_t> m_present = std::nullopt;
+    std::optional<uint32_t> m_transfer = std::nullopt;
+    uint32_t m_computeQueue = 0;
 };
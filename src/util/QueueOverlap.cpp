@@ -0,0 +1,32 @@
+#include "QueueOverlap.h"
+
+#include <algorithm>
+
+void QueueOverlap::add(const double computeBegin, const double computeEnd, const double graphicsBegin, const double graphicsEnd)
+{
+    m_compute += computeEnd - computeBegin;
+    m_graphics += graphicsEnd - graphicsBegin;
+    m_overlap += std::max(0.0, std::min(computeEnd, graphicsEnd) - std::max(computeBegin, graphicsBegin));
+    m_span += std::max(computeEnd, graphicsEnd) - std::min(computeBegin, graphicsBegin);
+    ++m_frames;
+}
+
+void QueueOverlap::setSharedQueue(const bool isShared)
+{
+    m_isSharedQueue = isShared;
+}
+
+void QueueOverlap::report(std::ostream& os) const
+{
+    if (!m_frames)
+    {
+        return;
+    }
+
+    os  << "Async compute over " << m_frames << " frames: "
+        << "step " << m_compute / m_frames * 1e-6 << "ms, "
+        << "draw " << m_graphics / m_frames * 1e-6 << "ms, "
+        << "overlap " << m_overlap / m_frames * 1e-6 << "ms "
+        << "(" << 100.0 * m_overlap / m_span << "% of the frame)"
+        << (m_isSharedQueue ? ", compute and graphics share one queue" : "") << '\n';
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// How much of each frame the compute step and the draw overlapping it ran at the same time on the GPU.
+// Timestamps are compared across queues, which Vulkan does not promise but every driver we run on (lavapipe included) shares one device clock for
+class QueueOverlap
+{
+public:
+    void add(const double computeBegin, const double computeEnd, const double graphicsBegin, const double graphicsEnd);
+
+    // Compute and graphics submit to one and the same queue, nothing to overlap
+    void setSharedQueue(const bool isShared);
+
+    void report(std::ostream& os) const;
+
+private:
+    double      m_compute = 0.0;
+    double      m_graphics = 0.0;
+    double      m_overlap = 0.0;
+    double      m_span = 0.0;
+    uint64_t    m_frames = 0;
+    bool        m_isSharedQueue = false;
+};
@@ -0,0 +1,131 @@
+#include "QueueTimer.h"
+
+QueueTimer::QueueTimer(const vk::Device& dev, const vk::PhysicalDevice& physicalDevice, const uint32_t familyIndex, const uint32_t ringSize)
+    : m_validMask(0), m_period(physicalDevice.getProperties().limits.timestampPeriod), m_device(dev)
+{
+    auto validBits = physicalDevice.getQueueFamilyProperties()[familyIndex].timestampValidBits;
+    if (!validBits)
+    {
+        return;
+    }
+    m_validMask = validBits >= 64 ? ~uint64_t(0) : (uint64_t(1) << validBits) - 1;
+
+    queryPool = dev.createQueryPool(vk::QueryPoolCreateInfo(vk::QueryPoolCreateFlags(), vk::QueryType::eTimestamp, 2 * ringSize));
+
+    vk::CommandPoolCreateInfo commandPoolInfo(vk::CommandPoolCreateFlags(), familyIndex);
+    commandPool = dev.createCommandPool(commandPoolInfo);
+
+    vk::CommandBufferAllocateInfo allocInfo(commandPool, vk::CommandBufferLevel::ePrimary, ringSize);
+    beginCommands = dev.allocateCommandBuffers(allocInfo);
+    endCommands = dev.allocateCommandBuffers(allocInfo);
+
+    for (auto i = 0u; i < ringSize; ++i)
+    {
+        beginCommands[i].begin(vk::CommandBufferBeginInfo());
+            beginCommands[i].resetQueryPool(queryPool, 2 * i, 2);
+            beginCommands[i].writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, 2 * i);
+        beginCommands[i].end();
+
+        endCommands[i].begin(vk::CommandBufferBeginInfo());
+            endCommands[i].writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, 2 * i + 1);
+        endCommands[i].end();
+    }
+}
+
+QueueTimer::QueueTimer()
+    : m_validMask(0), m_period(0.0f)
+{
+}
+
+QueueTimer::QueueTimer(QueueTimer&& other)
+{
+    commandPool = other.commandPool;
+    queryPool = other.queryPool;
+    beginCommands = other.beginCommands;
+    endCommands = other.endCommands;
+    m_validMask = other.m_validMask;
+    m_period = other.m_period;
+    m_device = other.m_device;
+
+    other.reset();
+}
+
+QueueTimer::~QueueTimer()
+{
+    release();
+    reset();
+}
+
+QueueTimer& QueueTimer::operator=(QueueTimer&& other)
+{
+    release();
+
+    commandPool = other.commandPool;
+    queryPool = other.queryPool;
+    beginCommands = other.beginCommands;
+    endCommands = other.endCommands;
+    m_validMask = other.m_validMask;
+    m_period = other.m_period;
+    m_device = other.m_device;
+
+    other.reset();
+
+    return *this;
+}
+
+bool QueueTimer::isEnabled() const
+{
+    return static_cast<bool>(queryPool);
+}
+
+const vk::CommandBuffer& QueueTimer::begin(const uint64_t submission) const
+{
+    return beginCommands[submission % beginCommands.size()];
+}
+
+const vk::CommandBuffer& QueueTimer::end(const uint64_t submission) const
+{
+    return endCommands[submission % endCommands.size()];
+}
+
+bool QueueTimer::read(const uint64_t submission, double& begin, double& end) const
+{
+    if (!isEnabled())
+    {
+        return false;
+    }
+
+    // timestamp and availability word for each of the two queries
+    uint64_t results[4];
+    auto slot = static_cast<uint32_t>(submission % beginCommands.size());
+    auto status = m_device.getQueryPoolResults(
+        queryPool, 2 * slot, 2, 
+        sizeof(results), results, 2 * sizeof(uint64_t), 
+        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability
+    );
+    if (status != vk::Result::eSuccess or !results[1] or !results[3])
+    {
+        return false;
+    }
+
+    begin = (results[0] & m_validMask) * static_cast<double>(m_period);
+    end = (results[2] & m_validMask) * static_cast<double>(m_period);
+    return true;
+}
+
+void QueueTimer::reset()
+{
+    commandPool = vk::CommandPool();
+    queryPool = vk::QueryPool();
+    beginCommands.clear();
+    endCommands.clear();
+    m_validMask = 0;
+    m_period = 0.0f;
+    m_device = vk::Device();
+}
+
+void QueueTimer::release()
+{
+    if (commandPool) m_device.destroyCommandPool(commandPool);
+    if (queryPool) m_device.destroyQueryPool(queryPool);
+}
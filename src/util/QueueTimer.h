@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+// GPU start / end timestamps of consecutive submissions on one queue, kept in a ring of query pairs.
+// The timestamps live in tiny command buffers submitted around the timed work, so pre recorded command buffers stay untouched
+class QueueTimer
+{
+public:
+    QueueTimer(const vk::Device& dev, const vk::PhysicalDevice& physicalDevice, const uint32_t familyIndex, const uint32_t ringSize);
+
+    QueueTimer();
+
+    QueueTimer(const QueueTimer& other) = delete;
+
+    QueueTimer(QueueTimer&& other);
+
+    ~QueueTimer();
+
+    QueueTimer& operator=(const QueueTimer& other) = delete;
+
+    QueueTimer& operator=(QueueTimer&& other);
+
+    // False when the queue family has no timestamp support
+    bool isEnabled() const;
+
+    const vk::CommandBuffer& begin(const uint64_t submission) const;
+
+    const vk::CommandBuffer& end(const uint64_t submission) const;
+
+    // Nanoseconds in the device time domain, false while the submission is still in flight.
+    // The caller makes sure the ring has not wrapped around since
+    bool read(const uint64_t submission, double& begin, double& end) const;
+
+    void reset();
+
+    void release();
+
+private:
+    vk::CommandPool                 commandPool;
+    vk::QueryPool                   queryPool;
+    std::vector<vk::CommandBuffer>  beginCommands;
+    std::vector<vk::CommandBuffer>  endCommands;
+    uint64_t                        m_validMask;
+    float                           m_period;
+    vk::Device                      m_device;
+};
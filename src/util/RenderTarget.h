@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+// Set of images Graphics renders into, either a swapchain (Present) or plain offscreen images (Offscreen)
+class RenderTarget
+{
+public:
+    virtual ~RenderTarget() = default;
+
+    virtual vk::Extent2D extent() const = 0;
+
+    virtual vk::Format format() const = 0;
+
+    virtual const uint32_t imageCount() const = 0;
+
+    virtual const vk::ImageView& view(const uint32_t idx) const = 0;
+
+    // Layout the render pass leaves the images in
+    virtual vk::ImageLayout finalLayout() const = 0;
+
+    virtual vk::Result present(const vk::Semaphore& signal, const uint32_t& imageIndex) = 0;
+
+    virtual vk::Result acquireNextImage(const vk::Semaphore& wait, uint32_t& index) = 0;
+
+    virtual void await() = 0;
+};
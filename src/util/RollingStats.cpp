@@ -0,0 +1,50 @@
+#include "RollingStats.h"
+
+#include <algorithm>
+#include <numeric>
+
+RollingStats::RollingStats(const size_t window)
+    : m_window(window), m_next(0)
+{
+    m_samples.reserve(window);
+}
+
+void RollingStats::add(const double sample)
+{
+    if (m_samples.size() < m_window)
+    {
+        m_samples.push_back(sample);
+        return;
+    }
+
+    m_samples[m_next] = sample;
+    m_next = (m_next + 1) % m_window;
+}
+
+size_t RollingStats::count() const
+{
+    return m_samples.size();
+}
+
+double RollingStats::min() const
+{
+    return m_samples.empty() ? 0.0 : *std::min_element(m_samples.begin(), m_samples.end());
+}
+
+double RollingStats::mean() const
+{
+    return m_samples.empty() ? 0.0 : std::accumulate(m_samples.begin(), m_samples.end(), 0.0) / m_samples.size();
+}
+
+double RollingStats::percentile(const double fraction) const
+{
+    if (m_samples.empty())
+    {
+        return 0.0;
+    }
+
+    auto sorted = m_samples;
+    auto nth = sorted.begin() + std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+    std::nth_element(sorted.begin(), nth, sorted.end());
+    return *nth;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Min / mean / percentiles over the last `window` samples
+class RollingStats
+{
+public:
+    explicit RollingStats(const size_t window = 256);
+
+    void add(const double sample);
+
+    size_t count() const;
+
+    double min() const;
+
+    double mean() const;
+
+    // `fraction` in [0, 1], e.g. 0.99 for p99
+    double percentile(const double fraction) const;
+
+private:
+    std::vector<double> m_samples;
+    size_t              m_window;
+    size_t              m_next;
+};
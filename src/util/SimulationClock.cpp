@@ -0,0 +1,79 @@
+#include "SimulationClock.h"
+
+#include <algorithm>
+#include <cmath>
+
+SteadyTimeSource::SteadyTimeSource()
+    : m_start(std::chrono::steady_clock::now())
+{
+
+}
+
+double SteadyTimeSource::frameTime()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+VirtualTimeSource::VirtualTimeSource(const double frameSeconds)
+    : m_frameSeconds(frameSeconds), m_frames(0)
+{
+
+}
+
+double VirtualTimeSource::frameTime()
+{
+    // a product rather than a running sum, no drift however long the run
+    return m_frameSeconds * static_cast<double>(m_frames++);
+}
+
+SimulationClock::SimulationClock(std::unique_ptr<TimeSource> source, const double step, const uint32_t maxSteps)
+    : m_source(std::move(source)), m_step(step), m_accumulator(0.0), m_frameTime(0.0), m_steps(0), m_droppedSteps(0), m_maxSteps(maxSteps), m_isStarted(false)
+{
+
+}
+
+uint32_t SimulationClock::advance()
+{
+    const auto now = m_source->frameTime();
+    const auto elapsed = m_isStarted ? std::max(0.0, now - m_frameTime) : 0.0;
+    m_frameTime = now;
+    m_isStarted = true;
+
+    m_accumulator += elapsed;
+    auto steps = static_cast<uint64_t>(std::floor(m_accumulator / m_step));
+    m_accumulator -= steps * m_step;
+
+    if (steps > m_maxSteps)
+    {
+        m_droppedSteps += steps - m_maxSteps;
+        steps = m_maxSteps;
+    }
+
+    m_steps += steps;
+    return static_cast<uint32_t>(steps);
+}
+
+float SimulationClock::alpha() const
+{
+    return static_cast<float>(std::min(std::max(m_accumulator / m_step, 0.0), 1.0));
+}
+
+double SimulationClock::step() const
+{
+    return m_step;
+}
+
+double SimulationClock::frameTime() const
+{
+    return m_frameTime;
+}
+
+uint64_t SimulationClock::steps() const
+{
+    return m_steps;
+}
+
+uint64_t SimulationClock::droppedSteps() const
+{
+    return m_droppedSteps;
+}
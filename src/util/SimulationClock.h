@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+// Where SimulationClock gets the time of a rendered frame from
+class TimeSource
+{
+public:
+    virtual ~TimeSource() = default;
+
+    // Seconds since an arbitrary start, read once per rendered frame
+    virtual double frameTime() = 0;
+};
+
+// Wall time on the steady clock
+class SteadyTimeSource : public TimeSource
+{
+public:
+    SteadyTimeSource();
+
+    double frameTime() override;
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Every frame exactly `frameSeconds` after the previous one whatever the wall clock says, so runs are reproducible
+class VirtualTimeSource : public TimeSource
+{
+public:
+    explicit VirtualTimeSource(const double frameSeconds);
+
+    double frameTime() override;
+
+private:
+    double      m_frameSeconds;
+    uint64_t    m_frames;
+};
+
+// Fixed timestep accumulator - the simulation advances in steps of `step` seconds of frame time, however often frames are rendered.
+// A frame takes as many steps as the time since the previous one holds, possibly none, and renders between the last two states by alpha()
+class SimulationClock
+{
+public:
+    // At most `maxSteps` per frame, time beyond that is dropped rather than piling up when the solver cannot keep up
+    SimulationClock(std::unique_ptr<TimeSource> source, const double step, const uint32_t maxSteps);
+
+    // Reads the time source for a new frame, returns the steps to take now. The first frame only starts the clock
+    uint32_t advance();
+
+    // How far the frame is past the last step, in [0, 1) steps - 0 draws the previous state, 1 would be the latest
+    float alpha() const;
+
+    double step() const;
+
+    // Frame time of the last advance(), for animation that should follow the same clock
+    double frameTime() const;
+
+    uint64_t steps() const;
+
+    // Steps skipped because of maxSteps
+    uint64_t droppedSteps() const;
+
+private:
+    std::unique_ptr<TimeSource> m_source;
+    double                      m_step;
+    double                      m_accumulator;
+    double                      m_frameTime;
+    uint64_t                    m_steps;
+    uint64_t                    m_droppedSteps;
+    uint32_t                    m_maxSteps;
+    bool                        m_isStarted;
+};
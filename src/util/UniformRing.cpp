@@ -0,0 +1,52 @@
+#include "UniformRing.h"
+
+UniformRing::UniformRing(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, const vk::DeviceSize sliceSize, const uint32_t sliceCount)
+    : m_range(sliceSize)
+{
+    // dynamic offsets must be multiples of minUniformBufferOffsetAlignment
+    auto alignment = physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment;
+    m_stride = alignment ? (sliceSize + alignment - 1) / alignment * alignment : sliceSize;
+
+    m_buffer = BoundedBuffer(
+        physicalDevice, dev, 
+        m_stride * sliceCount, vk::BufferUsageFlagBits::eUniformBuffer, 
+        vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible
+    );
+}
+
+UniformRing::UniformRing()
+    : m_range(0), m_stride(0)
+{
+}
+
+const vk::Buffer& UniformRing::buffer() const
+{
+    return m_buffer.buffer();
+}
+
+vk::DeviceSize UniformRing::range() const
+{
+    return m_range;
+}
+
+uint32_t UniformRing::offset(const uint32_t frame) const
+{
+    return static_cast<uint32_t>(frame * m_stride);
+}
+
+void* UniformRing::slice(const uint32_t frame) const
+{
+    return static_cast<char*>(m_buffer.data()) + frame * m_stride;
+}
+
+void UniformRing::reset()
+{
+    m_buffer.reset();
+    m_range = 0;
+    m_stride = 0;
+}
+
+void UniformRing::release()
+{
+    m_buffer.release();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan.hpp>
+
+#include "BoundedBuffer.h"
+
+// One persistently mapped, host coherent uniform buffer split into a slice per frame in flight.
+// Bound once as a dynamic uniform buffer, each frame selects its slice with offset(frame)
+class UniformRing
+{
+public:
+    UniformRing(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, const vk::DeviceSize sliceSize, const uint32_t sliceCount);
+
+    UniformRing();
+
+    const vk::Buffer& buffer() const;
+
+    // Unpadded size of one slice, the range to put in the descriptor
+    vk::DeviceSize range() const;
+
+    // Dynamic offset of slice `frame`
+    uint32_t offset(const uint32_t frame) const;
+
+    // Host pointer to slice `frame`, the fence of that frame must have been waited on before writing
+    void* slice(const uint32_t frame) const;
+
+    template <class T>
+    T& at(const uint32_t frame) const
+    {
+        return *static_cast<T*>(slice(frame));
+    }
+
+    void reset();
+
+    void release();
+
+private:
+    BoundedBuffer   m_buffer;
+    vk::DeviceSize  m_range;
+    vk::DeviceSize  m_stride;
+};
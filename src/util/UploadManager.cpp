@@ -0,0 +1,296 @@
+#include "UploadManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+
+// Keeps staging offsets friendly to optimalBufferCopyOffsetAlignment on every driver we know of
+constexpr vk::DeviceSize STAGING_ALIGNMENT = 256;
+
+}
+
+UploadManager::UploadManager(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, const uint32_t transferFamilyIndex, const vk::DeviceSize stagingSize)
+    :   m_head(0), m_tail(0), m_capacity(stagingSize), m_submitted(0), m_completed(0), 
+        m_familyIndex(transferFamilyIndex), m_device(dev)
+{
+    queue = dev.getQueue(transferFamilyIndex, 0);
+
+    vk::CommandPoolCreateInfo commandPoolInfo(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, transferFamilyIndex);
+    commandPool = dev.createCommandPool(commandPoolInfo);
+
+    staging = BoundedBuffer(
+        physicalDevice, dev, 
+        stagingSize, vk::BufferUsageFlagBits::eTransferSrc, 
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+    );
+}
+
+UploadManager::UploadManager()
+    : m_head(0), m_tail(0), m_capacity(0), m_submitted(0), m_completed(0), m_familyIndex(0)
+{
+}
+
+UploadManager::UploadManager(UploadManager&& other)
+{
+    commandPool = other.commandPool;
+    staging = std::move(other.staging);
+    m_pending = std::move(other.m_pending);
+    m_inFlight = std::move(other.m_inFlight);
+    m_idle = std::move(other.m_idle);
+    queue = other.queue;
+    m_head = other.m_head;
+    m_tail = other.m_tail;
+    m_capacity = other.m_capacity;
+    m_submitted = other.m_submitted;
+    m_completed = other.m_completed;
+    m_familyIndex = other.m_familyIndex;
+    m_device = other.m_device;
+
+    other.reset();
+}
+
+UploadManager::~UploadManager()
+{
+    release();
+    reset();
+}
+
+UploadManager& UploadManager::operator=(UploadManager&& other)
+{
+    release();
+
+    commandPool = other.commandPool;
+    staging = std::move(other.staging);
+    m_pending = std::move(other.m_pending);
+    m_inFlight = std::move(other.m_inFlight);
+    m_idle = std::move(other.m_idle);
+    queue = other.queue;
+    m_head = other.m_head;
+    m_tail = other.m_tail;
+    m_capacity = other.m_capacity;
+    m_submitted = other.m_submitted;
+    m_completed = other.m_completed;
+    m_familyIndex = other.m_familyIndex;
+    m_device = other.m_device;
+
+    other.reset();
+
+    return *this;
+}
+
+void UploadManager::upload(const vk::Buffer& dest, const vk::DeviceSize destOffset, const void* data, const vk::DeviceSize size)
+{
+    auto source = static_cast<const char*>(data);
+
+    for (vk::DeviceSize done = 0; done < size; )
+    {
+        auto chunk = std::min(size - done, m_capacity);
+        auto offset = reserve(chunk);
+
+        std::memcpy(static_cast<char*>(staging.data()) + offset, source + done, static_cast<size_t>(chunk));
+
+        // Extends the previous region when it continues the same copy
+        if (!m_pending.empty())
+        {
+            auto& last = m_pending.back();
+            if (last.dest == dest and last.copy.srcOffset + last.copy.size == offset and last.copy.dstOffset + last.copy.size == destOffset + done)
+            {
+                last.copy.size += chunk;
+                done += chunk;
+                continue;
+            }
+        }
+
+        m_pending.push_back({ dest, vk::BufferCopy(offset, destOffset + done, chunk) });
+        done += chunk;
+    }
+}
+
+UploadToken UploadManager::flush(const vk::Semaphore& signal)
+{
+    if (m_pending.empty() and !signal)
+    {
+        return m_submitted;
+    }
+
+    auto batch = nextBatch();
+
+    // Regions are grouped per destination, one vkCmdCopyBuffer each
+    std::stable_sort(m_pending.begin(), m_pending.end(), [](const Region& a, const Region& b) { 
+        return static_cast<VkBuffer>(a.dest) < static_cast<VkBuffer>(b.dest); 
+    });
+
+    batch.commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    std::vector<vk::BufferCopy> copies;
+    for (auto i = 0u; i < m_pending.size(); ++i)
+    {
+        copies.push_back(m_pending[i].copy);
+
+        if (i + 1 == m_pending.size() or m_pending[i + 1].dest != m_pending[i].dest)
+        {
+            batch.commandBuffer.copyBuffer(staging.buffer(), m_pending[i].dest, copies);
+            copies.clear();
+        }
+    }
+    batch.commandBuffer.end();
+
+    vk::SubmitInfo submitInfo(0, nullptr, nullptr, 1, &batch.commandBuffer, signal ? 1 : 0, &signal);
+    queue.submit({ submitInfo }, batch.fence);
+
+    batch.ringEnd = m_head;
+    batch.token = ++m_submitted;
+    m_inFlight.push_back(batch);
+    m_pending.clear();
+
+    return batch.token;
+}
+
+bool UploadManager::isComplete(const UploadToken token)
+{
+    retire(false);
+    return token <= m_completed;
+}
+
+void UploadManager::wait(const UploadToken token)
+{
+    if (token > m_submitted)
+    {
+        flush();
+    }
+
+    while (token > m_completed)
+    {
+        retire(true);
+    }
+}
+
+uint32_t UploadManager::familyIndex() const
+{
+    return m_familyIndex;
+}
+
+void UploadManager::reset()
+{
+    commandPool = vk::CommandPool();
+    staging.reset();
+    m_pending.clear();
+    m_inFlight.clear();
+    m_idle.clear();
+    queue = vk::Queue();
+    m_head = 0;
+    m_tail = 0;
+    m_capacity = 0;
+    m_submitted = 0;
+    m_completed = 0;
+    m_familyIndex = 0;
+    m_device = vk::Device();
+}
+
+void UploadManager::release()
+{
+    // the staging memory may still be read by the transfer queue
+    for (const auto& batch : m_inFlight)
+        m_device.waitForFences({ batch.fence }, VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+    for (const auto& batch : m_inFlight)
+        m_device.destroyFence(batch.fence);
+
+    for (const auto& batch : m_idle)
+        m_device.destroyFence(batch.fence);
+
+    m_inFlight.clear();
+    m_idle.clear();
+
+    staging.release();
+
+    // frees the command buffers with it
+    if (commandPool) m_device.destroyCommandPool(commandPool);
+}
+
+vk::DeviceSize UploadManager::reserve(const vk::DeviceSize size)
+{
+    auto begin = (m_head + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+
+    // Never straddle the end of the ring, skip to its start instead
+    if (begin % m_capacity + size > m_capacity)
+    {
+        begin = (begin / m_capacity + 1) * m_capacity;
+    }
+
+    while (begin + size - m_tail > m_capacity)
+    {
+        if (m_inFlight.empty())
+        {
+            if (m_pending.empty())
+            {
+                // the whole ring is free, start over at the wrap point
+                m_tail = begin - begin % m_capacity;
+                break;
+            }
+
+            // everything left in the ring is pending, submit it to make room
+            flush();
+        }
+        retire(true);
+    }
+
+    m_head = begin + size;
+    return begin % m_capacity;
+}
+
+void UploadManager::retire(const bool block)
+{
+    while (!m_inFlight.empty())
+    {
+        auto& oldest = m_inFlight.front();
+
+        if (block)
+        {
+            m_device.waitForFences({ oldest.fence }, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        }
+        else if (m_device.getFenceStatus(oldest.fence) != vk::Result::eSuccess)
+        {
+            return;
+        }
+
+        m_tail = oldest.ringEnd;
+        m_completed = oldest.token;
+        m_idle.push_back(oldest);
+        m_inFlight.pop_front();
+
+        // one is enough to make progress when blocking
+        if (block)
+        {
+            return;
+        }
+    }
+
+    // nothing left on the GPU - everything up to the last submit is free
+    if (m_pending.empty())
+    {
+        m_tail = m_head;
+    }
+}
+
+UploadManager::Batch UploadManager::nextBatch()
+{
+    retire(false);
+
+    if (m_idle.empty())
+    {
+        Batch batch;
+        batch.commandBuffer = m_device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(commandPool, vk::CommandBufferLevel::ePrimary, 1))[0];
+        batch.fence = m_device.createFence(vk::FenceCreateInfo());
+        return batch;
+    }
+
+    auto batch = m_idle.back();
+    m_idle.pop_back();
+
+    m_device.resetFences({ batch.fence });
+    batch.commandBuffer.reset(vk::CommandBufferResetFlags());
+    return batch;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "BoundedBuffer.h"
+
+// Identifies a flushed batch of copies, 0 is always complete
+using UploadToken = uint64_t;
+
+// Host to device buffer uploads through one reusable staging ring, submitted on the transfer queue.
+// upload() only copies into the ring and queues a region, flush() records every queued region into a single submit.
+// Nothing blocks unless the ring is full; the staging space of a batch is reused once its fence is seen signaled.
+// Destination buffers must be usable from the transfer family, e.g. created with concurrent sharing including it
+class UploadManager
+{
+public:
+    UploadManager(const vk::PhysicalDevice& physicalDevice, const vk::Device& dev, const uint32_t transferFamilyIndex, const vk::DeviceSize stagingSize);
+
+    UploadManager();
+
+    UploadManager(const UploadManager& other) = delete;
+
+    UploadManager(UploadManager&& other);
+
+    ~UploadManager();
+
+    UploadManager& operator=(const UploadManager& other) = delete;
+
+    UploadManager& operator=(UploadManager&& other);
+
+    // Queues a copy of `size` bytes into `dest` at `destOffset`, `data` may be reused as soon as this returns.
+    // Uploads bigger than the ring are split and flushed as the ring fills
+    void upload(const vk::Buffer& dest, const vk::DeviceSize destOffset, const void* data, const vk::DeviceSize size);
+
+    // Submits the queued copies, `signal` (optional) lets another queue wait for them without involving the host
+    UploadToken flush(const vk::Semaphore& signal = vk::Semaphore());
+
+    // Non-blocking, also recycles the staging space of finished batches
+    bool isComplete(const UploadToken token);
+
+    void wait(const UploadToken token);
+
+    uint32_t familyIndex() const;
+
+    void reset();
+
+    void release();
+
+private:
+    struct Region
+    {
+        vk::Buffer      dest;
+        vk::BufferCopy  copy;
+    };
+
+    struct Batch
+    {
+        vk::CommandBuffer   commandBuffer;
+        vk::Fence           fence;
+        uint64_t            ringEnd = 0;
+        UploadToken         token = 0;
+    };
+
+    // Reserves `size` contiguous bytes of the ring, returns the offset into the staging buffer
+    vk::DeviceSize reserve(const vk::DeviceSize size);
+
+    // Retires finished batches in submission order, waiting on the oldest when `block` is set
+    void retire(const bool block);
+
+    Batch nextBatch();
+
+    vk::CommandPool         commandPool;
+    BoundedBuffer           staging;
+    std::vector<Region>     m_pending;
+    std::deque<Batch>       m_inFlight;
+    std::vector<Batch>      m_idle;
+    vk::Queue               queue;
+    uint64_t                m_head;         // ring positions grow monotonically, the staging offset is position % capacity
+    uint64_t                m_tail;
+    vk::DeviceSize          m_capacity;
+    UploadToken             m_submitted;
+    UploadToken             m_completed;
+    uint32_t                m_familyIndex;
+    vk::Device              m_device;
+};
@@ -0,0 +1,37 @@
+#include "Vertex.h"
+
+void writeVertecies(const Particles& particles, Vertex* dest)
+{
+    for (auto i = 0u; i < particles.size(); ++i)
+    {
+        dest[i].position = glm::vec4(particles.x[i], particles.y[i], particles.z[i], particles.mass[i]);
+        dest[i].velocity = glm::vec4(particles.vx[i], particles.vy[i], particles.vz[i], 0.0f);
+    }
+}
+
+void writeVertecies(const Particles& particles, const std::vector<glm::vec3>& previous, const float alpha, Vertex* dest)
+{
+    for (auto i = 0u; i < particles.size(); ++i)
+    {
+        const auto position = glm::mix(previous[i], glm::vec3(particles.x[i], particles.y[i], particles.z[i]), alpha);
+
+        dest[i].position = glm::vec4(position, particles.mass[i]);
+        dest[i].velocity = glm::vec4(particles.vx[i], particles.vy[i], particles.vz[i], 0.0f);
+    }
+}
+
+void readVertecies(const Vertex* source, const size_t count, Particles& dest)
+{
+    dest.resize(count);
+
+    for (auto i = 0u; i < count; ++i)
+    {
+        dest.x[i] = source[i].position.x;
+        dest.y[i] = source[i].position.y;
+        dest.z[i] = source[i].position.z;
+        dest.mass[i] = source[i].position.w;
+        dest.vx[i] = source[i].velocity.x;
+        dest.vy[i] = source[i].velocity.y;
+        dest.vz[i] = source[i].velocity.z;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "../nbody/Particles.h"
+
+// One particle as the GPU sees it, the same record the compute shaders integrate (std430 Particle)
+struct Vertex
+{
+	glm::vec4 position;		// xyz, mass in w
+	glm::vec4 velocity;		// xyz, w unused
+
+	// Per instance for billboards, one quad per particle
+	static vk::VertexInputBindingDescription getBindingDescription(const vk::VertexInputRate inputRate = vk::VertexInputRate::eVertex)
+	{
+		return vk::VertexInputBindingDescription(0, sizeof(Vertex), inputRate);
+	}
+
+	static std::array<vk::VertexInputAttributeDescription, 2> getAttributeDescription()
+	{
+		return {
+			vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(Vertex, position)),
+			vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, velocity))
+		};
+	}
+};
+
+void writeVertecies(const Particles& particles, Vertex* dest);
+
+// Positions blended from `previous` to the particles' by `alpha`, the rest as it is
+void writeVertecies(const Particles& particles, const std::vector<glm::vec3>& previous, const float alpha, Vertex* dest);
+
+// The other way around, e.g. for state read back from the GPU - `dest` is resized to `count`
+void readVertecies(const Vertex* source, const size_t count, Particles& dest);
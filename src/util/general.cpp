@@ -20,35 +20,13 @@ std::vector<char> readFile(const std::string &path)
 	return buffer;
 }
 
-void copyBuffer(const vk::Device& device, const vk::Queue& queue, const vk::CommandPool& pool, const vk::Buffer& src, const vk::Buffer& dest, const vk::DeviceSize& size)
+vk::UniqueShaderModule createShaderModule(const vk::Device& device, const std::vector<char>& code)
 {
-	auto copyCommand = vk::UniqueCommandBuffer(
-		device.allocateCommandBuffers(
-			vk::CommandBufferAllocateInfo(
-				pool,
-				vk::CommandBufferLevel::ePrimary,
-				1
-			)
-		)[0],
-		vk::PoolFree(
-			device, 
-			pool, 
-			vk::DispatchLoaderStatic()
+	return device.createShaderModuleUnique(
+		vk::ShaderModuleCreateInfo(
+			vk::ShaderModuleCreateFlags(),
+			code.size(), 
+			reinterpret_cast<const uint32_t *>(code.data())
 		)
 	);
-
-	copyCommand->begin(
-		vk::CommandBufferBeginInfo(
-			vk::CommandBufferUsageFlagBits::eOneTimeSubmit
-		)
-	);
-	copyCommand->copyBuffer(src, dest, { vk::BufferCopy(0, 0, size) });
-	copyCommand->end();
-
-	auto copyFence = device.createFenceUnique(vk::FenceCreateInfo());
-	vk::SubmitInfo submitInfo;
-	submitInfo.setCommandBufferCount(1);
-	submitInfo.setPCommandBuffers(&copyCommand.get());
-	queue.submit(1, &submitInfo, *copyFence);
-	device.waitForFences({*copyFence}, VK_TRUE, std::numeric_limits<uint64_t>::max());
 }
@@ -14,4 +14,4 @@ T clamp(const T &min, const T &value, const T &max)
 	return std::max(min, std::min(value, max));
 }
 
-void copyBuffer(const vk::Device& device, const vk::Queue& queue, const vk::CommandPool& pool, const vk::Buffer& src, const vk::Buffer& dest, const vk::DeviceSize& size);
\ No newline at end of file
+vk::UniqueShaderModule createShaderModule(const vk::Device& device, const std::vector<char>& code);
@@ -1,6 +1,7 @@
 #include "query.h"
 
 #include <algorithm>
+#include <stdexcept>
 
 #include "general.h"
 #include "QueueFamilyIndices.h"
@@ -32,11 +33,11 @@ vk::SurfaceFormatKHR SwapChainSupportDetails::chooseFormat() const
 	return formats[0];
 }
 
-vk::PresentModeKHR SwapChainSupportDetails::choosePresentMode() const
+vk::PresentModeKHR SwapChainSupportDetails::choosePresentMode(const vk::PresentModeKHR preferred) const
 {
     for (const auto &availablePresentMode : presentModes)
 	{
-		if (availablePresentMode == vk::PresentModeKHR::eMailbox)
+		if (availablePresentMode == preferred)
 		{
 			return availablePresentMode;
 		}
@@ -80,6 +81,36 @@ vk::SurfaceTransformFlagBitsKHR SwapChainSupportDetails::getCurrentTransform() c
     return capabilities.currentTransform;
 }
 
+const char* toString(const vk::PresentModeKHR mode)
+{
+    switch (mode)
+    {
+    case vk::PresentModeKHR::eImmediate:
+        return "immediate";
+    case vk::PresentModeKHR::eMailbox:
+        return "mailbox";
+    case vk::PresentModeKHR::eFifo:
+        return "fifo";
+    case vk::PresentModeKHR::eFifoRelaxed:
+        return "fifo-relaxed";
+    default:
+        return "unknown";
+    }
+}
+
+vk::PresentModeKHR parsePresentMode(const std::string& name)
+{
+    for (auto mode : { vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eFifo, vk::PresentModeKHR::eFifoRelaxed })
+    {
+        if (name == toString(mode))
+        {
+            return mode;
+        }
+    }
+
+    throw std::invalid_argument("unknown present mode: " + name);
+}
+
 std::vector<const char *> getRequiredExtensions()
 {
     uint32_t extCount = 0;
@@ -90,6 +121,11 @@ std::vector<const char *> getRequiredExtensions()
     return extensions;
 }
 
+std::vector<const char *> getHeadlessExtensions()
+{
+    return { VK_EXT_DEBUG_UTILS_EXTENSION_NAME };
+}
+
 bool checkDeviceExtensionsSupported(const vk::PhysicalDevice& dev, const std::vector<const char*>& extensions)
 {
 	auto properties = dev.enumerateDeviceExtensionProperties();
@@ -122,3 +158,10 @@ bool isDeviceSuitable(const vk::PhysicalDevice& dev, const vk::SurfaceKHR& rende
 	auto swapChainAdequate = SwapChainSupportDetails(dev, renderSurface).isAdequate();
 	return queuesFound && extensionsSupported && swapChainAdequate;
 }
+
+bool isDeviceSuitable(const vk::PhysicalDevice& dev, const std::vector<const char*>& extensions)
+{
+	auto queuesFound = QueueFamilyIndices(dev).hasAllQueues();
+	auto extensionsSupported = checkDeviceExtensionsSupported(dev, extensions);
+	return queuesFound && extensionsSupported;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include <vulkan/vulkan.hpp>
@@ -14,7 +15,8 @@ public:
 
     vk::SurfaceFormatKHR chooseFormat() const;
 
-    vk::PresentModeKHR choosePresentMode() const;
+    // `preferred` when the surface supports it, FIFO otherwise - the one mode every surface has
+    vk::PresentModeKHR choosePresentMode(const vk::PresentModeKHR preferred = vk::PresentModeKHR::eMailbox) const;
 
     vk::Extent2D chooseExtent(const uint32_t currentWidth, const uint32_t currentHeight) const;
 
@@ -30,8 +32,17 @@ private:
     const std::vector<vk::PresentModeKHR> presentModes;
 };
 
+// "immediate", "mailbox", "fifo" or "fifo-relaxed"
+const char* toString(const vk::PresentModeKHR mode);
+
+vk::PresentModeKHR parsePresentMode(const std::string& name);
+
 std::vector<const char *> getRequiredExtensions();
 
+std::vector<const char *> getHeadlessExtensions();
+
 bool checkDeviceExtensionsSupported(const vk::PhysicalDevice& dev, const std::vector<const char*>& extensions);
 
 bool isDeviceSuitable(const vk::PhysicalDevice& dev, const vk::SurfaceKHR& renderSurface, const std::vector<const char*>& extensions);
+
+bool isDeviceSuitable(const vk::PhysicalDevice& dev, const std::vector<const char*>& extensions);
@@ -0,0 +1,62 @@
+#include "shaders.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include "general.h"
+#include "../config.h"
+
+namespace
+{
+
+struct EmbeddedShader
+{
+    const uint32_t* code;
+    size_t          wordCount;
+};
+
+// Function local so it exists before the first registration, whatever the static initialization order
+std::map<std::string, EmbeddedShader>& registry()
+{
+    static std::map<std::string, EmbeddedShader> shaders;
+    return shaders;
+}
+
+}
+
+bool registerShader(const char* name, const uint32_t* code, const size_t wordCount)
+{
+    registry()[name] = { code, wordCount };
+    return true;
+}
+
+vk::UniqueShaderModule loadShaderModule(const vk::Device& device, const std::string& name)
+{
+    if (auto directory = std::getenv(config::SHADER_DIRECTORY_VARIABLE))
+    {
+        auto path = std::string(directory) + '/' + name;
+        if (std::ifstream(path).good())
+        {
+            std::cout << "Shader " << name << " loaded from " << path << '\n';
+            return createShaderModule(device, readFile(path));
+        }
+    }
+
+    auto it = registry().find(name);
+    if (it == registry().end())
+    {
+        throw std::runtime_error("shader not embedded: " + name);
+    }
+
+    return device.createShaderModuleUnique(
+        vk::ShaderModuleCreateInfo(
+            vk::ShaderModuleCreateFlags(),
+            it->second.wordCount * sizeof(uint32_t),
+            it->second.code
+        )
+    );
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+
+// SPIR-V compiled into the executable by add_shader (cmake/glslc.cmake), keyed by the .spv name it was given there
+
+// Called by the generated sources during static initialization, `code` has to live as long as the program
+bool registerShader(const char* name, const uint32_t* code, const size_t wordCount);
+
+// With config::SHADER_DIRECTORY_VARIABLE set, a file called `name` in that directory wins over the embedded code,
+// so shaders can be iterated on without relinking
+vk::UniqueShaderModule loadShaderModule(const vk::Device& device, const std::string& name);
@@ -1,10 +1,36 @@
 #pragma once
 
+#include "Autotuner.h"
 #include "BoundedBuffer.h"
 #include "callbacks.h"
+#include "CommandRecorder.h"
+#include "Compute.h"
+#include "ComputeTuning.h"
+#include "DeletionQueue.h"
+#include "FrameConstants.h"
+#include "FramePacer.h"
+#include "FrameStats.h"
 #include "general.h"
+#include "GpuProfiler.h"
 #include "Graphics.h"
+#include "HostParticles.h"
+#include "LatencyHistogram.h"
+#include "MemoryAllocator.h"
 #include "MVPTransform.h"
+#include "Offscreen.h"
+#include "Options.h"
+#include "ParticleSource.h"
+#include "PipelineCache.h"
+#include "Playback.h"
 #include "Present.h"
 #include "query.h"
 #include "QueueFamilyIndices.h"
+#include "QueueOverlap.h"
+#include "QueueTimer.h"
+#include "RenderTarget.h"
+#include "RollingStats.h"
+#include "shaders.h"
+#include "SimulationClock.h"
+#include "UniformRing.h"
+#include "UploadManager.h"
+#include "Vertex.h"